@@ -1,10 +1,13 @@
 ﻿const bcrypt = require('bcrypt');
 const Usuario = require('../models/administradores'); 
 
+// Salt rounds; pick them with node_modules/bcrypt/bench (bcrypt_bench --calibrate)
+const BCRYPT_COST = parseInt(process.env.BCRYPT_COST, 10) || 10;
+
 exports.registro = async (req, res) => {
     try {
         const { usuario_id, username, password, gestionar_contenido } = req.body;
-        const hashedPassword = await bcrypt.hash(password, 10); // Hash password with a salt round of 10
+        const hashedPassword = await bcrypt.hash(password, BCRYPT_COST); // Hash password with BCRYPT_COST salt rounds
         const newUser = await Usuario.create({
             usuario_id,
             username,
@@ -1,12 +1,54 @@
 #include <iostream>
+#include <cstdio>
 #include <cstring>
 #include <cstdlib>
 #include <ctime>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+/* Intrinsecos para los filtros vectoriales: SSE2 es parte de x86-64; AVX2 se compila
+   aparte (OBJETIVO_AVX2) y solo se usa si el procesador lo soporta */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FILTROS_CON_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#define FILTROS_CON_AVX2 1
+#define OBJETIVO_AVX2
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FILTROS_CON_AVX2 1
+#define OBJETIVO_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+#if defined(_WIN32)
+#include <winsock2.h> /* antes de windows.h; enlazar con -lws2_32 */
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#endif
 using namespace std;
 
 /* ------- CONSTANTES ------- */
-const int MAX_PACIENTES = 500;
-const int MAX_ESPECIALIDADES = 100;
+
+/* Rango de años aceptado para turnos: las marcas de tiempo de la agenda
+   (minutos desde 1/1/1970) tienen que entrar en un int */
+const int ANIO_MINIMO = 1900;
+const int ANIO_MAXIMO = 2999;
 
 /* Estados turno */
 const int ESTADO_ACTIVO = 1;
@@ -14,7 +56,8 @@ const int ESTADO_CANCELADO = 2;
 
 /* ------- ESTRUCTURAS ------- */
 
-/* Paciente: campos con longitudes razonables */
+/* Paciente: campos con longitudes razonables. Es el registro de tamaño fijo con que un
+   paciente viaja al log y al snapshot; en memoria se guarda como FichaPaciente. */
 struct Paciente {
     char apellido[51];
     char nombre[51];
@@ -22,18 +65,54 @@ struct Paciente {
     char telefono[21];
 };
 
-/* Especialidad: codigo auto-incremental y descripcion */
+/* Horario de atencion: de inicio a fin (minutos desde las 00:00) la especialidad
+   atiende turnos de duracion minutos, y cada turno admite hasta cupo pacientes. */
+struct HorarioAtencion {
+    int inicio;
+    int fin;
+    int duracion;
+    int cupo;
+};
+
+/* Especialidad: codigo auto-incremental, descripcion y horario de atencion.
+   Igual que Paciente, es el registro del log y del snapshot (en memoria: FichaEspecialidad). */
 struct Especialidad {
     int codigo;
     char nombre[51];
     char descripcion[101];
+    HorarioAtencion horario;
+};
+
+/* Horario que reciben las especialidades cuando no se indica otro (y las cargadas de
+   archivos anteriores a que existiera el horario) */
+const HorarioAtencion HORARIO_POR_DEFECTO = { 8 * 60, 20 * 60, 30, 1 };
+const int DURACION_MINIMA_TURNO = 5;
+const int CUPO_MAXIMO_TURNO = 1000;
+
+/* Fichas en memoria de pacientes y especialidades: las cadenas apuntan a la arena del
+   catalogo (ver ARENA DE CADENAS) y ocupan solo su largo real, con los mismos maximos
+   que los registros de tamaño fijo. */
+struct FichaPaciente {
+    char *apellido;
+    char *nombre;
+    char *dni;      /* NULL: posicion dada de baja */
+    char *telefono;
+};
+
+struct FichaEspecialidad {
+    int codigo;     /* 0: posicion dada de baja */
+    char *nombre;
+    char *descripcion;
+    HorarioAtencion horario;
 };
 
-/* Nodo para lista enlazada de Turnos.
-   Cada turno almacena fecha/hora en campos enteros (dia, mes, año, hora, minuto),
+/* Turno.
+   Vista completa de un turno: fecha/hora en campos enteros (dia, mes, año, hora, minuto),
    dni del paciente como char[], codigo de especialidad, codigo del turno y estado.
+   Es el registro de alta del log y lo que reciben listados y reportes; en memoria los
+   turnos se guardan por columnas (ver BloqueTurnos).
 */
-struct TurnoNodo {
+struct Turno {
     int codigo;
     int dia;
     int mes;
@@ -43,24 +122,66 @@ struct TurnoNodo {
     char pacienteDNI[15];
     int codigoEspecialidad;
     int estado; /* 1 Activo, 2 Cancelado */
-    TurnoNodo *siguiente;
 };
 
 /* ------- ALMACENAMIENTO GLOBAL (simula "base de datos" en memoria) ------- */
 
-/* Arreglos estáticos (entregas 1..3) */
-Paciente pacientes[MAX_PACIENTES];
-int cantidadPacientes = 0;
+/* Pacientes y especialidades: arreglos que se duplican al llenarse, sin tope fijo.
+   Una baja deja su posicion libre (dni NULL o codigo 0) y la anota para reusarla en
+   la proxima alta, asi ninguna otra ficha se mueve y los indices siguen validos.
+   Los recorridos van de 0 a posiciones* y saltean las libres. */
+FichaPaciente *pacientes = NULL;
+int posicionesPacientes = 0;   /* posiciones en uso, incluidas las libres */
+int capacidadPacientes = 0;
+int cantidadPacientes = 0;     /* pacientes vigentes */
 
-Especialidad especialidades[MAX_ESPECIALIDADES];
+FichaEspecialidad *especialidades = NULL;
+int posicionesEspecialidades = 0;
+int capacidadEspecialidades = 0;
 int cantidadEspecialidades = 0;
 
-/* Lista enlazada de turnos (entrega 4: estructura dinámica con nodos) */
-TurnoNodo *cabezaTurnos = NULL;
+/* Almacen de turnos: bloques contiguos de tamaño fijo. Un turno ocupa siempre el mismo
+   slot (0..cantidadTurnos-1, en orden de alta) y su direccion no cambia al crecer,
+   porque solo se agregan bloques nuevos. Los turnos nunca se borran: se cancelan. */
+const int BITS_TURNOS_POR_BLOQUE = 10;
+const int TURNOS_POR_BLOQUE = 1 << BITS_TURNOS_POR_BLOQUE;
+
+/* Cada bloque guarda sus turnos por columnas, un arreglo por campo: un recorrido que
+   solo mira estado y especialidad trae a cache solo esas dos columnas. La fecha y hora
+   van empaquetadas en minutos (ver minutosDeTurno) y el DNI se reemplaza por el id del
+   heap de DNIs, asi un turno ocupa 17 bytes en vez de sizeof(Turno). */
+struct BloqueTurnos {
+    int codigo[TURNOS_POR_BLOQUE];
+    int minutos[TURNOS_POR_BLOQUE];
+    int paciente[TURNOS_POR_BLOQUE];      /* id del DNI (ver HEAP DE DNIS) */
+    int especialidad[TURNOS_POR_BLOQUE];
+    unsigned char estado[TURNOS_POR_BLOQUE];
+};
+
+/* Un turno leido de las columnas, sin convertir (imagen del historial de versiones) */
+struct FilaTurno {
+    int codigo;
+    int minutos;
+    int paciente;
+    int especialidad;
+    unsigned char estado;
+};
+
+atomic<BloqueTurnos **> bloquesTurnos(NULL);
+int capacidadBloquesTurnos = 0;
+int cantidadTurnos = 0;
+
+/* Los primeros bloquesTurnosMapeados bloques apuntan directamente al snapshot mapeado en memoria */
+int bloquesTurnosMapeados = 0;
+
+/* codigo de turno -> slot en el almacen (-1 si el codigo no existe) */
+int *slotPorCodigo = NULL;
+int capacidadSlotPorCodigo = 0;
 
-/* Contadores de códigos auto-incrementales */
-int proximoCodigoEspecialidad = 1;
-int proximoCodigoTurno = 1;
+/* Contadores de códigos auto-incrementales. Son atomicos porque en modo servidor
+   varios hilos toman codigos a la vez (fetch_add). */
+atomic<int> proximoCodigoEspecialidad(1);
+atomic<int> proximoCodigoTurno(1);
 
 /* ------- FUNCIONES AUXILIARES (básicas) ------- */
 
@@ -85,598 +206,7190 @@ bool esVacio(const char *s) {
     return true;
 }
 
-/* Convierte fecha/hora a minutos "absolutos" para comparar (aprox).
-   Utiliza struct tm y mktime para obtener time_t, luego divide por 60.
-   Devuelve -1 en caso de error de parseo.
-*/
-long convertirFechaHoraAMinutos(int dia, int mes, int anio, int hora, int minuto) {
-    struct tm t;
-    t.tm_mday = dia;
-    t.tm_mon = mes - 1; /* tm_mon 0..11 */
-    t.tm_year = anio - 1900; /* tm_year desde 1900 */
-    t.tm_hour = hora;
-    t.tm_min = minuto;
-    t.tm_sec = 0;
-    t.tm_isdst = -1; /* calcular DST automáticamente */
-    time_t tt = mktime(&t);
-    if (tt == -1) return -1;
-    return (long)(tt / 60); /* minutos desde epoch */
-}
-
-/* Devuelve minutos actuales desde epoch */
-long minutosActuales() {
-    time_t ahora = time(NULL);
-    return (long)(ahora / 60);
+/* Copia una cadena a un campo de tamaño fijo, truncando si no entra */
+void copiarCampo(char *destino, const char *origen, int tam) {
+    strncpy(destino, origen, tam - 1);
+    destino[tam - 1] = '\0';
 }
 
-/* Buscar paciente por DNI; si lo encuentra devuelve su índice en arreglo (0..n-1) y true.
-   Si no lo encuentra, devuelve false. */
-bool buscarPacientePorDNI(const char *dni, int &indiceOut) {
-    int i;
-    for (i = 0; i < cantidadPacientes; i = i + 1) {
-        if (strcmp(pacientes[i].dni, dni) == 0) {
-            indiceOut = i;
-            return true;
-        }
+/* ------- ARENA DE CADENAS ------- */
+
+/* Las cadenas del catalogo se copian una detras de otra en bloques grandes en vez de
+   pedir memoria por cada una. Una baja o una modificacion que no entra en el lugar
+   viejo deja bytes sin uso (desperdicio); compactarCadenasCatalogo los recupera
+   copiando las cadenas vigentes a una arena nueva. */
+const size_t TAM_BLOQUE_ARENA = 64 * 1024;
+
+struct Arena {
+    char *bloque;       /* bloque actual; al principio guarda el puntero al bloque anterior */
+    size_t usado;
+    size_t capacidad;
+    size_t ocupado;     /* bytes entregados, sumando todos los bloques */
+    size_t desperdicio; /* de esos, los que ya no usa nadie */
+};
+
+Arena cadenasCatalogo = { NULL, 0, 0, 0, 0 };
+
+/* Largo de s sin pasar de maximo (los registros leidos de archivo pueden no tener '\0') */
+size_t largoAcotado(const char *s, size_t maximo) {
+    size_t largo = 0;
+    while (largo < maximo && s[largo] != '\0') largo = largo + 1;
+    return largo;
+}
+
+/* Reserva tam bytes contiguos; nunca mueve lo ya reservado */
+char *arenaReservar(Arena &a, size_t tam) {
+    if (a.bloque == NULL || a.usado + tam > a.capacidad) {
+        size_t capacidad = TAM_BLOQUE_ARENA;
+        if (tam + sizeof(char *) > capacidad) capacidad = tam + sizeof(char *);
+        char *nuevo = new char[capacidad];
+        memcpy(nuevo, &a.bloque, sizeof(char *));
+        a.bloque = nuevo;
+        a.usado = sizeof(char *);
+        a.capacidad = capacidad;
     }
-    return false;
+    char *p = a.bloque + a.usado;
+    a.usado = a.usado + tam;
+    a.ocupado = a.ocupado + tam;
+    return p;
 }
 
-/* Buscar especialidad por codigo; devuelve índice si la encuentra */
-bool buscarEspecialidadPorCodigo(int codigo, int &indiceOut) {
-    int i;
-    for (i = 0; i < cantidadEspecialidades; i = i + 1) {
-        if (especialidades[i].codigo == codigo) {
-            indiceOut = i;
-            return true;
-        }
+/* Copia s a la arena truncada a maximo - 1 caracteres, igual que copiarCampo */
+char *arenaCopiarCadena(Arena &a, const char *s, size_t maximo) {
+    size_t largo = largoAcotado(s, maximo - 1);
+    char *p = arenaReservar(a, largo + 1);
+    memcpy(p, s, largo);
+    p[largo] = '\0';
+    return p;
+}
+
+/* Reemplaza el contenido de campo: si el texto nuevo entra en el lugar del viejo se
+   sobrescribe, si no se copia al final de la arena y el viejo queda como desperdicio */
+void arenaReemplazarCadena(Arena &a, char *&campo, const char *s, size_t maximo) {
+    size_t largo = largoAcotado(s, maximo - 1);
+    size_t anterior = strlen(campo);
+    if (largo <= anterior) {
+        memcpy(campo, s, largo);
+        campo[largo] = '\0';
+        a.desperdicio = a.desperdicio + (anterior - largo);
+        return;
     }
-    return false;
+    a.desperdicio = a.desperdicio + anterior + 1;
+    campo = arenaCopiarCadena(a, s, maximo);
 }
 
-/* Cuenta turnos activos de un paciente (recorre la lista enlazada) */
-int contarTurnosActivosPaciente(const char *dni) {
-    int cuenta = 0;
-    TurnoNodo *actual = cabezaTurnos;
-    while (actual != NULL) {
-        if (actual->estado == ESTADO_ACTIVO && strcmp(actual->pacienteDNI, dni) == 0) {
-            cuenta = cuenta + 1;
-        }
-        actual = actual->siguiente;
+/* La cadena deja de usarse (baja de la ficha) */
+void arenaDescartarCadena(Arena &a, const char *campo) {
+    a.desperdicio = a.desperdicio + strlen(campo) + 1;
+}
+
+void arenaLiberar(Arena &a) {
+    while (a.bloque != NULL) {
+        char *anterior;
+        memcpy(&anterior, a.bloque, sizeof(char *));
+        delete[] a.bloque;
+        a.bloque = anterior;
     }
-    return cuenta;
+    a.usado = 0;
+    a.capacidad = 0;
+    a.ocupado = 0;
+    a.desperdicio = 0;
 }
 
-/* Cuenta turnos activos para una especialidad */
-int contarTurnosActivosEspecialidad(int codigoEsp) {
-    int cuenta = 0;
-    TurnoNodo *actual = cabezaTurnos;
-    while (actual != NULL) {
-        if (actual->estado == ESTADO_ACTIVO && actual->codigoEspecialidad == codigoEsp) {
-            cuenta = cuenta + 1;
-        }
-        actual = actual->siguiente;
+/* ------- CONCURRENCIA (modo servidor) ------- */
+
+/* En modo servidor varios hilos ejecutan operaciones a la vez. Orden de los candados
+   (siempre se toman en este orden y nunca al reves):
+     1. candadoCatalogo (lectura/escritura): pacientes y especialidades. Las operaciones
+        de turnos lo toman en lectura; las ABM de pacientes/especialidades, la exportacion
+        y la compactacion lo toman en escritura, con lo que ademas excluyen a todos los
+        turnos en curso.
+     2. franja de la especialidad (candadosEspecialidad): serializa las operaciones sobre
+        turnos de una misma especialidad. Protege la regla "un turno activo por paciente y
+        especialidad" entre la comprobacion y el alta, el estado/fecha de sus turnos y las
+        estructuras de la especialidad: su agenda, sus cupos, su contador de activos y la
+        tabla (paciente, especialidad) de su franja. Los arreglos indexados por codigo de
+        especialidad solo crecen con candadoCatalogo exclusivo (ver insertarEspecialidad).
+     3. candadoAlmacen: lo compartido por todas las especialidades: almacen por bloques,
+        tabla de codigos, agenda general e indices por paciente. Una reserva lo toma solo
+        para guardar el turno; la comprobacion de cupo, los indices de la especialidad y
+        el registro en el log se hacen afuera, con la franja tomada.
+     4. candadoLog (ver LOG DE OPERACIONES): buffer del log.
+   Fuera del modo servidor los candados no tienen contencion. */
+const int FRANJAS_ESPECIALIDAD = 64; /* potencia de 2 */
+
+struct CandadoLecturaEscritura {
+#if defined(_WIN32)
+    SRWLOCK srw;
+#else
+    pthread_rwlock_t rw;
+#endif
+};
+
+#if defined(_WIN32)
+CandadoLecturaEscritura candadoCatalogo = { SRWLOCK_INIT };
+#elif defined(PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP)
+/* con preferencia de escritura, una ABM no espera indefinidamente detras de las reservas */
+CandadoLecturaEscritura candadoCatalogo = { PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP };
+#else
+CandadoLecturaEscritura candadoCatalogo = { PTHREAD_RWLOCK_INITIALIZER };
+#endif
+
+mutex candadosEspecialidad[FRANJAS_ESPECIALIDAD];
+mutex candadoAlmacen;
+
+mutex &franjaEspecialidad(int codigo) {
+    return candadosEspecialidad[(unsigned int)codigo & (FRANJAS_ESPECIALIDAD - 1)];
+}
+
+/* Guardas: toman el candado al construirse y lo sueltan al salir del bloque (o antes,
+   con soltar: las operaciones sueltan los candados antes de esperar el log) */
+struct GuardaLectura {
+    CandadoLecturaEscritura &c;
+    bool tomado;
+    GuardaLectura(CandadoLecturaEscritura &candado) : c(candado), tomado(true) {
+#if defined(_WIN32)
+        AcquireSRWLockShared(&c.srw);
+#else
+        pthread_rwlock_rdlock(&c.rw);
+#endif
+    }
+    void soltar() {
+        if (!tomado) return;
+        tomado = false;
+#if defined(_WIN32)
+        ReleaseSRWLockShared(&c.srw);
+#else
+        pthread_rwlock_unlock(&c.rw);
+#endif
     }
-    return cuenta;
+    ~GuardaLectura() {
+        soltar();
+    }
+};
+
+struct GuardaEscritura {
+    CandadoLecturaEscritura &c;
+    bool tomado;
+    GuardaEscritura(CandadoLecturaEscritura &candado) : c(candado), tomado(true) {
+#if defined(_WIN32)
+        AcquireSRWLockExclusive(&c.srw);
+#else
+        pthread_rwlock_wrlock(&c.rw);
+#endif
+    }
+    void soltar() {
+        if (!tomado) return;
+        tomado = false;
+#if defined(_WIN32)
+        ReleaseSRWLockExclusive(&c.srw);
+#else
+        pthread_rwlock_unlock(&c.rw);
+#endif
+    }
+    ~GuardaEscritura() {
+        soltar();
+    }
+};
+
+/* ------- METRICAS DE OPERACIONES ------- */
+
+/* Cada operacion de la API (y las busquedas de turnos de los menus) cuenta sus llamadas,
+   sus resultados y un histograma de latencias; ademas hay contadores del trabajo interno
+   (entradas de agenda recorridas, filas filtradas, terminos comparados, vuelcos del log).
+   Cada hilo anota en su propio bloque MetricasHilo, sin candados ni instrucciones
+   atomicas de lectura-escritura: es el unico que escribe su bloque, y los contadores son
+   atomicos solo para que otro hilo los pueda leer sin carrera. Al leer se suman todos los
+   bloques vivos mas los de los hilos que ya terminaron (ver sumarMetricas).
+   El histograma tiene 4 cubetas por potencia de 2 (error menor al 25%).
+   Compilando con -DSIN_METRICAS los macros quedan vacios y no se mide nada.
+   Los resultados se guardan por ResultadoOperacion: los rechazos por la regla de 48 horas
+   son los ERROR_PLAZO_CANCELACION de cancelacion_turno. */
+#if !defined(SIN_METRICAS)
+#define CON_METRICAS 1
+#endif
+
+enum OperacionMedida {
+    MEDIDA_ALTA_PACIENTE = 0,
+    MEDIDA_MODIFICACION_PACIENTE,
+    MEDIDA_BAJA_PACIENTE,
+    MEDIDA_ALTA_ESPECIALIDAD,
+    MEDIDA_MODIFICACION_ESPECIALIDAD,
+    MEDIDA_BAJA_ESPECIALIDAD,
+    MEDIDA_ALTA_TURNO,
+    MEDIDA_MODIFICACION_TURNO,
+    MEDIDA_CANCELACION_TURNO,
+    MEDIDA_BUSQUEDA_TURNOS,
+    MEDIDA_FILTRO_TURNOS,
+    MEDIDA_BUSQUEDA_CUPOS,
+    MEDIDA_BUSQUEDA_PACIENTES,
+    MEDIDA_BUSQUEDA_APROXIMADA,
+    CANTIDAD_OPERACIONES_MEDIDAS
+};
+
+const char *NOMBRES_OPERACIONES_MEDIDAS[CANTIDAD_OPERACIONES_MEDIDAS] = {
+    "alta_paciente", "modificacion_paciente", "baja_paciente", "alta_especialidad", "modificacion_especialidad",
+    "baja_especialidad", "alta_turno", "modificacion_turno", "cancelacion_turno", "busqueda_turnos",
+    "filtro_turnos", "busqueda_cupos", "busqueda_pacientes", "busqueda_aproximada"
+};
+
+enum ContadorMetrica {
+    CONTADOR_RECORRIDOS_AGENDA = 0,  /* cursores de agenda abiertos */
+    CONTADOR_ENTRADAS_AGENDA,        /* entradas que devolvieron */
+    CONTADOR_FILTROS_COLUMNA,        /* pasadas de los filtros vectoriales */
+    CONTADOR_FILAS_FILTRADAS,        /* filas que recorrieron */
+    CONTADOR_TERMINOS_COMPARADOS,    /* distancias de edicion calculadas en la busqueda aproximada */
+    CONTADOR_VUELCOS_LOG,            /* escrituras con fsync del log */
+    CONTADOR_BYTES_LOG,
+    CANTIDAD_CONTADORES_METRICA
+};
+
+const char *NOMBRES_CONTADORES_METRICA[CANTIDAD_CONTADORES_METRICA] = {
+    "recorridos_agenda", "entradas_agenda", "filtros_columna", "filas_filtradas", "terminos_comparados",
+    "vuelcos_log", "bytes_log"
+};
+
+const int CUBETAS_LATENCIA = 160;           /* hasta 2^40 ns (unos 18 minutos) */
+const int RESULTADOS_POR_OPERACION = 32;    /* mas que los valores de ResultadoOperacion */
+
+/* Se devuelve el resultado de la operacion a traves de RESULTADO_MEDIDO para anotarlo */
+#if defined(CON_METRICAS)
+#define MEDIR_OPERACION(operacion) MedicionOperacion medicionOperacion(operacion)
+#define RESULTADO_MEDIDO(resultado) medicionOperacion.terminar(resultado)
+#define CONTAR_METRICA(contador, cantidad) sumarContadorMetrica(contador, (unsigned long long)(cantidad))
+#else
+#define MEDIR_OPERACION(operacion)
+#define RESULTADO_MEDIDO(resultado) (resultado)
+#define CONTAR_METRICA(contador, cantidad)
+#endif
+
+/* Nanosegundos de un reloj monotono, para medir operaciones de una sola busqueda */
+long long nanosegundosMonotonos() {
+#if defined(_WIN32)
+    LARGE_INTEGER frecuencia;
+    LARGE_INTEGER ahora;
+    QueryPerformanceFrequency(&frecuencia);
+    QueryPerformanceCounter(&ahora);
+    return (long long)(ahora.QuadPart / frecuencia.QuadPart) * 1000000000 +
+           (long long)(ahora.QuadPart % frecuencia.QuadPart) * 1000000000 / frecuencia.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
 }
 
-/* Comprueba si existe un turno activo para un mismo paciente y misma especialidad */
-bool existeTurnoActivoPacienteEspecial(const char *dni, int codigoEsp) {
-    TurnoNodo *actual = cabezaTurnos;
-    while (actual != NULL) {
-        if (actual->estado == ESTADO_ACTIVO && strcmp(actual->pacienteDNI, dni) == 0 && actual->codigoEspecialidad == codigoEsp) {
-            return true;
+#if defined(CON_METRICAS)
+/* Cubeta de una latencia: 0..3 exactas, despues 4 por potencia de 2 */
+int cubetaLatencia(unsigned long long nanosegundos) {
+    if (nanosegundos < 4) return (int)nanosegundos;
+    int exponente = 63;
+    while ((nanosegundos >> exponente) == 0) exponente = exponente - 1;
+    int cubeta = (exponente - 1) * 4 + (int)((nanosegundos >> (exponente - 2)) & 3);
+    return (cubeta < CUBETAS_LATENCIA) ? cubeta : CUBETAS_LATENCIA - 1;
+}
+
+/* Mayor latencia que cae en la cubeta */
+unsigned long long techoCubetaLatencia(int cubeta) {
+    if (cubeta < 4) return (unsigned long long)cubeta;
+    int exponente = cubeta / 4 + 1;
+    unsigned long long piso = (unsigned long long)(4 + cubeta % 4) << (exponente - 2);
+    return piso + (1ULL << (exponente - 2)) - 1;
+}
+
+struct MetricasHilo {
+    atomic<unsigned long long> llamadas[CANTIDAD_OPERACIONES_MEDIDAS];
+    atomic<unsigned long long> nanosegundos[CANTIDAD_OPERACIONES_MEDIDAS];
+    atomic<unsigned long long> maximo[CANTIDAD_OPERACIONES_MEDIDAS];
+    atomic<unsigned long long> cubetas[CANTIDAD_OPERACIONES_MEDIDAS][CUBETAS_LATENCIA];
+    atomic<unsigned long long> resultados[CANTIDAD_OPERACIONES_MEDIDAS][RESULTADOS_POR_OPERACION];
+    atomic<unsigned long long> contadores[CANTIDAD_CONTADORES_METRICA];
+    MetricasHilo *siguiente;
+};
+
+/* Lista de bloques vivos y suma de los hilos terminados, con candadoMetricas */
+mutex candadoMetricas;
+MetricasHilo *metricasVivas = NULL;
+MetricasHilo metricasTerminadas;
+
+/* Suma de un solo escritor: no necesita una instruccion atomica de lectura-escritura */
+inline void sumarRelajado(atomic<unsigned long long> &x, unsigned long long v) {
+    x.store(x.load(memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+/* a += b (b puede estar cambiando: se lee cada contador una vez) */
+void acumularMetricas(MetricasHilo &a, const MetricasHilo &b) {
+    int i;
+    int j;
+    for (i = 0; i < CANTIDAD_OPERACIONES_MEDIDAS; i = i + 1) {
+        sumarRelajado(a.llamadas[i], b.llamadas[i].load(memory_order_relaxed));
+        sumarRelajado(a.nanosegundos[i], b.nanosegundos[i].load(memory_order_relaxed));
+        unsigned long long maximo = b.maximo[i].load(memory_order_relaxed);
+        if (maximo > a.maximo[i].load(memory_order_relaxed)) a.maximo[i].store(maximo, memory_order_relaxed);
+        for (j = 0; j < CUBETAS_LATENCIA; j = j + 1) sumarRelajado(a.cubetas[i][j], b.cubetas[i][j].load(memory_order_relaxed));
+        for (j = 0; j < RESULTADOS_POR_OPERACION; j = j + 1) {
+            sumarRelajado(a.resultados[i][j], b.resultados[i][j].load(memory_order_relaxed));
         }
-        actual = actual->siguiente;
     }
-    return false;
+    for (i = 0; i < CANTIDAD_CONTADORES_METRICA; i = i + 1) {
+        sumarRelajado(a.contadores[i], b.contadores[i].load(memory_order_relaxed));
+    }
 }
 
-/* Buscar nodo de turno por codigo; devuelve puntero al nodo o NULL si no existe */
-TurnoNodo* buscarTurnoPorCodigo(int codigo) {
-    TurnoNodo *actual = cabezaTurnos;
-    while (actual != NULL) {
-        if (actual->codigo == codigo) return actual;
-        actual = actual->siguiente;
+thread_local MetricasHilo *metricasDeEsteHilo = NULL;
+
+/* Al terminar el hilo su bloque se suma a metricasTerminadas y se libera */
+struct RegistroMetricasHilo {
+    MetricasHilo *metricas;
+    ~RegistroMetricasHilo() {
+        if (metricas == NULL) return;
+        lock_guard<mutex> guarda(candadoMetricas);
+        acumularMetricas(metricasTerminadas, *metricas);
+        MetricasHilo **p = &metricasVivas;
+        while (*p != metricas) p = &(*p)->siguiente;
+        *p = metricas->siguiente;
+        delete metricas;
+        metricasDeEsteHilo = NULL;
+    }
+};
+thread_local RegistroMetricasHilo registroMetricasHilo = { NULL };
+
+/* Bloque del hilo actual (se crea en el primer uso) */
+MetricasHilo &metricasHilo() {
+    if (metricasDeEsteHilo != NULL) return *metricasDeEsteHilo;
+    MetricasHilo *m = new MetricasHilo();
+    {
+        lock_guard<mutex> guarda(candadoMetricas);
+        m->siguiente = metricasVivas;
+        metricasVivas = m;
     }
-    return NULL;
+    registroMetricasHilo.metricas = m;
+    metricasDeEsteHilo = m;
+    return *m;
 }
 
-/* Elimina un nodo de la lista por puntero (se espera la existencia).
-   Si se elimina la cabeza se actualiza cabezaTurnos. */
-void eliminarNodoTurno(TurnoNodo *prev, TurnoNodo *actual) {
-    if (prev == NULL) {
-        /* eliminar la cabeza */
-        cabezaTurnos = actual->siguiente;
-    } else {
-        prev->siguiente = actual->siguiente;
+void sumarContadorMetrica(int contador, unsigned long long cantidad) {
+    sumarRelajado(metricasHilo().contadores[contador], cantidad);
+}
+
+/* Mide desde que se construye hasta que sale del bloque; terminar anota el resultado */
+struct MedicionOperacion {
+    int operacion;
+    int resultado;
+    long long comienzo;
+    MedicionOperacion(int op) : operacion(op), resultado(0), comienzo(nanosegundosMonotonos()) {}
+    int terminar(int r) {
+        resultado = r;
+        return r;
     }
-    delete actual;
+    ~MedicionOperacion() {
+        long long transcurrido = nanosegundosMonotonos() - comienzo;
+        unsigned long long ns = (transcurrido > 0) ? (unsigned long long)transcurrido : 0;
+        MetricasHilo &m = metricasHilo();
+        sumarRelajado(m.llamadas[operacion], 1);
+        sumarRelajado(m.nanosegundos[operacion], ns);
+        if (ns > m.maximo[operacion].load(memory_order_relaxed)) m.maximo[operacion].store(ns, memory_order_relaxed);
+        sumarRelajado(m.cubetas[operacion][cubetaLatencia(ns)], 1);
+        int r = (resultado >= 0 && resultado < RESULTADOS_POR_OPERACION) ? resultado : RESULTADOS_POR_OPERACION - 1;
+        sumarRelajado(m.resultados[operacion][r], 1);
+    }
+};
+
+/* Suma en total (que debe estar en cero) las metricas de todos los hilos */
+void sumarMetricas(MetricasHilo &total) {
+    lock_guard<mutex> guarda(candadoMetricas);
+    acumularMetricas(total, metricasTerminadas);
+    MetricasHilo *m;
+    for (m = metricasVivas; m != NULL; m = m->siguiente) acumularMetricas(total, *m);
 }
+#endif
 
-/* ------- FUNCIONES PARA PACIENTES (ABM) ------- */
+/* ------- FECHAS Y HORAS (calendario civil, sin zona horaria) ------- */
 
-void altaPaciente() {
-    if (cantidadPacientes >= MAX_PACIENTES) {
-        cout << "No se pueden dar mas de alta: alcanzado maximo de pacientes.\n";
-        return;
+/* Valor que devuelven las conversiones cuando la fecha/hora no es valida.
+   No puede ser -1: con años desde 1900 los minutos validos pueden ser negativos. */
+const long MINUTOS_INVALIDOS = -2147483647L - 1;
+
+constexpr bool esBisiesto(int anio) {
+    return (anio % 4 == 0 && anio % 100 != 0) || anio % 400 == 0;
+}
+
+/* Dias del mes sin tabla: los meses de 31 dias son los que cumplen (mes + mes/8) impar */
+constexpr int diasDelMes(int mes, int anio) {
+    return mes == 2 ? 28 + (esBisiesto(anio) ? 1 : 0) : 30 + ((mes + (mes >> 3)) & 1);
+}
+
+/* Valida rangos de hora/minuto, mes, año y el dia segun el mes (incluye 29/02 en bisiestos) */
+constexpr bool fechaHoraValida(int dia, int mes, int anio, int hora, int minuto) {
+    return anio >= ANIO_MINIMO && anio <= ANIO_MAXIMO && mes >= 1 && mes <= 12 &&
+           dia >= 1 && dia <= diasDelMes(mes, anio) &&
+           hora >= 0 && hora <= 23 && minuto >= 0 && minuto <= 59;
+}
+
+/* Conversion civil -> dias (algoritmo days_from_civil de H. Hinnant): los años
+   empiezan en marzo para que el 29/02 quede al final y no haga falta tabla de meses.
+   Solo divisiones por constantes, sin bucles; valido para años >= 1. */
+constexpr int diaDelAnioDesdeMarzo(int dia, int mes) {
+    return (153 * (mes > 2 ? mes - 3 : mes + 9) + 2) / 5 + dia - 1;
+}
+
+constexpr int diaDeLaEra(int anioDeEra, int diaDelAnio) {
+    return anioDeEra * 365 + anioDeEra / 4 - anioDeEra / 100 + diaDelAnio;
+}
+
+constexpr int diasDesdeEpocaMarzo(int anioMarzo, int dia, int mes) {
+    return (anioMarzo / 400) * 146097 + diaDeLaEra(anioMarzo % 400, diaDelAnioDesdeMarzo(dia, mes)) - 719468;
+}
+
+/* Dias transcurridos desde el 1/1/1970 (negativos para fechas anteriores) */
+constexpr int diasDesdeEpoca(int dia, int mes, int anio) {
+    return diasDesdeEpocaMarzo(anio - (mes <= 2 ? 1 : 0), dia, mes);
+}
+
+static_assert(diasDesdeEpoca(1, 1, 1970) == 0, "epoca");
+static_assert(diasDesdeEpoca(1, 3, 2000) == 11017, "bisiesto 2000");
+static_assert(diasDesdeEpoca(1, 1, 1900) == -25567, "año 1900");
+
+/* Convierte fecha/hora a minutos civiles desde 1/1/1970 00:00.
+   Es aritmetica pura: no usa mktime, asi que no toma el lock de zona horaria de libc.
+   Devuelve MINUTOS_INVALIDOS si la fecha u hora no es valida (p. ej. 31/02). */
+long convertirFechaHoraAMinutos(int dia, int mes, int anio, int hora, int minuto) {
+    if (!fechaHoraValida(dia, mes, anio, hora, minuto)) return MINUTOS_INVALIDOS;
+    return (long)diasDesdeEpoca(dia, mes, anio) * 1440L + hora * 60 + minuto;
+}
+
+/* Version por lotes: convierte n fechas dadas como columnas separadas. El cuerpo no tiene
+   saltos (la validez se aplica con una mascara) para que el compilador pueda vectorizarlo.
+   Las posiciones con fecha/hora invalida quedan en MINUTOS_INVALIDOS. La usa la etapa de
+   analisis de --importar para todos los turnos de un bloque. */
+void convertirFechasHorasAMinutos(const int *dias, const int *meses, const int *anios,
+                                  const int *horas, const int *minutos, int *salida, int n) {
+    int i;
+    for (i = 0; i < n; i = i + 1) {
+        int mes = meses[i];
+        int anio = anios[i];
+        int dia = dias[i];
+        int hora = horas[i];
+        int minuto = minutos[i];
+        /* se calcula con cada campo llevado a su rango, asi la cuenta no desborda con
+           ningun valor de entrada; la mascara descarta el resultado si algo estaba fuera */
+        int mesSeguro = (mes >= 1 && mes <= 12) ? mes : 1;
+        int anioSeguro = (anio >= ANIO_MINIMO && anio <= ANIO_MAXIMO) ? anio : ANIO_MINIMO;
+        int diaSeguro = (dia >= 1 && dia <= 31) ? dia : 1;
+        int horaSegura = (hora >= 0 && hora <= 23) ? hora : 0;
+        int minutoSeguro = (minuto >= 0 && minuto <= 59) ? minuto : 0;
+        int anioMarzo = anioSeguro - (mesSeguro <= 2 ? 1 : 0);
+        int calculado = diasDesdeEpocaMarzo(anioMarzo, diaSeguro, mesSeguro) * 1440 + horaSegura * 60 + minutoSeguro;
+        int valido = fechaHoraValida(dia, mes, anio, hora, minuto) ? -1 : 0;
+        salida[i] = (calculado & valido) | ((int)MINUTOS_INVALIDOS & ~valido);
     }
+}
 
-    Paciente nuevo;
-    cout << "Alta de paciente\n";
-    cout << "Apellido: ";
-    cin.getline(nuevo.apellido, 51);
-    if (esVacio(nuevo.apellido)) {
-        cout << "Apellido obligatorio. Alta abortada.\n";
-        return;
+/* Marca de tiempo empaquetada de un turno: minutos civiles desde 1/1/1970 00:00.
+   Es la clave de orden de la agenda. */
+int minutosDeTurno(const Turno *t) {
+    return diasDesdeEpoca(t->dia, t->mes, t->anio) * 1440 + t->hora * 60 + t->minuto;
+}
+
+/* Devuelve los minutos actuales en la misma escala civil que convertirFechaHoraAMinutos
+   (hora local). Se consulta la zona horaria una sola vez por llamada. */
+long minutosActuales() {
+    time_t ahora = time(NULL);
+    struct tm local;
+#if defined(_WIN32)
+    localtime_s(&local, &ahora);
+#else
+    localtime_r(&ahora, &local);
+#endif
+    return convertirFechaHoraAMinutos(local.tm_mday, local.tm_mon + 1, local.tm_year + 1900, local.tm_hour, local.tm_min);
+}
+
+/* Division que redondea hacia abajo tambien para negativos (fechas anteriores a 1970) */
+int divisionPiso(int a, int b) {
+    int q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0))) q = q - 1;
+    return q;
+}
+
+/* Conversion inversa dias -> fecha civil (civil_from_days de H. Hinnant) */
+void fechaDesdeDias(int dias, int &dia, int &mes, int &anio) {
+    int z = dias + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int diaDeEra = z - era * 146097;
+    int anioDeEra = (diaDeEra - diaDeEra / 1460 + diaDeEra / 36524 - diaDeEra / 146096) / 365;
+    int diaDelAnio = diaDeEra - (365 * anioDeEra + anioDeEra / 4 - anioDeEra / 100);
+    int mesMarzo = (5 * diaDelAnio + 2) / 153;
+    dia = diaDelAnio - (153 * mesMarzo + 2) / 5 + 1;
+    mes = mesMarzo < 10 ? mesMarzo + 3 : mesMarzo - 9;
+    anio = anioDeEra + era * 400 + (mes <= 2 ? 1 : 0);
+}
+
+/* Lee una hora del dia "HH:MM" (o solo "HH") y devuelve los minutos desde las 00:00,
+   o -1 si no es valida. Se acepta 24:00 para indicar el fin del dia. */
+int leerHoraDelDia(const char *s) {
+    char *fin;
+    long hora = strtol(s, &fin, 10);
+    long minuto = 0;
+    if (fin == s) return -1;
+    if (*fin == ':') {
+        const char *m = fin + 1;
+        minuto = strtol(m, &fin, 10);
+        if (fin == m) return -1;
     }
+    while (*fin == ' ') fin++;
+    if (*fin != '\0' || hora < 0 || minuto < 0 || minuto > 59) return -1;
+    if (hora * 60 + minuto > 24 * 60) return -1;
+    return (int)(hora * 60 + minuto);
+}
 
-    cout << "Nombre: ";
-    cin.getline(nuevo.nombre, 51);
-    if (esVacio(nuevo.nombre)) {
-        cout << "Nombre obligatorio. Alta abortada.\n";
-        return;
+/* Lee una fecha "dd/mm/aaaa" y deja en dias los dias desde 1/1/1970.
+   Devuelve false si no tiene ese formato o no es una fecha valida. */
+bool leerFecha(const char *s, int &dias) {
+    int dia, mes, anio;
+    char sobra;
+    if (sscanf(s, "%d/%d/%d %c", &dia, &mes, &anio, &sobra) != 3) return false;
+    if (!fechaHoraValida(dia, mes, anio, 0, 0)) return false;
+    dias = diasDesdeEpoca(dia, mes, anio);
+    return true;
+}
+
+/* Escribe en salida (al menos 6 caracteres) los minutos del dia como "HH:MM" */
+void formatearHoraDelDia(int minutos, char *salida) {
+    salida[0] = (char)('0' + minutos / 600);
+    salida[1] = (char)('0' + (minutos / 60) % 10);
+    salida[2] = ':';
+    salida[3] = (char)('0' + (minutos % 60) / 10);
+    salida[4] = (char)('0' + minutos % 10);
+    salida[5] = '\0';
+}
+
+/* El horario tiene que dejar al menos un turno completo dentro del dia */
+bool horarioValido(const HorarioAtencion &h) {
+    return h.inicio >= 0 && h.fin <= 24 * 60 && h.inicio < h.fin &&
+           h.duracion >= DURACION_MINIMA_TURNO && h.duracion <= h.fin - h.inicio &&
+           h.cupo >= 1 && h.cupo <= CUPO_MAXIMO_TURNO;
+}
+
+/* ------- INDICE HASH POR DNI (direccionamiento abierto) ------- */
+
+/* Entrada del indice: copia del DNI, su hash y el valor asociado.
+   valor == -1 indica casilla libre. */
+struct EntradaIndiceDNI {
+    unsigned int hash;
+    int valor;
+    char dni[15];
+};
+
+/* Tabla hash con sondeo lineal. La capacidad es siempre potencia de 2 y se duplica
+   cuando la ocupacion supera el 50%, por lo que la busqueda es O(1) promedio
+   sin importar la cantidad de filas. */
+struct IndiceDNI {
+    EntradaIndiceDNI *entradas;
+    int capacidad;
+    int cantidad;
+};
+
+const int CAPACIDAD_INICIAL_INDICE = 64;
+
+/* DNI -> posicion en el arreglo pacientes[] */
+IndiceDNI indicePacientes = { NULL, 0, 0 };
+
+/* Hash FNV-1a de 32 bits sobre los caracteres del DNI */
+unsigned int hashDNI(const char *dni) {
+    unsigned int h = 2166136261u;
+    int i = 0;
+    while (dni[i] != '\0') {
+        h = (h ^ (unsigned char)dni[i]) * 16777619u;
+        i = i + 1;
     }
+    return h;
+}
 
-    cout << "DNI: ";
-    cin.getline(nuevo.dni, 15);
-    if (esVacio(nuevo.dni)) {
-        cout << "DNI obligatorio. Alta abortada.\n";
-        return;
+/* Reserva una tabla vacia con la capacidad indicada (potencia de 2) */
+void indiceDNIInicializar(IndiceDNI &indice, int capacidad) {
+    int i;
+    indice.entradas = new EntradaIndiceDNI[capacidad];
+    indice.capacidad = capacidad;
+    indice.cantidad = 0;
+    for (i = 0; i < capacidad; i = i + 1) {
+        indice.entradas[i].valor = -1;
     }
-    /* comprobar dni unico */
-    int idxPaciente;
-    if (buscarPacientePorDNI(nuevo.dni, idxPaciente)) {
-        cout << "Ya existe un paciente con ese DNI. Alta abortada.\n";
-        return;
+}
+
+void indiceDNILiberar(IndiceDNI &indice) {
+    delete[] indice.entradas;
+    indice.entradas = NULL;
+    indice.capacidad = 0;
+    indice.cantidad = 0;
+}
+
+/* Devuelve la casilla donde esta (o deberia estar) el DNI */
+int indiceDNICasilla(const IndiceDNI &indice, const char *dni, unsigned int hash) {
+    int mascara = indice.capacidad - 1;
+    int pos = (int)(hash & (unsigned int)mascara);
+    while (indice.entradas[pos].valor != -1) {
+        if (indice.entradas[pos].hash == hash && strcmp(indice.entradas[pos].dni, dni) == 0) {
+            return pos;
+        }
+        pos = (pos + 1) & mascara;
     }
+    return pos;
+}
 
-    cout << "Telefono: ";
-    cin.getline(nuevo.telefono, 21);
-    if (esVacio(nuevo.telefono)) {
-        cout << "Telefono obligatorio. Alta abortada.\n";
-        return;
+/* Duplica la capacidad y reubica todas las entradas ocupadas */
+void indiceDNIRedimensionar(IndiceDNI &indice, int nuevaCapacidad) {
+    EntradaIndiceDNI *viejas = indice.entradas;
+    int capacidadVieja = indice.capacidad;
+    int i;
+    indiceDNIInicializar(indice, nuevaCapacidad);
+    for (i = 0; i < capacidadVieja; i = i + 1) {
+        if (viejas[i].valor != -1) {
+            int pos = indiceDNICasilla(indice, viejas[i].dni, viejas[i].hash);
+            indice.entradas[pos] = viejas[i];
+            indice.cantidad = indice.cantidad + 1;
+        }
     }
+    delete[] viejas;
+}
 
-    /* Guardar en arreglo */
-    pacientes[cantidadPacientes] = nuevo;
-    cantidadPacientes = cantidadPacientes + 1;
-    cout << "Paciente dado de alta correctamente.\n";
+/* Devuelve el valor asociado al DNI o -1 si no esta indexado */
+int indiceDNIBuscar(const IndiceDNI &indice, const char *dni) {
+    if (indice.cantidad == 0) return -1;
+    int pos = indiceDNICasilla(indice, dni, hashDNI(dni));
+    return indice.entradas[pos].valor;
 }
 
-void modificacionPaciente() {
-    char dni[15];
-    cout << "Modificacion de paciente - Ingrese DNI: ";
-    cin.getline(dni, 15);
-    int idx;
-    if (!buscarPacientePorDNI(dni, idx)) {
-        cout << "Paciente no encontrado.\n";
-        return;
+/* Inserta el DNI con su valor; si ya existia, actualiza el valor */
+void indiceDNIInsertar(IndiceDNI &indice, const char *dni, int valor) {
+    if (indice.capacidad == 0) {
+        indiceDNIInicializar(indice, CAPACIDAD_INICIAL_INDICE);
+    } else if ((indice.cantidad + 1) * 2 > indice.capacidad) {
+        indiceDNIRedimensionar(indice, indice.capacidad * 2);
     }
-    cout << "Paciente encontrado: " << pacientes[idx].apellido << ", " << pacientes[idx].nombre << "\n";
-    cout << "1) Modificar nombre\n2) Modificar apellido\n3) Modificar telefono\nElija opcion (1-3): ";
-    char opcion[4];
-    cin.getline(opcion, 4);
+    unsigned int hash = hashDNI(dni);
+    int pos = indiceDNICasilla(indice, dni, hash);
+    if (indice.entradas[pos].valor == -1) {
+        indice.entradas[pos].hash = hash;
+        strncpy(indice.entradas[pos].dni, dni, 14);
+        indice.entradas[pos].dni[14] = '\0';
+        indice.cantidad = indice.cantidad + 1;
+    }
+    indice.entradas[pos].valor = valor;
+}
 
-    if (strcmp(opcion, "1") == 0) {
-        cout << "Nuevo nombre: ";
-        cin.getline(pacientes[idx].nombre, 51);
-    } else if (strcmp(opcion, "2") == 0) {
-        cout << "Nuevo apellido: ";
-        cin.getline(pacientes[idx].apellido, 51);
-    } else if (strcmp(opcion, "3") == 0) {
-        cout << "Nuevo telefono: ";
-        cin.getline(pacientes[idx].telefono, 21);
-    } else {
-        cout << "Opcion invalida.\n";
-        return;
+/* Elimina el DNI con borrado por desplazamiento hacia atras (sin lapidas):
+   las entradas siguientes del mismo cluster se corren para no cortar el sondeo. */
+void indiceDNIEliminar(IndiceDNI &indice, const char *dni) {
+    if (indice.cantidad == 0) return;
+    int mascara = indice.capacidad - 1;
+    int hueco = indiceDNICasilla(indice, dni, hashDNI(dni));
+    if (indice.entradas[hueco].valor == -1) return;
+    int j = hueco;
+    while (true) {
+        j = (j + 1) & mascara;
+        if (indice.entradas[j].valor == -1) break;
+        int ideal = (int)(indice.entradas[j].hash & (unsigned int)mascara);
+        /* si la posicion ideal cae ciclicamente en (hueco, j] la entrada puede quedarse */
+        bool quedarse;
+        if (hueco <= j) {
+            quedarse = (hueco < ideal && ideal <= j);
+        } else {
+            quedarse = (hueco < ideal || ideal <= j);
+        }
+        if (!quedarse) {
+            indice.entradas[hueco] = indice.entradas[j];
+            hueco = j;
+        }
     }
-    cout << "Datos actualizados.\n";
+    indice.entradas[hueco].valor = -1;
+    indice.cantidad = indice.cantidad - 1;
 }
 
-void bajaPaciente() {
-    char dni[15];
-    cout << "Baja de paciente - Ingrese DNI: ";
-    cin.getline(dni, 15);
-    int idx;
-    if (!buscarPacientePorDNI(dni, idx)) {
-        cout << "Paciente no encontrado.\n";
-        return;
+/* Buscar paciente por DNI; si lo encuentra devuelve su índice en arreglo (0..n-1) y true.
+   Si no lo encuentra, devuelve false. Consulta el indice hash: O(1) promedio. */
+bool buscarPacientePorDNI(const char *dni, int &indiceOut) {
+    int idx = indiceDNIBuscar(indicePacientes, dni);
+    if (idx == -1) return false;
+    indiceOut = idx;
+    return true;
+}
+
+/* codigo de especialidad -> posicion en especialidades[] (-1 si no existe) */
+int *posicionPorCodigoEspecialidad = NULL;
+int capacidadPosicionPorCodigoEspecialidad = 0;
+
+/* Buscar especialidad por codigo; devuelve índice si la encuentra. O(1). */
+bool buscarEspecialidadPorCodigo(int codigo, int &indiceOut) {
+    if (codigo < 0 || codigo >= capacidadPosicionPorCodigoEspecialidad) return false;
+    int idx = posicionPorCodigoEspecialidad[codigo];
+    if (idx == -1) return false;
+    indiceOut = idx;
+    return true;
+}
+
+/* ------- TABLA HASH DE ENTEROS Y LISTAS DE SLOTS ------- */
+
+/* Entrada de tabla clave entera -> valor; valor == -1 indica casilla libre */
+struct EntradaTablaEnteros {
+    long long clave;
+    int valor;
+};
+
+/* Misma estrategia que IndiceDNI (sondeo lineal, potencia de 2, ocupacion <= 50%)
+   pero con clave entera de 64 bits; se usa para claves compuestas. */
+struct TablaEnteros {
+    EntradaTablaEnteros *entradas;
+    int capacidad;
+    int cantidad;
+};
+
+/* Mezcla de bits (finalizador de splitmix64) para repartir claves correlativas */
+unsigned int hashEntero(long long clave) {
+    unsigned long long x = (unsigned long long)clave;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x = x ^ (x >> 31);
+    return (unsigned int)x;
+}
+
+void tablaEnterosInicializar(TablaEnteros &tabla, int capacidad) {
+    int i;
+    tabla.entradas = new EntradaTablaEnteros[capacidad];
+    tabla.capacidad = capacidad;
+    tabla.cantidad = 0;
+    for (i = 0; i < capacidad; i = i + 1) {
+        tabla.entradas[i].valor = -1;
     }
-    /* no permitir baja si tiene turnos activos */
-    int activos = contarTurnosActivosPaciente(dni);
-    if (activos > 0) {
-        cout << "No se puede eliminar paciente: posee " << activos << " turno(s) activo(s).\n";
-        return;
+}
+
+void tablaEnterosLiberar(TablaEnteros &tabla) {
+    delete[] tabla.entradas;
+    tabla.entradas = NULL;
+    tabla.capacidad = 0;
+    tabla.cantidad = 0;
+}
+
+int tablaEnterosCasilla(const TablaEnteros &tabla, long long clave) {
+    int mascara = tabla.capacidad - 1;
+    int pos = (int)(hashEntero(clave) & (unsigned int)mascara);
+    while (tabla.entradas[pos].valor != -1 && tabla.entradas[pos].clave != clave) {
+        pos = (pos + 1) & mascara;
     }
-    /* eliminar moviendo elementos del arreglo */
+    return pos;
+}
+
+void tablaEnterosRedimensionar(TablaEnteros &tabla, int nuevaCapacidad) {
+    EntradaTablaEnteros *viejas = tabla.entradas;
+    int capacidadVieja = tabla.capacidad;
     int i;
-    for (i = idx; i < cantidadPacientes - 1; i = i + 1) {
-        pacientes[i] = pacientes[i + 1];
+    tablaEnterosInicializar(tabla, nuevaCapacidad);
+    for (i = 0; i < capacidadVieja; i = i + 1) {
+        if (viejas[i].valor != -1) {
+            tabla.entradas[tablaEnterosCasilla(tabla, viejas[i].clave)] = viejas[i];
+            tabla.cantidad = tabla.cantidad + 1;
+        }
     }
-    cantidadPacientes = cantidadPacientes - 1;
-    cout << "Paciente eliminado correctamente.\n";
+    delete[] viejas;
 }
 
-void listadoPacientesCompleto() {
+/* Prepara la tabla para recibir cantidad claves sin redimensionar en el medio */
+void tablaEnterosReservar(TablaEnteros &tabla, int cantidad) {
+    int capacidad = CAPACIDAD_INICIAL_INDICE;
+    while (capacidad < cantidad * 2) capacidad = capacidad * 2;
+    if (capacidad <= tabla.capacidad) return;
+    if (tabla.capacidad == 0) {
+        tablaEnterosInicializar(tabla, capacidad);
+    } else {
+        tablaEnterosRedimensionar(tabla, capacidad);
+    }
+}
+
+/* Devuelve el valor asociado a la clave o -1 si no existe */
+int tablaEnterosBuscar(const TablaEnteros &tabla, long long clave) {
+    if (tabla.cantidad == 0) return -1;
+    return tabla.entradas[tablaEnterosCasilla(tabla, clave)].valor;
+}
+
+/* Inserta la clave con su valor; si ya existia, actualiza el valor */
+void tablaEnterosInsertar(TablaEnteros &tabla, long long clave, int valor) {
+    if (tabla.capacidad == 0) {
+        tablaEnterosInicializar(tabla, CAPACIDAD_INICIAL_INDICE);
+    } else if ((tabla.cantidad + 1) * 2 > tabla.capacidad) {
+        tablaEnterosRedimensionar(tabla, tabla.capacidad * 2);
+    }
+    int pos = tablaEnterosCasilla(tabla, clave);
+    if (tabla.entradas[pos].valor == -1) {
+        tabla.entradas[pos].clave = clave;
+        tabla.cantidad = tabla.cantidad + 1;
+    }
+    tabla.entradas[pos].valor = valor;
+}
+
+/* Borrado por desplazamiento hacia atras, igual que indiceDNIEliminar */
+void tablaEnterosEliminar(TablaEnteros &tabla, long long clave) {
+    if (tabla.cantidad == 0) return;
+    int mascara = tabla.capacidad - 1;
+    int hueco = tablaEnterosCasilla(tabla, clave);
+    if (tabla.entradas[hueco].valor == -1) return;
+    int j = hueco;
+    while (true) {
+        j = (j + 1) & mascara;
+        if (tabla.entradas[j].valor == -1) break;
+        int ideal = (int)(hashEntero(tabla.entradas[j].clave) & (unsigned int)mascara);
+        bool quedarse;
+        if (hueco <= j) {
+            quedarse = (hueco < ideal && ideal <= j);
+        } else {
+            quedarse = (hueco < ideal || ideal <= j);
+        }
+        if (!quedarse) {
+            tabla.entradas[hueco] = tabla.entradas[j];
+            hueco = j;
+        }
+    }
+    tabla.entradas[hueco].valor = -1;
+    tabla.cantidad = tabla.cantidad - 1;
+}
+
+/* Lista de slots de turnos ordenada en forma ascendente (= orden de alta) */
+struct ListaSlots {
+    int *slots;
+    int cantidad;
+    int capacidad;
+};
+
+/* Inserta el slot manteniendo el orden. Los slots nuevos siempre son mayores
+   que los existentes, asi que el caso comun es un agregado al final. */
+void listaSlotsAgregar(ListaSlots &lista, int slot) {
+    if (lista.cantidad == lista.capacidad) {
+        int nuevaCapacidad = (lista.capacidad == 0) ? 4 : lista.capacidad * 2;
+        int *nuevos = new int[nuevaCapacidad];
+        int i;
+        for (i = 0; i < lista.cantidad; i = i + 1) nuevos[i] = lista.slots[i];
+        delete[] lista.slots;
+        lista.slots = nuevos;
+        lista.capacidad = nuevaCapacidad;
+    }
+    int pos = lista.cantidad;
+    while (pos > 0 && lista.slots[pos - 1] > slot) {
+        lista.slots[pos] = lista.slots[pos - 1];
+        pos = pos - 1;
+    }
+    lista.slots[pos] = slot;
+    lista.cantidad = lista.cantidad + 1;
+}
+
+/* Agrega al final sin mantener orden (para copiar resultados en el orden en que se recorren) */
+void listaSlotsAnexar(ListaSlots &lista, int slot) {
+    if (lista.cantidad == lista.capacidad) {
+        int nuevaCapacidad = (lista.capacidad == 0) ? 16 : lista.capacidad * 2;
+        int *nuevos = new int[nuevaCapacidad];
+        int i;
+        for (i = 0; i < lista.cantidad; i = i + 1) nuevos[i] = lista.slots[i];
+        delete[] lista.slots;
+        lista.slots = nuevos;
+        lista.capacidad = nuevaCapacidad;
+    }
+    lista.slots[lista.cantidad] = slot;
+    lista.cantidad = lista.cantidad + 1;
+}
+
+void listaSlotsLiberar(ListaSlots &lista) {
+    delete[] lista.slots;
+    lista.slots = NULL;
+    lista.cantidad = 0;
+    lista.capacidad = 0;
+}
+
+/* Agranda un arreglo de listas indexado por entero (id de paciente o codigo de
+   especialidad) hasta que incluya la posicion pedida; las nuevas quedan vacias. */
+void asegurarListas(ListaSlots *&listas, int &capacidad, int posicion) {
+    if (posicion < capacidad) return;
+    int nuevaCapacidad = (capacidad == 0) ? 64 : capacidad * 2;
+    while (nuevaCapacidad <= posicion) nuevaCapacidad = nuevaCapacidad * 2;
+    ListaSlots *nuevas = new ListaSlots[nuevaCapacidad];
+    int i;
+    for (i = 0; i < capacidad; i = i + 1) nuevas[i] = listas[i];
+    for (i = capacidad; i < nuevaCapacidad; i = i + 1) {
+        nuevas[i].slots = NULL;
+        nuevas[i].cantidad = 0;
+        nuevas[i].capacidad = 0;
+    }
+    delete[] listas;
+    listas = nuevas;
+    capacidad = nuevaCapacidad;
+}
+
+/* ------- VERSIONES DE TURNOS Y LECTURAS SIN BLOQUEO ------- */
+
+/* Los listados y consultas leen una foto consistente del almacen sin tomar candadoAlmacen
+   durante el recorrido, mientras las altas, reprogramaciones y cancelaciones siguen.
+   - Cada cambio en el almacen publica una version nueva (versionTurnos). Un lector toma la
+     version vigente al empezar y ve el almacen exactamente como estaba en esa version.
+   - Cada slot guarda la version desde la que vale su contenido. Antes de modificar un
+     turno en el lugar, el escritor guarda la imagen anterior en una cadena (historial,
+     la mas nueva primero) y marca el slot EN_ESCRITURA mientras escribe (seqlock).
+   - Si el slot cambio despues de la version del lector, el lector busca en la cadena la
+     primera imagen con desde <= su version; si no hay ninguna, el turno no existia.
+   - Las imagenes viejas y los directorios reemplazados se liberan por epocas: se retiran
+     en la epoca actual y se liberan dos epocas despues, cuando ningun lector que pudiera
+     verlos sigue activo. Un lector solo frena el avance de la epoca, nunca a un escritor.
+   Los escritores (registrarTurno, reprogramarTurno, cancelarTurnoEnSlot) se llaman con
+   candadoAlmacen tomado o en un solo hilo, como antes. */
+const unsigned long long VERSION_EN_ESCRITURA = ~0ULL;
+const int MAX_LECTORES = 64;
+const int RETIROS_POR_INTENTO_EPOCA = 64;
+
+struct VersionTurno {
+    FilaTurno imagen;
+    unsigned long long desde; /* version desde la que valia esta imagen */
+    VersionTurno *siguiente;  /* imagen anterior; puede quedar colgando, ningun lector la sigue */
+};
+
+struct ControlTurno {
+    atomic<unsigned long long> version;  /* version desde la que vale el contenido del slot */
+    atomic<VersionTurno *> historial;
+};
+
+/* Directorio paralelo a bloquesTurnos con el control de cada slot */
+atomic<ControlTurno **> bloquesControl(NULL);
+
+atomic<unsigned long long> versionTurnos(0);
+atomic<int> turnosPublicados(0); /* slots visibles para lectores nuevos */
+
+/* Epocas de liberacion. Cada ranura de lector vale 0 si esta libre o la epoca en la que
+   entro el lector; van en lineas de cache separadas. */
+struct RanuraLector {
+    atomic<unsigned long long> epoca;
+    char relleno[64 - sizeof(atomic<unsigned long long>)];
+};
+RanuraLector ranurasLectores[MAX_LECTORES];
+atomic<unsigned long long> epocaGlobal(1);
+
+enum TipoRetiro {
+    RETIRO_VERSION_TURNO = 1,
+    RETIRO_DIRECTORIO_TURNOS = 2,
+    RETIRO_DIRECTORIO_CONTROL = 3,
+    RETIRO_MAPEO = 4,
+    RETIRO_DIRECTORIO_DNI = 5
+};
+
+struct Retirado {
+    int tipo;
+    void *puntero;
+    long long tam; /* solo para RETIRO_MAPEO */
+};
+
+/* Un balde por epoca (modulo 3); se tocan con candadoAlmacen tomado */
+Retirado *retirados[3] = { NULL, NULL, NULL };
+int cantidadRetirados[3] = { 0, 0, 0 };
+int capacidadRetirados[3] = { 0, 0, 0 };
+int retirosDesdeIntento = 0;
+
+struct LecturaTurnos {
+    int ranura;
+    unsigned long long version;
+    int cantidad; /* slots visibles: 0..cantidad-1 */
+};
+
+struct ClaveDNI;
+void leerFilaEnSlot(int slot, FilaTurno &f);
+void turnoDesdeFila(const FilaTurno &f, Turno &t);
+void desmapearArchivo(char *base, long long tam);
+
+void liberarRetirado(const Retirado &r) {
+    if (r.tipo == RETIRO_VERSION_TURNO) {
+        delete (VersionTurno *)r.puntero;
+    } else if (r.tipo == RETIRO_DIRECTORIO_TURNOS) {
+        delete[] (BloqueTurnos **)r.puntero;
+    } else if (r.tipo == RETIRO_DIRECTORIO_DNI) {
+        delete[] (ClaveDNI **)r.puntero;
+    } else if (r.tipo == RETIRO_DIRECTORIO_CONTROL) {
+        delete[] (ControlTurno **)r.puntero;
+    } else if (r.tipo == RETIRO_MAPEO) {
+        desmapearArchivo((char *)r.puntero, r.tam);
+    }
+}
+
+void liberarBaldeRetirados(int balde) {
+    int i;
+    for (i = 0; i < cantidadRetirados[balde]; i = i + 1) liberarRetirado(retirados[balde][i]);
+    cantidadRetirados[balde] = 0;
+}
+
+/* Avanza la epoca si todos los lectores activos ya la vieron, y libera lo retirado dos
+   epocas atras */
+void intentarAvanzarEpoca() {
+    unsigned long long e = epocaGlobal.load();
+    int i;
+    for (i = 0; i < MAX_LECTORES; i = i + 1) {
+        unsigned long long l = ranurasLectores[i].epoca.load();
+        if (l != 0 && l != e) return;
+    }
+    epocaGlobal.store(e + 1);
+    liberarBaldeRetirados((int)((e + 1) % 3));
+    retirosDesdeIntento = 0;
+}
+
+/* Deja para liberar cuando ningun lector pueda estar usandolo */
+void retirar(int tipo, void *puntero, long long tam) {
+    int balde = (int)(epocaGlobal.load() % 3);
+    if (cantidadRetirados[balde] == capacidadRetirados[balde]) {
+        int nuevaCapacidad = (capacidadRetirados[balde] == 0) ? 256 : capacidadRetirados[balde] * 2;
+        Retirado *nuevos = new Retirado[nuevaCapacidad];
+        int i;
+        for (i = 0; i < cantidadRetirados[balde]; i = i + 1) nuevos[i] = retirados[balde][i];
+        delete[] retirados[balde];
+        retirados[balde] = nuevos;
+        capacidadRetirados[balde] = nuevaCapacidad;
+    }
+    Retirado &r = retirados[balde][cantidadRetirados[balde]];
+    r.tipo = tipo;
+    r.puntero = puntero;
+    r.tam = tam;
+    cantidadRetirados[balde] = cantidadRetirados[balde] + 1;
+    retirosDesdeIntento = retirosDesdeIntento + 1;
+    if (retirosDesdeIntento >= RETIROS_POR_INTENTO_EPOCA) intentarAvanzarEpoca();
+}
+
+/* Libera todo lo retirado sin esperar (al terminar, sin lectores) */
+void liberarRetirados() {
+    int b;
+    for (b = 0; b < 3; b = b + 1) {
+        liberarBaldeRetirados(b);
+        delete[] retirados[b];
+        retirados[b] = NULL;
+        capacidadRetirados[b] = 0;
+    }
+    retirosDesdeIntento = 0;
+}
+
+ControlTurno *controlEnSlot(int slot) {
+    return &bloquesControl.load(memory_order_acquire)[slot >> BITS_TURNOS_POR_BLOQUE][slot & (TURNOS_POR_BLOQUE - 1)];
+}
+
+void reservarControlBloque(int bloque) {
+    ControlTurno **directorio = bloquesControl.load();
+    if (directorio[bloque] != NULL) return;
+    ControlTurno *control = new ControlTurno[TURNOS_POR_BLOQUE];
+    int i;
+    for (i = 0; i < TURNOS_POR_BLOQUE; i = i + 1) {
+        control[i].version.store(0, memory_order_relaxed);
+        control[i].historial.store(NULL, memory_order_relaxed);
+    }
+    directorio[bloque] = control;
+}
+
+/* Version que va a publicar el cambio en curso (los escritores estan serializados) */
+unsigned long long siguienteVersionTurnos() {
+    return versionTurnos.load(memory_order_relaxed) + 1;
+}
+
+/* Hace visible el cambio para los lectores que empiecen desde ahora */
+void publicarVersionTurnos(unsigned long long version) {
+    turnosPublicados.store(cantidadTurnos, memory_order_release);
+    versionTurnos.store(version, memory_order_release);
+}
+
+/* Antes de modificar el turno en el lugar: guarda la imagen actual en el historial y
+   marca el slot en escritura */
+void comenzarEscrituraTurno(int slot) {
+    ControlTurno *c = controlEnSlot(slot);
+    VersionTurno *anterior = new VersionTurno;
+    leerFilaEnSlot(slot, anterior->imagen);
+    anterior->desde = c->version.load(memory_order_relaxed);
+    anterior->siguiente = c->historial.load(memory_order_relaxed);
+    c->historial.store(anterior, memory_order_release);
+    c->version.store(VERSION_EN_ESCRITURA, memory_order_release);
+    atomic_thread_fence(memory_order_release);
+}
+
+/* Cierra la escritura: el slot vale desde version y la imagen anterior queda retirada
+   (solo la pueden necesitar lectores con version menor, que ya estan activos) */
+void terminarEscrituraTurno(int slot, unsigned long long version) {
+    ControlTurno *c = controlEnSlot(slot);
+    c->version.store(version, memory_order_release);
+    publicarVersionTurnos(version);
+    retirar(RETIRO_VERSION_TURNO, c->historial.load(memory_order_relaxed), 0);
+}
+
+/* Toma una foto del almacen. Si se llama con candadoAlmacen tomado, la foto coincide
+   ademas con el estado de los indices globales en ese momento (y con los de una
+   especialidad si tambien se tiene su franja). */
+void iniciarLecturaTurnos(LecturaTurnos &l) {
+    int i = 0;
+    while (true) {
+        unsigned long long libre = 0;
+        unsigned long long e = epocaGlobal.load();
+        if (ranurasLectores[i].epoca.compare_exchange_strong(libre, e)) break;
+        i = i + 1;
+        if (i == MAX_LECTORES) {
+            i = 0;
+            this_thread::yield();
+        }
+    }
+    /* si la epoca avanzo mientras tanto, anunciar la nueva */
+    unsigned long long e = epocaGlobal.load();
+    while (ranurasLectores[i].epoca.load() != e) {
+        ranurasLectores[i].epoca.store(e);
+        e = epocaGlobal.load();
+    }
+    l.ranura = i;
+    l.version = versionTurnos.load(memory_order_acquire);
+    l.cantidad = turnosPublicados.load(memory_order_acquire);
+}
+
+void terminarLecturaTurnos(LecturaTurnos &l) {
+    ranurasLectores[l.ranura].epoca.store(0);
+    l.ranura = -1;
+}
+
+/* Copia en salida la fila del slot tal como estaba en la version de la lectura.
+   Devuelve false si en esa version el turno todavia no existia. */
+bool leerFilaVisible(const LecturaTurnos &l, int slot, FilaTurno &salida) {
+    ControlTurno *c = controlEnSlot(slot);
+    unsigned long long v1 = c->version.load(memory_order_acquire);
+    if (v1 != VERSION_EN_ESCRITURA && v1 <= l.version) {
+        leerFilaEnSlot(slot, salida);
+        atomic_thread_fence(memory_order_acquire);
+        if (c->version.load(memory_order_acquire) == v1) return true;
+    }
+    VersionTurno *anterior = c->historial.load(memory_order_acquire);
+    while (anterior != NULL) {
+        if (anterior->desde <= l.version) {
+            salida = anterior->imagen;
+            return true;
+        }
+        anterior = anterior->siguiente;
+    }
+    return false;
+}
+
+/* Igual que leerFilaVisible pero devuelve el turno completo (fecha y DNI convertidos) */
+bool leerTurnoVisible(const LecturaTurnos &l, int slot, Turno &salida) {
+    FilaTurno f;
+    if (!leerFilaVisible(l, slot, f)) return false;
+    turnoDesdeFila(f, salida);
+    return true;
+}
+
+/* ------- HEAP DE DNIS DE TURNOS ------- */
+
+/* Cada DNI que aparece en un turno se guarda una sola vez en el heap y recibe un id
+   (0, 1, 2...) que no cambia, aunque el paciente se dé de baja: los turnos cancelados
+   siguen asociados a ese DNI. Las columnas de turnos guardan el id. El heap crece por
+   bloques que no se mueven, como el almacen, y un DNI no cambia una vez escrito: los
+   lectores sin candado lo leen mientras se agregan otros. */
+const int BITS_DNIS_POR_BLOQUE = 10;
+const int DNIS_POR_BLOQUE = 1 << BITS_DNIS_POR_BLOQUE;
+
+struct ClaveDNI {
+    char dni[16];
+};
+
+atomic<ClaveDNI **> bloquesDNI(NULL);
+int capacidadBloquesDNI = 0;
+int cantidadIdsDNI = 0;
+
+/* DNI -> id, para internar y para las consultas por paciente */
+IndiceDNI idsDNI = { NULL, 0, 0 };
+
+/* DNI guardado para el id (0..cantidadIdsDNI-1) */
+const char *dniDeId(int id) {
+    return bloquesDNI.load(memory_order_acquire)[id >> BITS_DNIS_POR_BLOQUE][id & (DNIS_POR_BLOQUE - 1)].dni;
+}
+
+/* Devuelve el id del DNI o -1 si no es de un paciente ni aparece en un turno */
+int idDeDNI(const char *dni) {
+    return indiceDNIBuscar(idsDNI, dni);
+}
+
+/* Devuelve el id del DNI, asignando uno nuevo si es la primera vez que aparece.
+   Se llama con candadoAlmacen tomado o en un solo hilo. Cada paciente recibe su id al
+   darse de alta (con candadoCatalogo exclusivo), asi las reservas, que ya comprobaron que
+   el paciente existe, solo buscan y pueden leer el indice con la franja tomada. */
+int internarDNI(const char *dni) {
+    int id = indiceDNIBuscar(idsDNI, dni);
+    if (id != -1) return id;
+    id = cantidadIdsDNI;
+    int bloque = id >> BITS_DNIS_POR_BLOQUE;
+    if (bloque >= capacidadBloquesDNI) {
+        /* el directorio viejo se retira: puede haber lectores usandolo */
+        int nuevaCapacidad = (capacidadBloquesDNI == 0) ? 16 : capacidadBloquesDNI * 2;
+        ClaveDNI **nuevos = new ClaveDNI*[nuevaCapacidad];
+        ClaveDNI **viejos = bloquesDNI.load();
+        int i;
+        for (i = 0; i < capacidadBloquesDNI; i = i + 1) nuevos[i] = viejos[i];
+        for (i = capacidadBloquesDNI; i < nuevaCapacidad; i = i + 1) nuevos[i] = NULL;
+        bloquesDNI.store(nuevos, memory_order_release);
+        if (viejos != NULL) retirar(RETIRO_DIRECTORIO_DNI, viejos, 0);
+        capacidadBloquesDNI = nuevaCapacidad;
+    }
+    ClaveDNI **directorio = bloquesDNI.load();
+    if (directorio[bloque] == NULL) directorio[bloque] = new ClaveDNI[DNIS_POR_BLOQUE];
+    ClaveDNI &clave = directorio[bloque][id & (DNIS_POR_BLOQUE - 1)];
+    memset(clave.dni, 0, sizeof(clave.dni));
+    copiarCampo(clave.dni, dni, sizeof(((Turno *)0)->pacienteDNI));
+    indiceDNIInsertar(idsDNI, clave.dni, id);
+    cantidadIdsDNI = cantidadIdsDNI + 1;
+    return id;
+}
+
+void liberarHeapDNIs() {
+    int i;
+    ClaveDNI **directorio = bloquesDNI.load();
+    for (i = 0; i < capacidadBloquesDNI; i = i + 1) delete[] directorio[i];
+    delete[] directorio;
+    bloquesDNI = NULL;
+    capacidadBloquesDNI = 0;
+    cantidadIdsDNI = 0;
+    indiceDNILiberar(idsDNI);
+}
+
+/* ------- ALMACEN DE TURNOS ------- */
+
+BloqueTurnos *bloqueDeSlot(int slot) {
+    return bloquesTurnos.load(memory_order_acquire)[slot >> BITS_TURNOS_POR_BLOQUE];
+}
+
+/* Lectura de una sola columna del turno guardado en el slot (0..cantidadTurnos-1) */
+int codigoEnSlot(int slot) {
+    return bloqueDeSlot(slot)->codigo[slot & (TURNOS_POR_BLOQUE - 1)];
+}
+
+int minutosEnSlot(int slot) {
+    return bloqueDeSlot(slot)->minutos[slot & (TURNOS_POR_BLOQUE - 1)];
+}
+
+int pacienteEnSlot(int slot) {
+    return bloqueDeSlot(slot)->paciente[slot & (TURNOS_POR_BLOQUE - 1)];
+}
+
+int especialidadEnSlot(int slot) {
+    return bloqueDeSlot(slot)->especialidad[slot & (TURNOS_POR_BLOQUE - 1)];
+}
+
+int estadoEnSlot(int slot) {
+    return bloqueDeSlot(slot)->estado[slot & (TURNOS_POR_BLOQUE - 1)];
+}
+
+/* Junta las columnas del slot en una fila */
+void leerFilaEnSlot(int slot, FilaTurno &f) {
+    BloqueTurnos *b = bloqueDeSlot(slot);
+    int i = slot & (TURNOS_POR_BLOQUE - 1);
+    f.codigo = b->codigo[i];
+    f.minutos = b->minutos[i];
+    f.paciente = b->paciente[i];
+    f.especialidad = b->especialidad[i];
+    f.estado = b->estado[i];
+}
+
+/* Arma el turno completo de una fila: desempaqueta fecha y hora y busca el DNI en el heap */
+void turnoDesdeFila(const FilaTurno &f, Turno &t) {
+    int dias = divisionPiso(f.minutos, 1440);
+    int minutoDelDia = f.minutos - dias * 1440;
+    t.codigo = f.codigo;
+    fechaDesdeDias(dias, t.dia, t.mes, t.anio);
+    t.hora = minutoDelDia / 60;
+    t.minuto = minutoDelDia % 60;
+    memcpy(t.pacienteDNI, dniDeId(f.paciente), sizeof(t.pacienteDNI));
+    t.codigoEspecialidad = f.especialidad;
+    t.estado = f.estado;
+}
+
+/* Turno completo del slot (con candadoAlmacen tomado o en un solo hilo) */
+void leerTurnoEnSlot(int slot, Turno &t) {
+    FilaTurno f;
+    leerFilaEnSlot(slot, f);
+    turnoDesdeFila(f, t);
+}
+
+/* Agranda el directorio de bloques (y el de control) para que incluya la posicion pedida,
+   sin reservar el bloque. Los directorios viejos se retiran: puede haber lectores usandolos. */
+void asegurarDirectorioTurnos(int bloque) {
+    if (bloque < capacidadBloquesTurnos) return;
+    int nuevaCapacidad = (capacidadBloquesTurnos == 0) ? 16 : capacidadBloquesTurnos * 2;
+    while (nuevaCapacidad <= bloque) nuevaCapacidad = nuevaCapacidad * 2;
+    BloqueTurnos **nuevos = new BloqueTurnos*[nuevaCapacidad];
+    ControlTurno **nuevosControl = new ControlTurno*[nuevaCapacidad];
+    BloqueTurnos **viejos = bloquesTurnos.load();
+    ControlTurno **viejosControl = bloquesControl.load();
+    int i;
+    for (i = 0; i < capacidadBloquesTurnos; i = i + 1) {
+        nuevos[i] = viejos[i];
+        nuevosControl[i] = viejosControl[i];
+    }
+    for (i = capacidadBloquesTurnos; i < nuevaCapacidad; i = i + 1) {
+        nuevos[i] = NULL;
+        nuevosControl[i] = NULL;
+    }
+    bloquesTurnos.store(nuevos, memory_order_release);
+    bloquesControl.store(nuevosControl, memory_order_release);
+    if (viejos != NULL) retirar(RETIRO_DIRECTORIO_TURNOS, viejos, 0);
+    if (viejosControl != NULL) retirar(RETIRO_DIRECTORIO_CONTROL, viejosControl, 0);
+    capacidadBloquesTurnos = nuevaCapacidad;
+}
+
+/* Registra codigo -> slot agrandando la tabla de codigos si hace falta */
+void registrarCodigoTurno(int codigo, int slot) {
+    if (codigo >= capacidadSlotPorCodigo) {
+        int nuevaCapacidad = (capacidadSlotPorCodigo == 0) ? 1024 : capacidadSlotPorCodigo * 2;
+        while (nuevaCapacidad <= codigo) nuevaCapacidad = nuevaCapacidad * 2;
+        int *nuevos = new int[nuevaCapacidad];
+        int i;
+        for (i = 0; i < capacidadSlotPorCodigo; i = i + 1) nuevos[i] = slotPorCodigo[i];
+        for (i = capacidadSlotPorCodigo; i < nuevaCapacidad; i = i + 1) nuevos[i] = -1;
+        delete[] slotPorCodigo;
+        slotPorCodigo = nuevos;
+        capacidadSlotPorCodigo = nuevaCapacidad;
+    }
+    slotPorCodigo[codigo] = slot;
+}
+
+/* Agrega el turno al final del almacen, repartido en las columnas, y registra su codigo.
+   Devuelve el slot asignado. Si el bloque actual esta lleno se reserva uno nuevo; los
+   anteriores no se mueven. */
+int agregarTurno(const Turno &t) {
+    int slot = cantidadTurnos;
+    int bloque = slot >> BITS_TURNOS_POR_BLOQUE;
+    asegurarDirectorioTurnos(bloque);
+    if (bloquesTurnos[bloque] == NULL) {
+        bloquesTurnos[bloque] = new BloqueTurnos(); /* en cero: el snapshot guarda el bloque entero */
+    }
+    reservarControlBloque(bloque);
+    BloqueTurnos *b = bloquesTurnos[bloque];
+    int i = slot & (TURNOS_POR_BLOQUE - 1);
+    b->codigo[i] = t.codigo;
+    b->minutos[i] = minutosDeTurno(&t);
+    b->paciente[i] = internarDNI(t.pacienteDNI);
+    b->especialidad[i] = t.codigoEspecialidad;
+    b->estado[i] = (unsigned char)t.estado;
+    registrarCodigoTurno(t.codigo, slot);
+    cantidadTurnos = cantidadTurnos + 1;
+    return slot;
+}
+
+/* Libera todos los bloques del almacen, la tabla de codigos y el heap de DNIs.
+   Los bloques que apuntan al snapshot mapeado no se liberan aca (ver desmapearSnapshot). */
+void liberarTurnos() {
+    int i;
+    for (i = bloquesTurnosMapeados; i < capacidadBloquesTurnos; i = i + 1) {
+        delete bloquesTurnos[i];
+    }
+    for (i = 0; i < capacidadBloquesTurnos; i = i + 1) {
+        delete[] bloquesControl.load()[i];
+    }
+    delete[] bloquesTurnos;
+    delete[] bloquesControl;
+    delete[] slotPorCodigo;
+    bloquesTurnos = NULL;
+    bloquesControl = NULL;
+    turnosPublicados = 0;
+    slotPorCodigo = NULL;
+    capacidadBloquesTurnos = 0;
+    capacidadSlotPorCodigo = 0;
+    cantidadTurnos = 0;
+    bloquesTurnosMapeados = 0;
+    liberarHeapDNIs();
+}
+
+/* Slot del turno con ese codigo o -1 si no existe. O(1) por la tabla de codigos. */
+int slotDeTurno(int codigo) {
+    if (codigo < 1 || codigo >= capacidadSlotPorCodigo) return -1;
+    return slotPorCodigo[codigo];
+}
+
+/* ------- AGENDA ORDENADA POR FECHA Y HORA ------- */
+
+/* Indice ordenado por marca de tiempo. En lugar de un arbol, los turnos se agrupan
+   por dia calendario (los dias son enteros consecutivos): cada dia guarda sus turnos
+   ordenados por (minutos, slot) y cada pagina de 64 dias lleva un mapa de bits de
+   dias ocupados para saltear los vacios de a 64. Ubicar un instante es O(1) + una
+   busqueda binaria dentro del dia, y recorrer un rango cuesta O(k) mas una palabra
+   por cada 64 dias del rango. */
+const int DIAS_POR_PAGINA = 64;
+
+struct EntradaAgenda {
+    int minutos;
+    int slot;
+};
+
+struct DiaAgenda {
+    EntradaAgenda *entradas;
+    int cantidad;
+    int capacidad;
+};
+
+struct PaginaAgenda {
+    unsigned long long ocupados; /* bit i encendido: el dia i de la pagina tiene turnos */
+    DiaAgenda dias[DIAS_POR_PAGINA];
+};
+
+/* Directorio de paginas contiguas a partir de primeraPagina; NULL = pagina sin turnos */
+struct Agenda {
+    PaginaAgenda **paginas;
+    int primeraPagina;
+    int cantidadPaginas;
+    int cantidadEntradas;
+};
+
+/* Agenda de todos los turnos y una por especialidad (indexada por codigo) */
+Agenda agendaTurnos = { NULL, 0, 0, 0 };
+Agenda *agendasPorEspecialidad = NULL;
+int capacidadAgendasPorEspecialidad = 0;
+
+/* Devuelve la pagina que contiene al dia, o NULL si no hay turnos en esa pagina */
+PaginaAgenda* agendaPagina(const Agenda &agenda, int pagina) {
+    int pos = pagina - agenda.primeraPagina;
+    if (agenda.paginas == NULL || pos < 0 || pos >= agenda.cantidadPaginas) return NULL;
+    return agenda.paginas[pos];
+}
+
+/* Devuelve la pagina pedida creandola si hace falta; el directorio crece hacia ambos lados */
+PaginaAgenda* agendaAsegurarPagina(Agenda &agenda, int pagina) {
+    int i;
+    if (agenda.paginas == NULL) {
+        agenda.paginas = new PaginaAgenda*[1];
+        agenda.paginas[0] = NULL;
+        agenda.primeraPagina = pagina;
+        agenda.cantidadPaginas = 1;
+    } else if (pagina < agenda.primeraPagina || pagina >= agenda.primeraPagina + agenda.cantidadPaginas) {
+        int nuevaPrimera = agenda.primeraPagina;
+        int nuevaUltima = agenda.primeraPagina + agenda.cantidadPaginas - 1;
+        /* crecer al menos al doble para que extender el rango sea O(1) amortizado */
+        if (pagina < nuevaPrimera) {
+            nuevaPrimera = pagina;
+            if (nuevaUltima - nuevaPrimera + 1 < agenda.cantidadPaginas * 2) {
+                nuevaPrimera = nuevaUltima + 1 - agenda.cantidadPaginas * 2;
+            }
+        } else {
+            nuevaUltima = pagina;
+            if (nuevaUltima - nuevaPrimera + 1 < agenda.cantidadPaginas * 2) {
+                nuevaUltima = nuevaPrimera + agenda.cantidadPaginas * 2 - 1;
+            }
+        }
+        int nuevaCantidad = nuevaUltima - nuevaPrimera + 1;
+        PaginaAgenda **nuevas = new PaginaAgenda*[nuevaCantidad];
+        for (i = 0; i < nuevaCantidad; i = i + 1) nuevas[i] = NULL;
+        for (i = 0; i < agenda.cantidadPaginas; i = i + 1) {
+            nuevas[agenda.primeraPagina - nuevaPrimera + i] = agenda.paginas[i];
+        }
+        delete[] agenda.paginas;
+        agenda.paginas = nuevas;
+        agenda.primeraPagina = nuevaPrimera;
+        agenda.cantidadPaginas = nuevaCantidad;
+    }
+    PaginaAgenda *&p = agenda.paginas[pagina - agenda.primeraPagina];
+    if (p == NULL) {
+        p = new PaginaAgenda;
+        p->ocupados = 0;
+        for (i = 0; i < DIAS_POR_PAGINA; i = i + 1) {
+            p->dias[i].entradas = NULL;
+            p->dias[i].cantidad = 0;
+            p->dias[i].capacidad = 0;
+        }
+    }
+    return p;
+}
+
+/* Primera posicion del dia cuya entrada es >= (minutos, slot) */
+int diaAgendaPosicion(const DiaAgenda &d, int minutos, int slot) {
+    int desde = 0;
+    int hasta = d.cantidad;
+    while (desde < hasta) {
+        int medio = (desde + hasta) / 2;
+        const EntradaAgenda &e = d.entradas[medio];
+        if (e.minutos < minutos || (e.minutos == minutos && e.slot < slot)) {
+            desde = medio + 1;
+        } else {
+            hasta = medio;
+        }
+    }
+    return desde;
+}
+
+/* Devuelve el dia de la agenda que corresponde a minutos, con lugar para una entrada mas,
+   y lo marca como ocupado */
+DiaAgenda& agendaReservarEnDia(Agenda &agenda, int minutos) {
+    int dia = divisionPiso(minutos, 1440);
+    int pagina = divisionPiso(dia, DIAS_POR_PAGINA);
+    int enPagina = dia - pagina * DIAS_POR_PAGINA;
+    PaginaAgenda *p = agendaAsegurarPagina(agenda, pagina);
+    DiaAgenda &d = p->dias[enPagina];
+    if (d.cantidad == d.capacidad) {
+        int nuevaCapacidad = (d.capacidad == 0) ? 4 : d.capacidad * 2;
+        EntradaAgenda *nuevas = new EntradaAgenda[nuevaCapacidad];
+        int i;
+        for (i = 0; i < d.cantidad; i = i + 1) nuevas[i] = d.entradas[i];
+        delete[] d.entradas;
+        d.entradas = nuevas;
+        d.capacidad = nuevaCapacidad;
+    }
+    p->ocupados = p->ocupados | (1ULL << enPagina);
+    agenda.cantidadEntradas = agenda.cantidadEntradas + 1;
+    return d;
+}
+
+void agendaInsertar(Agenda &agenda, int minutos, int slot) {
+    DiaAgenda &d = agendaReservarEnDia(agenda, minutos);
+    int pos = diaAgendaPosicion(d, minutos, slot);
+    int i;
+    for (i = d.cantidad; i > pos; i = i - 1) {
+        d.entradas[i] = d.entradas[i - 1];
+    }
+    d.entradas[pos].minutos = minutos;
+    d.entradas[pos].slot = slot;
+    d.cantidad = d.cantidad + 1;
+}
+
+/* Carga masiva: agrega al final del dia sin mantener el orden.
+   Despues de la carga hay que llamar a agendaOrdenar. */
+void agendaAgregarSinOrden(Agenda &agenda, int minutos, int slot) {
+    DiaAgenda &d = agendaReservarEnDia(agenda, minutos);
+    d.entradas[d.cantidad].minutos = minutos;
+    d.entradas[d.cantidad].slot = slot;
+    d.cantidad = d.cantidad + 1;
+}
+
+int compararEntradasAgenda(const void *a, const void *b) {
+    const EntradaAgenda *x = (const EntradaAgenda *)a;
+    const EntradaAgenda *y = (const EntradaAgenda *)b;
+    if (x->minutos != y->minutos) return (x->minutos < y->minutos) ? -1 : 1;
+    if (x->slot != y->slot) return (x->slot < y->slot) ? -1 : 1;
+    return 0;
+}
+
+/* Ordena cada dia una sola vez: n log(k) en total en lugar de un corrimiento por insercion */
+void agendaOrdenar(Agenda &agenda) {
+    int i, j;
+    for (i = 0; i < agenda.cantidadPaginas; i = i + 1) {
+        if (agenda.paginas[i] == NULL) continue;
+        for (j = 0; j < DIAS_POR_PAGINA; j = j + 1) {
+            DiaAgenda &d = agenda.paginas[i]->dias[j];
+            if (d.cantidad > 1) qsort(d.entradas, d.cantidad, sizeof(EntradaAgenda), compararEntradasAgenda);
+        }
+    }
+}
+
+void agendaQuitar(Agenda &agenda, int minutos, int slot) {
+    int dia = divisionPiso(minutos, 1440);
+    int pagina = divisionPiso(dia, DIAS_POR_PAGINA);
+    int enPagina = dia - pagina * DIAS_POR_PAGINA;
+    PaginaAgenda *p = agendaPagina(agenda, pagina);
+    if (p == NULL) return;
+    DiaAgenda &d = p->dias[enPagina];
+    int pos = diaAgendaPosicion(d, minutos, slot);
+    if (pos >= d.cantidad || d.entradas[pos].minutos != minutos || d.entradas[pos].slot != slot) return;
+    int i;
+    for (i = pos; i < d.cantidad - 1; i = i + 1) {
+        d.entradas[i] = d.entradas[i + 1];
+    }
+    d.cantidad = d.cantidad - 1;
+    if (d.cantidad == 0) {
+        p->ocupados = p->ocupados & ~(1ULL << enPagina);
+    }
+    agenda.cantidadEntradas = agenda.cantidadEntradas - 1;
+}
+
+void agendaLiberar(Agenda &agenda) {
+    int i, j;
+    for (i = 0; i < agenda.cantidadPaginas; i = i + 1) {
+        if (agenda.paginas[i] == NULL) continue;
+        for (j = 0; j < DIAS_POR_PAGINA; j = j + 1) {
+            delete[] agenda.paginas[i]->dias[j].entradas;
+        }
+        delete agenda.paginas[i];
+    }
+    delete[] agenda.paginas;
+    agenda.paginas = NULL;
+    agenda.primeraPagina = 0;
+    agenda.cantidadPaginas = 0;
+    agenda.cantidadEntradas = 0;
+}
+
+/* Indice del bit encendido mas bajo (x != 0) */
+int bitMasBajo(unsigned long long x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while ((x & 1ULL) == 0) {
+        x = x >> 1;
+        n = n + 1;
+    }
+    return n;
+#endif
+}
+
+/* Cursor para recorrer en orden los turnos con minutos en [desde, hasta) */
+struct CursorAgenda {
+    const Agenda *agenda;
+    int dia;      /* dia actual (dias desde epoca) */
+    int posicion; /* proxima entrada a devolver dentro del dia */
+    int hasta;
+    bool agotado;
+};
+
+/* Avanza el cursor al primer dia con turnos >= dia; devuelve false si no quedan */
+bool cursorAgendaBuscarDia(CursorAgenda &c, int dia) {
+    const Agenda &agenda = *c.agenda;
+    int ultimoDia = divisionPiso(c.hasta - 1, 1440);
+    if (agenda.paginas == NULL) return false;
+    int pagina = divisionPiso(dia, DIAS_POR_PAGINA);
+    if (pagina < agenda.primeraPagina) {
+        pagina = agenda.primeraPagina;
+        dia = pagina * DIAS_POR_PAGINA;
+    }
+    while (dia <= ultimoDia && pagina < agenda.primeraPagina + agenda.cantidadPaginas) {
+        PaginaAgenda *p = agenda.paginas[pagina - agenda.primeraPagina];
+        if (p != NULL) {
+            int enPagina = dia - pagina * DIAS_POR_PAGINA;
+            unsigned long long restantes = p->ocupados & (~0ULL << enPagina);
+            if (restantes != 0) {
+                c.dia = pagina * DIAS_POR_PAGINA + bitMasBajo(restantes);
+                c.posicion = 0;
+                return c.dia <= ultimoDia;
+            }
+        }
+        pagina = pagina + 1;
+        dia = pagina * DIAS_POR_PAGINA;
+    }
+    return false;
+}
+
+/* Prepara el cursor en la primera entrada con minutos >= desde */
+void cursorAgendaIniciar(CursorAgenda &c, const Agenda &agenda, int desde, int hasta) {
+    CONTAR_METRICA(CONTADOR_RECORRIDOS_AGENDA, 1);
+    c.agenda = &agenda;
+    c.hasta = hasta;
+    c.dia = 0;
+    c.posicion = 0;
+    c.agotado = (desde >= hasta || !cursorAgendaBuscarDia(c, divisionPiso(desde, 1440)));
+    if (c.agotado) return;
+    int pagina = divisionPiso(c.dia, DIAS_POR_PAGINA);
+    const DiaAgenda &d = agenda.paginas[pagina - agenda.primeraPagina]->dias[c.dia - pagina * DIAS_POR_PAGINA];
+    c.posicion = diaAgendaPosicion(d, desde, -1);
+}
+
+/* Devuelve la siguiente entrada del rango; false cuando no hay mas */
+bool cursorAgendaSiguiente(CursorAgenda &c, EntradaAgenda &salida) {
+    const Agenda &agenda = *c.agenda;
+    while (!c.agotado) {
+        int pagina = divisionPiso(c.dia, DIAS_POR_PAGINA);
+        const DiaAgenda &d = agenda.paginas[pagina - agenda.primeraPagina]->dias[c.dia - pagina * DIAS_POR_PAGINA];
+        if (c.posicion < d.cantidad) {
+            if (d.entradas[c.posicion].minutos >= c.hasta) break;
+            salida = d.entradas[c.posicion];
+            c.posicion = c.posicion + 1;
+            CONTAR_METRICA(CONTADOR_ENTRADAS_AGENDA, 1);
+            return true;
+        }
+        if (!cursorAgendaBuscarDia(c, c.dia + 1)) break;
+    }
+    c.agotado = true;
+    return false;
+}
+
+/* ------- CUPOS POR ESPECIALIDAD (mapas de ocupacion por dia) ------- */
+
+/* Cada especialidad divide su horario de atencion en franjas de horario.duracion minutos.
+   Por cada dia con algun turno se guarda cuantos turnos activos tiene cada franja y un
+   mapa de bits con las franjas que ya no tienen cupo; los dias sin turnos no ocupan
+   lugar (estan libres). Saber si un horario esta disponible es O(1): la tabla hash del
+   dia y un bit. Buscar los proximos horarios libres recorre los mapas de a 64 franjas
+   por palabra. Se leen y modifican con la franja de la especialidad tomada. */
+const int DIAS_BUSQUEDA_CUPOS = 366;
+
+/* Resultados de estadoCupo */
+const int CUPO_LIBRE = 0;
+const int CUPO_COMPLETO = 1;
+const int CUPO_FUERA_DE_HORARIO = 2;
+
+struct CuposEspecialidad {
+    HorarioAtencion horario;
+    int franjas;                   /* franjas por dia; 0 = especialidad sin horario cargado */
+    int palabras;                  /* palabras de 64 bits por dia en completas */
+    TablaEnteros dias;             /* dia (desde la epoca) -> posicion del dia en los arreglos */
+    int cantidadDias;
+    int capacidadDias;
+    int *ocupacion;                /* cantidadDias * franjas: turnos activos en cada franja */
+    unsigned long long *completas; /* cantidadDias * palabras: bit encendido = franja sin cupo */
+};
+
+/* Indexado por codigo de especialidad, como agendasPorEspecialidad */
+CuposEspecialidad *cuposPorEspecialidad = NULL;
+int capacidadCuposPorEspecialidad = 0;
+
+void cuposLiberarEspecialidad(CuposEspecialidad &c) {
+    tablaEnterosLiberar(c.dias);
+    delete[] c.ocupacion;
+    delete[] c.completas;
+    c.ocupacion = NULL;
+    c.completas = NULL;
+    c.cantidadDias = 0;
+    c.capacidadDias = 0;
+    c.franjas = 0;
+    c.palabras = 0;
+}
+
+/* Devuelve los cupos de la especialidad o NULL si no tiene horario cargado */
+CuposEspecialidad *cuposDeEspecialidad(int codigoEsp) {
+    if (codigoEsp < 0 || codigoEsp >= capacidadCuposPorEspecialidad) return NULL;
+    if (cuposPorEspecialidad[codigoEsp].franjas == 0) return NULL;
+    return &cuposPorEspecialidad[codigoEsp];
+}
+
+/* Deja la especialidad con el horario dado y todas sus franjas libres */
+void configurarCupos(int codigoEsp, const HorarioAtencion &horario) {
+    if (codigoEsp >= capacidadCuposPorEspecialidad) {
+        int nuevaCapacidad = (capacidadCuposPorEspecialidad == 0) ? 64 : capacidadCuposPorEspecialidad * 2;
+        while (nuevaCapacidad <= codigoEsp) nuevaCapacidad = nuevaCapacidad * 2;
+        CuposEspecialidad *nuevos = new CuposEspecialidad[nuevaCapacidad];
+        CuposEspecialidad vacio = { { 0, 0, 0, 0 }, 0, 0, { NULL, 0, 0 }, 0, 0, NULL, NULL };
+        int i;
+        for (i = 0; i < capacidadCuposPorEspecialidad; i = i + 1) nuevos[i] = cuposPorEspecialidad[i];
+        for (i = capacidadCuposPorEspecialidad; i < nuevaCapacidad; i = i + 1) nuevos[i] = vacio;
+        delete[] cuposPorEspecialidad;
+        cuposPorEspecialidad = nuevos;
+        capacidadCuposPorEspecialidad = nuevaCapacidad;
+    }
+    CuposEspecialidad &c = cuposPorEspecialidad[codigoEsp];
+    cuposLiberarEspecialidad(c);
+    c.horario = horario;
+    c.franjas = (horario.fin - horario.inicio) / horario.duracion;
+    c.palabras = (c.franjas + 63) / 64;
+}
+
+/* La especialidad se dio de baja: ya no tiene horario */
+void quitarCupos(int codigoEsp) {
+    if (codigoEsp >= 0 && codigoEsp < capacidadCuposPorEspecialidad) {
+        cuposLiberarEspecialidad(cuposPorEspecialidad[codigoEsp]);
+    }
+}
+
+/* Ubica minutos en su dia y en la franja que lo contiene. Devuelve la franja o -1 si cae
+   fuera del horario; con exacto ademas exige que sea el comienzo de la franja. */
+int franjaDeMinutos(const CuposEspecialidad &c, int minutos, int &dia, bool exacto) {
+    dia = divisionPiso(minutos, 1440);
+    int desdeInicio = minutos - dia * 1440 - c.horario.inicio;
+    if (desdeInicio < 0) return -1;
+    int franja = desdeInicio / c.horario.duracion;
+    if (franja >= c.franjas) return -1;
+    if (exacto && desdeInicio % c.horario.duracion != 0) return -1;
+    return franja;
+}
+
+/* Posicion del dia en ocupacion/completas o -1 si no tiene turnos. Con crear agrega
+   el dia, con todas sus franjas libres, si todavia no estaba. */
+int posicionDiaCupos(CuposEspecialidad &c, int dia, bool crear) {
+    int pos = tablaEnterosBuscar(c.dias, dia);
+    if (pos != -1 || !crear) return pos;
+    if (c.cantidadDias == c.capacidadDias) {
+        int nuevaCapacidad = (c.capacidadDias == 0) ? 16 : c.capacidadDias * 2;
+        int *ocupacion = new int[(size_t)nuevaCapacidad * c.franjas];
+        unsigned long long *completas = new unsigned long long[(size_t)nuevaCapacidad * c.palabras];
+        if (c.cantidadDias > 0) {
+            memcpy(ocupacion, c.ocupacion, sizeof(int) * c.cantidadDias * c.franjas);
+            memcpy(completas, c.completas, sizeof(unsigned long long) * c.cantidadDias * c.palabras);
+        }
+        delete[] c.ocupacion;
+        delete[] c.completas;
+        c.ocupacion = ocupacion;
+        c.completas = completas;
+        c.capacidadDias = nuevaCapacidad;
+    }
+    pos = c.cantidadDias;
+    memset(c.ocupacion + (size_t)pos * c.franjas, 0, sizeof(int) * c.franjas);
+    memset(c.completas + (size_t)pos * c.palabras, 0, sizeof(unsigned long long) * c.palabras);
+    tablaEnterosInsertar(c.dias, dia, pos);
+    c.cantidadDias = c.cantidadDias + 1;
+    return pos;
+}
+
+/* Suma (delta 1) o resta (delta -1) un turno activo en la franja que contiene minutos.
+   Los turnos fuera del horario (dados antes de que se cambiara) no ocupan cupo. */
+void actualizarCupo(int codigoEsp, int minutos, int delta) {
+    CuposEspecialidad *c = cuposDeEspecialidad(codigoEsp);
+    if (c == NULL) return;
+    int dia;
+    int franja = franjaDeMinutos(*c, minutos, dia, false);
+    if (franja == -1) return;
+    int pos = posicionDiaCupos(*c, dia, true);
+    int &ocupados = c->ocupacion[(size_t)pos * c->franjas + franja];
+    ocupados = ocupados + delta;
+    unsigned long long &palabra = c->completas[(size_t)pos * c->palabras + (franja >> 6)];
+    unsigned long long bit = 1ULL << (franja & 63);
+    if (ocupados >= c->horario.cupo) palabra = palabra | bit;
+    else palabra = palabra & ~bit;
+}
+
+/* Indica si se puede dar un turno que empieza en minutos: CUPO_LIBRE, CUPO_COMPLETO o
+   CUPO_FUERA_DE_HORARIO (no coincide con el comienzo de una franja). O(1). */
+int estadoCupo(int codigoEsp, int minutos) {
+    CuposEspecialidad *c = cuposDeEspecialidad(codigoEsp);
+    if (c == NULL) return CUPO_FUERA_DE_HORARIO;
+    int dia;
+    int franja = franjaDeMinutos(*c, minutos, dia, true);
+    if (franja == -1) return CUPO_FUERA_DE_HORARIO;
+    int pos = posicionDiaCupos(*c, dia, false);
+    if (pos == -1) return CUPO_LIBRE;
+    unsigned long long palabra = c->completas[(size_t)pos * c->palabras + (franja >> 6)];
+    return ((palabra >> (franja & 63)) & 1ULL) ? CUPO_COMPLETO : CUPO_LIBRE;
+}
+
+/* true si los dos instantes caen en la misma franja de la especialidad (al reprogramar
+   dentro de la misma franja el turno no necesita un lugar nuevo) */
+bool mismaFranja(int codigoEsp, int minutosA, int minutosB) {
+    CuposEspecialidad *c = cuposDeEspecialidad(codigoEsp);
+    if (c == NULL) return false;
+    int diaA;
+    int diaB;
+    int franjaA = franjaDeMinutos(*c, minutosA, diaA, false);
+    int franjaB = franjaDeMinutos(*c, minutosB, diaB, false);
+    return franjaA != -1 && franjaA == franjaB && diaA == diaB;
+}
+
+/* Guarda en minutosSalida el comienzo de las primeras n franjas con cupo que empiezan en
+   desde o despues, mirando hasta DIAS_BUSQUEDA_CUPOS dias hacia adelante. Devuelve la
+   cantidad encontrada. Cada palabra de completas se invierte y se recorren sus bits
+   encendidos, asi una sola operacion descarta 64 franjas completas. */
+int buscarCuposLibres(int codigoEsp, int desde, int n, int *minutosSalida) {
+    CuposEspecialidad *c = cuposDeEspecialidad(codigoEsp);
+    if (c == NULL) return 0;
+    int cantidad = 0;
+    int diaDesde = divisionPiso(desde, 1440);
+    int ultimoDia = diasDesdeEpoca(31, 12, ANIO_MAXIMO);
+    int dia;
+    for (dia = diaDesde; dia < diaDesde + DIAS_BUSQUEDA_CUPOS && dia <= ultimoDia && cantidad < n; dia = dia + 1) {
+        int primera = 0;
+        if (dia == diaDesde) {
+            int desdeInicio = desde - dia * 1440 - c->horario.inicio;
+            if (desdeInicio > 0) primera = (desdeInicio + c->horario.duracion - 1) / c->horario.duracion;
+        }
+        if (primera >= c->franjas) continue;
+        int pos = posicionDiaCupos(*c, dia, false);
+        int w;
+        for (w = primera >> 6; w < c->palabras && cantidad < n; w = w + 1) {
+            int base = w << 6;
+            unsigned long long libres = (pos == -1) ? ~0ULL : ~c->completas[(size_t)pos * c->palabras + w];
+            /* se descartan las franjas anteriores a primera y los bits que pasan del fin del dia */
+            if (base < primera) libres = libres & (~0ULL << (primera - base));
+            if (c->franjas - base < 64) libres = libres & ((1ULL << (c->franjas - base)) - 1);
+            while (libres != 0 && cantidad < n) {
+                int franja = base + bitMasBajo(libres);
+                minutosSalida[cantidad] = dia * 1440 + c->horario.inicio + franja * c->horario.duracion;
+                cantidad = cantidad + 1;
+                libres = libres & (libres - 1);
+            }
+        }
+    }
+    return cantidad;
+}
+
+void liberarCupos() {
+    int i;
+    for (i = 0; i < capacidadCuposPorEspecialidad; i = i + 1) cuposLiberarEspecialidad(cuposPorEspecialidad[i]);
+    delete[] cuposPorEspecialidad;
+    cuposPorEspecialidad = NULL;
+    capacidadCuposPorEspecialidad = 0;
+}
+
+/* ------- INDICES SECUNDARIOS DE TURNOS ------- */
+
+/* Los indices por paciente usan el id del heap de DNIs, el mismo que guardan los turnos */
+
+/* id de DNI -> slots de sus turnos */
+ListaSlots *turnosPorPaciente = NULL;
+int capacidadTurnosPorPaciente = 0;
+
+/* Los turnos por dia y por especialidad se consultan en agendaTurnos y agendasPorEspecialidad */
+
+/* (id de DNI, especialidad) -> slot del turno ACTIVO; hay a lo sumo uno por par. Una tabla
+   por franja de especialidad, protegida por esa franja (ver CONCURRENCIA). */
+TablaEnteros activoPorPacienteEspecialidad[FRANJAS_ESPECIALIDAD];
+
+TablaEnteros &activosDeFranja(int codigoEsp) {
+    return activoPorPacienteEspecialidad[(unsigned int)codigoEsp & (FRANJAS_ESPECIALIDAD - 1)];
+}
+
+/* Contadores de turnos activos, mantenidos en cada alta y cancelacion */
+int *activosPorPaciente = NULL;       /* indexado por id de DNI */
+int capacidadActivosPorPaciente = 0;
+int *activosPorEspecialidad = NULL;   /* indexado por codigo de especialidad */
+int capacidadActivosPorEspecialidad = 0;
+
+/* Agranda un arreglo de contadores hasta que incluya la posicion pedida (los nuevos en 0) */
+void asegurarContadores(int *&contadores, int &capacidad, int posicion) {
+    if (posicion < capacidad) return;
+    int nuevaCapacidad = (capacidad == 0) ? 64 : capacidad * 2;
+    while (nuevaCapacidad <= posicion) nuevaCapacidad = nuevaCapacidad * 2;
+    int *nuevos = new int[nuevaCapacidad];
+    int i;
+    for (i = 0; i < capacidad; i = i + 1) nuevos[i] = contadores[i];
+    for (i = capacidad; i < nuevaCapacidad; i = i + 1) nuevos[i] = 0;
+    delete[] contadores;
+    contadores = nuevos;
+    capacidad = nuevaCapacidad;
+}
+
+/* Clave del par (paciente, especialidad) para la tabla de turnos activos */
+long long clavePacienteEspecialidad(int idDNI, int codigoEsp) {
+    return ((long long)idDNI << 32) | (unsigned int)codigoEsp;
+}
+
+/* Devuelve la agenda de la especialidad, agrandando el arreglo de agendas si hace falta */
+Agenda& agendaDeEspecialidad(int codigoEsp) {
+    if (codigoEsp >= capacidadAgendasPorEspecialidad) {
+        int nuevaCapacidad = (capacidadAgendasPorEspecialidad == 0) ? 64 : capacidadAgendasPorEspecialidad * 2;
+        while (nuevaCapacidad <= codigoEsp) nuevaCapacidad = nuevaCapacidad * 2;
+        Agenda *nuevas = new Agenda[nuevaCapacidad];
+        int i;
+        for (i = 0; i < capacidadAgendasPorEspecialidad; i = i + 1) nuevas[i] = agendasPorEspecialidad[i];
+        for (i = capacidadAgendasPorEspecialidad; i < nuevaCapacidad; i = i + 1) {
+            nuevas[i].paginas = NULL;
+            nuevas[i].primeraPagina = 0;
+            nuevas[i].cantidadPaginas = 0;
+            nuevas[i].cantidadEntradas = 0;
+        }
+        delete[] agendasPorEspecialidad;
+        agendasPorEspecialidad = nuevas;
+        capacidadAgendasPorEspecialidad = nuevaCapacidad;
+    }
+    return agendasPorEspecialidad[codigoEsp];
+}
+
+/* Deja lugar para la especialidad en la agenda y los contadores por especialidad. Se
+   llama al darla de alta, con candadoCatalogo exclusivo: asi una reserva, que solo tiene
+   la franja de su especialidad, nunca agranda un arreglo que otra franja esta leyendo. */
+void reservarIndicesEspecialidad(int codigoEsp) {
+    agendaDeEspecialidad(codigoEsp);
+    asegurarContadores(activosPorEspecialidad, capacidadActivosPorEspecialidad, codigoEsp);
+}
+
+/* Registra el turno en el indice por paciente y su contador (con candadoAlmacen) */
+void indexarTurnoEnPaciente(int slot) {
+    int id = pacienteEnSlot(slot);
+    asegurarListas(turnosPorPaciente, capacidadTurnosPorPaciente, id);
+    listaSlotsAgregar(turnosPorPaciente[id], slot);
+    asegurarContadores(activosPorPaciente, capacidadActivosPorPaciente, id);
+    if (estadoEnSlot(slot) == ESTADO_ACTIVO) activosPorPaciente[id] = activosPorPaciente[id] + 1;
+}
+
+/* Si el turno esta activo lo registra en la tabla (paciente, especialidad), el contador
+   y los cupos de su especialidad (con la franja de la especialidad) */
+void indexarActivoEnEspecialidad(int slot) {
+    int codigoEsp = especialidadEnSlot(slot);
+    asegurarContadores(activosPorEspecialidad, capacidadActivosPorEspecialidad, codigoEsp);
+    if (estadoEnSlot(slot) == ESTADO_ACTIVO) {
+        tablaEnterosInsertar(activosDeFranja(codigoEsp), clavePacienteEspecialidad(pacienteEnSlot(slot), codigoEsp), slot);
+        activosPorEspecialidad[codigoEsp] = activosPorEspecialidad[codigoEsp] + 1;
+        actualizarCupo(codigoEsp, minutosEnSlot(slot), 1);
+    }
+}
+
+/* Registra el turno en todos los indices de su especialidad, agenda incluida */
+void indexarTurnoEnEspecialidad(int slot) {
+    indexarActivoEnEspecialidad(slot);
+    agendaInsertar(agendaDeEspecialidad(especialidadEnSlot(slot)), minutosEnSlot(slot), slot);
+}
+
+/* Indexa de una vez todos los turnos del almacen (despues de cargar datos guardados).
+   Las agendas se llenan sin orden y se ordenan al final, dia por dia. */
+void reconstruirIndicesTurnos() {
+    int slot;
+    int porFranja[FRANJAS_ESPECIALIDAD];
+    int i;
+    for (i = 0; i < FRANJAS_ESPECIALIDAD; i = i + 1) porFranja[i] = 0;
+    for (slot = 0; slot < cantidadTurnos; slot = slot + 1) {
+        if (estadoEnSlot(slot) != ESTADO_ACTIVO) continue;
+        i = (unsigned int)especialidadEnSlot(slot) & (FRANJAS_ESPECIALIDAD - 1);
+        porFranja[i] = porFranja[i] + 1;
+    }
+    for (i = 0; i < FRANJAS_ESPECIALIDAD; i = i + 1) tablaEnterosReservar(activoPorPacienteEspecialidad[i], porFranja[i]);
+    for (slot = 0; slot < cantidadTurnos; slot = slot + 1) {
+        indexarTurnoEnPaciente(slot);
+        indexarActivoEnEspecialidad(slot);
+        int minutos = minutosEnSlot(slot);
+        agendaAgregarSinOrden(agendaTurnos, minutos, slot);
+        agendaAgregarSinOrden(agendaDeEspecialidad(especialidadEnSlot(slot)), minutos, slot);
+    }
+    agendaOrdenar(agendaTurnos);
+    for (i = 0; i < capacidadAgendasPorEspecialidad; i = i + 1) {
+        agendaOrdenar(agendasPorEspecialidad[i]);
+    }
+}
+
+/* Guarda el turno en el almacen, el indice por paciente y la agenda general, y lo publica.
+   Devuelve el slot asignado. Es la parte de un alta que va con candadoAlmacen. */
+int guardarTurno(const Turno &t) {
+    unsigned long long version = siguienteVersionTurnos();
+    int slot = agregarTurno(t);
+    controlEnSlot(slot)->version.store(version, memory_order_relaxed);
+    indexarTurnoEnPaciente(slot);
+    agendaInsertar(agendaTurnos, minutosEnSlot(slot), slot);
+    publicarVersionTurnos(version);
+    return slot;
+}
+
+/* Guarda el turno y lo indexa, sin concurrencia (carga y reproduccion del log).
+   Devuelve el slot asignado. */
+int registrarTurno(const Turno &t) {
+    int slot = guardarTurno(t);
+    indexarTurnoEnEspecialidad(slot);
+    return slot;
+}
+
+/* Cambia los minutos del turno en el almacen y lo mueve en la agenda general
+   (con candadoAlmacen) */
+void reprogramarTurnoEnAlmacen(int slot, int minutosNuevos) {
+    BloqueTurnos *b = bloqueDeSlot(slot);
+    int i = slot & (TURNOS_POR_BLOQUE - 1);
+    agendaQuitar(agendaTurnos, b->minutos[i], slot);
+    unsigned long long version = siguienteVersionTurnos();
+    comenzarEscrituraTurno(slot);
+    b->minutos[i] = minutosNuevos;
+    terminarEscrituraTurno(slot, version);
+    agendaInsertar(agendaTurnos, minutosNuevos, slot);
+}
+
+/* Mueve el turno en la agenda y los cupos de su especialidad (con la franja) */
+void reprogramarTurnoEnEspecialidad(int slot, int minutosViejos, int minutosNuevos) {
+    int codigoEsp = especialidadEnSlot(slot);
+    bool activo = estadoEnSlot(slot) == ESTADO_ACTIVO;
+    agendaQuitar(agendaDeEspecialidad(codigoEsp), minutosViejos, slot);
+    if (activo) actualizarCupo(codigoEsp, minutosViejos, -1);
+    agendaInsertar(agendaDeEspecialidad(codigoEsp), minutosNuevos, slot);
+    if (activo) actualizarCupo(codigoEsp, minutosNuevos, 1);
+}
+
+/* Cambia la fecha/hora de un turno reubicandolo en las agendas */
+void reprogramarTurno(int slot, int dia, int mes, int anio, int hora, int minuto) {
+    int minutosViejos = minutosEnSlot(slot);
+    int minutosNuevos = diasDesdeEpoca(dia, mes, anio) * 1440 + hora * 60 + minuto;
+    reprogramarTurnoEnAlmacen(slot, minutosNuevos);
+    reprogramarTurnoEnEspecialidad(slot, minutosViejos, minutosNuevos);
+}
+
+/* Marca el turno como cancelado en el almacen y lo descuenta del paciente
+   (con candadoAlmacen) */
+void cancelarTurnoEnAlmacen(int slot) {
+    BloqueTurnos *b = bloqueDeSlot(slot);
+    int i = slot & (TURNOS_POR_BLOQUE - 1);
+    int id = b->paciente[i];
+    unsigned long long version = siguienteVersionTurnos();
+    comenzarEscrituraTurno(slot);
+    b->estado[i] = ESTADO_CANCELADO;
+    terminarEscrituraTurno(slot, version);
+    activosPorPaciente[id] = activosPorPaciente[id] - 1;
+}
+
+/* Libera el par (paciente, especialidad), el contador y el cupo del turno cancelado
+   (con la franja de la especialidad) */
+void cancelarTurnoEnEspecialidad(int slot) {
+    int id = pacienteEnSlot(slot);
+    int codigoEsp = especialidadEnSlot(slot);
+    tablaEnterosEliminar(activosDeFranja(codigoEsp), clavePacienteEspecialidad(id, codigoEsp));
+    activosPorEspecialidad[codigoEsp] = activosPorEspecialidad[codigoEsp] - 1;
+    actualizarCupo(codigoEsp, minutosEnSlot(slot), -1);
+}
+
+/* Marca el turno como cancelado y libera el par (paciente, especialidad) */
+void cancelarTurnoEnSlot(int slot) {
+    cancelarTurnoEnAlmacen(slot);
+    cancelarTurnoEnEspecialidad(slot);
+}
+
+/* Carga un horario nuevo en la especialidad y vuelve a contar sus turnos activos,
+   recorriendo su agenda */
+void reconstruirCuposEspecialidad(int codigoEsp, const HorarioAtencion &horario) {
+    configurarCupos(codigoEsp, horario);
+    if (codigoEsp >= capacidadAgendasPorEspecialidad) return;
+    CursorAgenda c;
+    EntradaAgenda e;
+    cursorAgendaIniciar(c, agendasPorEspecialidad[codigoEsp], -2147483647 - 1, 2147483647);
+    while (cursorAgendaSiguiente(c, e)) {
+        if (estadoEnSlot(e.slot) == ESTADO_ACTIVO) actualizarCupo(codigoEsp, e.minutos, 1);
+    }
+}
+
+void liberarIndicesTurnos() {
+    int i;
+    for (i = 0; i < capacidadTurnosPorPaciente; i = i + 1) listaSlotsLiberar(turnosPorPaciente[i]);
+    for (i = 0; i < capacidadAgendasPorEspecialidad; i = i + 1) agendaLiberar(agendasPorEspecialidad[i]);
+    agendaLiberar(agendaTurnos);
+    delete[] turnosPorPaciente;
+    delete[] agendasPorEspecialidad;
+    delete[] activosPorPaciente;
+    delete[] activosPorEspecialidad;
+    activosPorPaciente = NULL;
+    activosPorEspecialidad = NULL;
+    capacidadActivosPorPaciente = 0;
+    capacidadActivosPorEspecialidad = 0;
+    turnosPorPaciente = NULL;
+    agendasPorEspecialidad = NULL;
+    capacidadTurnosPorPaciente = 0;
+    capacidadAgendasPorEspecialidad = 0;
+    for (i = 0; i < FRANJAS_ESPECIALIDAD; i = i + 1) tablaEnterosLiberar(activoPorPacienteEspecialidad[i]);
+}
+
+/* Cuenta turnos activos de un paciente: O(1), lee el contador */
+int contarTurnosActivosPaciente(const char *dni) {
+    int id = idDeDNI(dni);
+    if (id == -1) return 0;
+    return activosPorPaciente[id];
+}
+
+/* Cuenta turnos activos para una especialidad: O(1), lee el contador */
+int contarTurnosActivosEspecialidad(int codigoEsp) {
+    if (codigoEsp < 0 || codigoEsp >= capacidadActivosPorEspecialidad) return 0;
+    return activosPorEspecialidad[codigoEsp];
+}
+
+/* Recalcula desde cero los contadores de activos y la tabla (paciente, especialidad)
+   recorriendo todo el almacen, y los compara con los mantenidos en forma incremental.
+   Devuelve true si coinciden. Pensada para pruebas y diagnostico: la usan el comando
+   "verificar" (ver ejecutarVerificacionIndices) y, en las compilaciones sin NDEBUG, el
+   arranque despues de reproducir el log. Recorre bloque por bloque y solo lee las
+   columnas de estado, paciente y especialidad. */
+bool verificarContadoresActivos() {
+    int *porPaciente = new int[cantidadIdsDNI + 1];
+    int *porEspecialidad = new int[capacidadActivosPorEspecialidad + 1];
+    int activosTotales = 0;
+    bool correcto = true;
+    int i;
+    for (i = 0; i <= cantidadIdsDNI; i = i + 1) porPaciente[i] = 0;
+    for (i = 0; i <= capacidadActivosPorEspecialidad; i = i + 1) porEspecialidad[i] = 0;
+
+    int inicio;
+    for (inicio = 0; inicio < cantidadTurnos && correcto; inicio = inicio + TURNOS_POR_BLOQUE) {
+        const BloqueTurnos *b = bloqueDeSlot(inicio);
+        int enBloque = cantidadTurnos - inicio;
+        if (enBloque > TURNOS_POR_BLOQUE) enBloque = TURNOS_POR_BLOQUE;
+        int j;
+        for (j = 0; j < enBloque; j = j + 1) {
+            if (b->estado[j] != ESTADO_ACTIVO) continue;
+            int id = b->paciente[j];
+            int codigoEsp = b->especialidad[j];
+            if (id < 0 || id >= cantidadIdsDNI || codigoEsp < 0 || codigoEsp >= capacidadActivosPorEspecialidad) {
+                correcto = false;
+                break;
+            }
+            porPaciente[id] = porPaciente[id] + 1;
+            porEspecialidad[codigoEsp] = porEspecialidad[codigoEsp] + 1;
+            if (tablaEnterosBuscar(activosDeFranja(codigoEsp), clavePacienteEspecialidad(id, codigoEsp)) != inicio + j) {
+                correcto = false;
+            }
+            activosTotales = activosTotales + 1;
+        }
+    }
+    for (i = 0; i < cantidadIdsDNI && correcto; i = i + 1) {
+        /* los pacientes que nunca tuvieron turnos pueden quedar fuera de los contadores */
+        int mantenidos = (i < capacidadActivosPorPaciente) ? activosPorPaciente[i] : 0;
+        if (porPaciente[i] != mantenidos) correcto = false;
+    }
+    for (i = 0; i < capacidadActivosPorEspecialidad && correcto; i = i + 1) {
+        if (porEspecialidad[i] != activosPorEspecialidad[i]) correcto = false;
+    }
+    /* cada par activo aparece una sola vez en las tablas */
+    for (i = 0; i < FRANJAS_ESPECIALIDAD; i = i + 1) activosTotales = activosTotales - activoPorPacienteEspecialidad[i].cantidad;
+    if (correcto && activosTotales != 0) correcto = false;
+
+    delete[] porPaciente;
+    delete[] porEspecialidad;
+    return correcto;
+}
+
+/* Comprueba si existe un turno activo para un mismo paciente y misma especialidad: O(1) */
+bool existeTurnoActivoPacienteEspecial(const char *dni, int codigoEsp) {
+    int id = idDeDNI(dni);
+    if (id == -1) return false;
+    return tablaEnterosBuscar(activosDeFranja(codigoEsp), clavePacienteEspecialidad(id, codigoEsp)) != -1;
+}
+
+/* Guarda en slotsSalida (hasta maximo) los turnos con fecha/hora en [desde, hasta), en orden.
+   Devuelve la cantidad copiada. O(log n + k). */
+int turnosEntre(int desde, int hasta, int *slotsSalida, int maximo) {
+    CursorAgenda c;
+    EntradaAgenda e;
+    int cantidad = 0;
+    cursorAgendaIniciar(c, agendaTurnos, desde, hasta);
+    while (cantidad < maximo && cursorAgendaSiguiente(c, e)) {
+        slotsSalida[cantidad] = e.slot;
+        cantidad = cantidad + 1;
+    }
+    return cantidad;
+}
+
+/* Guarda en slotsSalida los proximos n turnos ACTIVOS de la especialidad a partir de desde.
+   Devuelve la cantidad encontrada. */
+int proximosTurnosEspecialidad(int codigoEsp, int desde, int n, int *slotsSalida) {
+    if (codigoEsp < 0 || codigoEsp >= capacidadAgendasPorEspecialidad) return 0;
+    CursorAgenda c;
+    EntradaAgenda e;
+    int cantidad = 0;
+    cursorAgendaIniciar(c, agendasPorEspecialidad[codigoEsp], desde, 2147483647);
+    while (cantidad < n && cursorAgendaSiguiente(c, e)) {
+        if (estadoEnSlot(e.slot) == ESTADO_ACTIVO) {
+            slotsSalida[cantidad] = e.slot;
+            cantidad = cantidad + 1;
+        }
+    }
+    return cantidad;
+}
+
+/* ------- FILTROS VECTORIALES SOBRE COLUMNAS ------- */
+
+/* Consultas sin indice ("cancelados de la especialidad X en marzo") recorren columnas
+   enteras del almacen. Cada predicado se evalua sobre una columna y deja un mapa de
+   seleccion: un bit por slot (bit j de la palabra w = slot w * 64 + j). Los mapas se
+   combinan con Y / O palabra por palabra y al final se recorren los bits encendidos.
+   Los nucleos trabajan de a bloque completo (TURNOS_POR_BLOQUE filas, multiplo de 64)
+   y hay tres versiones: escalar, SSE2 y AVX2. La mejor que soporte el procesador se
+   elige una sola vez, en el primer uso; --benchmark mide cada una con las mismas
+   consultas y compara sus selecciones con las de la escalar. */
+const int PALABRAS_POR_BLOQUE = TURNOS_POR_BLOQUE / 64;
+
+/* Columnas enteras que se pueden filtrar por rango */
+enum ColumnaTurnos {
+    COLUMNA_CODIGO = 1,
+    COLUMNA_MINUTOS = 2,
+    COLUMNA_PACIENTE = 3,
+    COLUMNA_ESPECIALIDAD = 4
+};
+
+enum NivelFiltros {
+    FILTROS_ESCALAR = 0,
+    FILTROS_SSE2 = 1,
+    FILTROS_AVX2 = 2
+};
+
+/* Nucleos: escriben n / 64 palabras de bits (n multiplo de 64) */
+struct NucleosFiltro {
+    int nivel;
+    void (*rangoEnteros)(const int *columna, int n, int minimo, int maximo, unsigned long long *bits);
+    void (*igualBytes)(const unsigned char *columna, int n, unsigned char valor, unsigned long long *bits);
+};
+
+/* minimo <= x <= maximo con una sola comparacion sin signo: x - minimo <= maximo - minimo */
+void rangoEnterosEscalar(const int *columna, int n, int minimo, int maximo, unsigned long long *bits) {
+    unsigned int ancho = (unsigned int)maximo - (unsigned int)minimo;
+    int w;
+    for (w = 0; w < n / 64; w = w + 1) {
+        const int *x = columna + w * 64;
+        unsigned long long palabra = 0;
+        int j;
+        for (j = 0; j < 64; j = j + 1) {
+            palabra |= (unsigned long long)((unsigned int)x[j] - (unsigned int)minimo <= ancho) << j;
+        }
+        bits[w] = palabra;
+    }
+}
+
+void igualBytesEscalar(const unsigned char *columna, int n, unsigned char valor, unsigned long long *bits) {
+    int w;
+    for (w = 0; w < n / 64; w = w + 1) {
+        const unsigned char *x = columna + w * 64;
+        unsigned long long palabra = 0;
+        int j;
+        for (j = 0; j < 64; j = j + 1) {
+            palabra |= (unsigned long long)(x[j] == valor) << j;
+        }
+        bits[w] = palabra;
+    }
+}
+
+#if defined(FILTROS_CON_SSE2)
+/* SSE2 no compara sin signo: se invierte el bit de signo de ambos lados y se compara con signo */
+void rangoEnterosSSE2(const int *columna, int n, int minimo, int maximo, unsigned long long *bits) {
+    const __m128i signo = _mm_set1_epi32((int)0x80000000u);
+    const __m128i base = _mm_set1_epi32(minimo);
+    const __m128i tope = _mm_set1_epi32((int)(((unsigned int)maximo - (unsigned int)minimo) ^ 0x80000000u));
+    int w;
+    for (w = 0; w < n / 64; w = w + 1) {
+        const int *x = columna + w * 64;
+        unsigned long long fuera = 0;
+        int k;
+        for (k = 0; k < 16; k = k + 1) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(x + k * 4));
+            __m128i d = _mm_xor_si128(_mm_sub_epi32(v, base), signo);
+            fuera |= (unsigned long long)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(d, tope))) << (k * 4);
+        }
+        bits[w] = ~fuera;
+    }
+}
+
+void igualBytesSSE2(const unsigned char *columna, int n, unsigned char valor, unsigned long long *bits) {
+    const __m128i buscado = _mm_set1_epi8((char)valor);
+    int w;
+    for (w = 0; w < n / 64; w = w + 1) {
+        const unsigned char *x = columna + w * 64;
+        unsigned long long palabra = 0;
+        int k;
+        for (k = 0; k < 4; k = k + 1) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(x + k * 16));
+            palabra |= (unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, buscado)) << (k * 16);
+        }
+        bits[w] = palabra;
+    }
+}
+#endif
+
+#if defined(FILTROS_CON_AVX2)
+OBJETIVO_AVX2 void rangoEnterosAVX2(const int *columna, int n, int minimo, int maximo, unsigned long long *bits) {
+    const __m256i signo = _mm256_set1_epi32((int)0x80000000u);
+    const __m256i base = _mm256_set1_epi32(minimo);
+    const __m256i tope = _mm256_set1_epi32((int)(((unsigned int)maximo - (unsigned int)minimo) ^ 0x80000000u));
+    int w;
+    for (w = 0; w < n / 64; w = w + 1) {
+        const int *x = columna + w * 64;
+        unsigned long long fuera = 0;
+        int k;
+        for (k = 0; k < 8; k = k + 1) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(x + k * 8));
+            __m256i d = _mm256_xor_si256(_mm256_sub_epi32(v, base), signo);
+            fuera |= (unsigned long long)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(d, tope))) << (k * 8);
+        }
+        bits[w] = ~fuera;
+    }
+}
+
+OBJETIVO_AVX2 void igualBytesAVX2(const unsigned char *columna, int n, unsigned char valor, unsigned long long *bits) {
+    const __m256i buscado = _mm256_set1_epi8((char)valor);
+    int w;
+    for (w = 0; w < n / 64; w = w + 1) {
+        const unsigned char *x = columna + w * 64;
+        unsigned long long bajo = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)x), buscado));
+        unsigned long long alto = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(x + 32)), buscado));
+        bits[w] = bajo | (alto << 32);
+    }
+}
+
+/* AVX2 necesita soporte del procesador y que el sistema guarde los registros de 256 bits */
+bool procesadorConAVX2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+/* Nucleos del nivel pedido, o del mejor disponible por debajo si el procesador no lo soporta */
+NucleosFiltro nucleosDeNivel(int nivel) {
+    NucleosFiltro n = { FILTROS_ESCALAR, rangoEnterosEscalar, igualBytesEscalar };
+    if (nivel == FILTROS_ESCALAR) return n;
+#if defined(FILTROS_CON_SSE2)
+    if (nivel >= FILTROS_SSE2) {
+        n.nivel = FILTROS_SSE2;
+        n.rangoEnteros = rangoEnterosSSE2;
+        n.igualBytes = igualBytesSSE2;
+    }
+#endif
+#if defined(FILTROS_CON_AVX2)
+    if (nivel >= FILTROS_AVX2 && procesadorConAVX2()) {
+        n.nivel = FILTROS_AVX2;
+        n.rangoEnteros = rangoEnterosAVX2;
+        n.igualBytes = igualBytesAVX2;
+    }
+#endif
+    return n;
+}
+
+/* Se elige en el primer uso (inicializacion de estatica local: segura entre hilos) */
+NucleosFiltro &nucleosFiltro() {
+    static NucleosFiltro n = nucleosDeNivel(FILTROS_AVX2);
+    return n;
+}
+
+/* Fuerza un nivel (el benchmark mide y compara cada uno); devuelve el que quedo en uso.
+   Solo con un hilo: los filtros leen nucleosFiltro() sin candados. */
+int elegirNivelFiltros(int nivel) {
+    nucleosFiltro() = nucleosDeNivel(nivel);
+    return nucleosFiltro().nivel;
+}
+
+const char *nombreNivelFiltros(int nivel) {
+    if (nivel == FILTROS_AVX2) return "AVX2";
+    if (nivel == FILTROS_SSE2) return "SSE2";
+    return "escalar";
+}
+
+/* Mapa de seleccion sobre los slots 0..filas-1 */
+struct SeleccionTurnos {
+    unsigned long long *palabras;
+    int filas;
+    int capacidad; /* palabras reservadas */
+};
+
+int contarBits(unsigned long long x) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    while (x != 0) {
+        x = x & (x - 1);
+        n = n + 1;
+    }
+    return n;
+#endif
+}
+
+/* Deja la seleccion lista para filas slots (reservando de a bloques completos, que es
+   lo que escriben los nucleos) */
+void seleccionPreparar(SeleccionTurnos &s, int filas) {
+    int palabras = (filas + TURNOS_POR_BLOQUE - 1) / TURNOS_POR_BLOQUE * PALABRAS_POR_BLOQUE;
+    if (palabras > s.capacidad) {
+        delete[] s.palabras;
+        s.palabras = new unsigned long long[palabras];
+        s.capacidad = palabras;
+    }
+    s.filas = filas;
+}
+
+void seleccionLiberar(SeleccionTurnos &s) {
+    delete[] s.palabras;
+    s.palabras = NULL;
+    s.filas = 0;
+    s.capacidad = 0;
+}
+
+/* Apaga los bits de las filas que no existen (cola del ultimo bloque) */
+void seleccionRecortar(SeleccionTurnos &s) {
+    int palabras = (s.filas + 63) / 64;
+    int usadas = (s.filas + TURNOS_POR_BLOQUE - 1) / TURNOS_POR_BLOQUE * PALABRAS_POR_BLOQUE;
+    if (s.filas % 64 != 0) s.palabras[palabras - 1] &= (1ULL << (s.filas % 64)) - 1;
+    int w;
+    for (w = palabras; w < usadas; w = w + 1) s.palabras[w] = 0;
+}
+
+/* Selecciona los turnos con minimo <= columna <= maximo entre los slots visibles de la
+   lectura. Se llama sin candados: lee las columnas en el lugar, asi un slot que cambio
+   despues de la foto puede salir con su valor nuevo (ver seleccionarCambiados). */
+void seleccionarRango(const LecturaTurnos &l, int columna, int minimo, int maximo, SeleccionTurnos &s) {
+    CONTAR_METRICA(CONTADOR_FILTROS_COLUMNA, 1);
+    CONTAR_METRICA(CONTADOR_FILAS_FILTRADAS, l.cantidad);
+    seleccionPreparar(s, l.cantidad);
+    const NucleosFiltro &n = nucleosFiltro();
+    int inicio;
+    for (inicio = 0; inicio < l.cantidad; inicio = inicio + TURNOS_POR_BLOQUE) {
+        unsigned long long *bits = s.palabras + inicio / 64;
+        if (minimo > maximo) {
+            memset(bits, 0, sizeof(unsigned long long) * PALABRAS_POR_BLOQUE);
+            continue;
+        }
+        const BloqueTurnos *b = bloqueDeSlot(inicio);
+        const int *datos = b->codigo;
+        if (columna == COLUMNA_MINUTOS) datos = b->minutos;
+        else if (columna == COLUMNA_PACIENTE) datos = b->paciente;
+        else if (columna == COLUMNA_ESPECIALIDAD) datos = b->especialidad;
+        n.rangoEnteros(datos, TURNOS_POR_BLOQUE, minimo, maximo, bits);
+    }
+    seleccionRecortar(s);
+}
+
+/* Selecciona los turnos con ese estado (mismas condiciones que seleccionarRango) */
+void seleccionarEstado(const LecturaTurnos &l, int estado, SeleccionTurnos &s) {
+    CONTAR_METRICA(CONTADOR_FILTROS_COLUMNA, 1);
+    CONTAR_METRICA(CONTADOR_FILAS_FILTRADAS, l.cantidad);
+    seleccionPreparar(s, l.cantidad);
+    const NucleosFiltro &n = nucleosFiltro();
+    int inicio;
+    for (inicio = 0; inicio < l.cantidad; inicio = inicio + TURNOS_POR_BLOQUE) {
+        n.igualBytes(bloqueDeSlot(inicio)->estado, TURNOS_POR_BLOQUE, (unsigned char)estado, s.palabras + inicio / 64);
+    }
+    seleccionRecortar(s);
+}
+
+/* Selecciona todos los turnos visibles de la lectura */
+void seleccionarTodos(const LecturaTurnos &l, SeleccionTurnos &s) {
+    seleccionPreparar(s, l.cantidad);
+    int palabras = (s.filas + TURNOS_POR_BLOQUE - 1) / TURNOS_POR_BLOQUE * PALABRAS_POR_BLOQUE;
+    int w;
+    for (w = 0; w < palabras; w = w + 1) s.palabras[w] = ~0ULL;
+    seleccionRecortar(s);
+}
+
+/* Selecciona los slots visibles que cambiaron despues de la foto o se estan escribiendo:
+   sus columnas pueden tener ya el valor nuevo. Va despues de los recorridos de columnas
+   (como la segunda lectura de version del seqlock): si un recorrido vio un valor nuevo,
+   aca se ve la version que lo marco. */
+void seleccionarCambiados(const LecturaTurnos &l, SeleccionTurnos &s) {
+    seleccionPreparar(s, l.cantidad);
+    atomic_thread_fence(memory_order_acquire);
+    int palabras = (l.cantidad + 63) / 64;
+    int w;
+    for (w = 0; w < palabras; w = w + 1) {
+        unsigned long long palabra = 0;
+        int j;
+        for (j = 0; j < 64 && w * 64 + j < l.cantidad; j = j + 1) {
+            if (controlEnSlot(w * 64 + j)->version.load(memory_order_acquire) > l.version) palabra |= 1ULL << j;
+        }
+        s.palabras[w] = palabra;
+    }
+    seleccionRecortar(s);
+}
+
+/* destino = destino Y otra / destino = destino O otra. Si otra cubre menos filas (se
+   tomo antes de nuevas altas) las que le faltan cuentan como no seleccionadas. */
+void seleccionY(SeleccionTurnos &destino, const SeleccionTurnos &otra) {
+    int palabras = (destino.filas + 63) / 64;
+    int comunes = (otra.filas + 63) / 64;
+    int w;
+    for (w = 0; w < palabras; w = w + 1) {
+        destino.palabras[w] = (w < comunes) ? (destino.palabras[w] & otra.palabras[w]) : 0;
+    }
+}
+
+void seleccionO(SeleccionTurnos &destino, const SeleccionTurnos &otra) {
+    int palabras = (destino.filas + 63) / 64;
+    int comunes = (otra.filas + 63) / 64;
+    if (comunes > palabras) comunes = palabras;
+    int w;
+    for (w = 0; w < comunes; w = w + 1) destino.palabras[w] |= otra.palabras[w];
+}
+
+bool seleccionesIguales(const SeleccionTurnos &a, const SeleccionTurnos &b) {
+    if (a.filas != b.filas) return false;
+    int w;
+    for (w = 0; w < (a.filas + 63) / 64; w = w + 1) {
+        if (a.palabras[w] != b.palabras[w]) return false;
+    }
+    return true;
+}
+
+int seleccionContar(const SeleccionTurnos &s) {
+    int total = 0;
+    int w;
+    for (w = 0; w < (s.filas + 63) / 64; w = w + 1) total = total + contarBits(s.palabras[w]);
+    return total;
+}
+
+/* Primer slot seleccionado >= desde, o -1 si no hay mas */
+int seleccionSiguiente(const SeleccionTurnos &s, int desde) {
+    if (desde >= s.filas) return -1;
+    int w = desde / 64;
+    unsigned long long palabra = s.palabras[w] & (~0ULL << (desde % 64));
+    int palabras = (s.filas + 63) / 64;
+    while (palabra == 0) {
+        w = w + 1;
+        if (w >= palabras) return -1;
+        palabra = s.palabras[w];
+    }
+    return w * 64 + bitMasBajo(palabra);
+}
+
+/* Condiciones de una busqueda de turnos, combinadas con Y (las especialidades entre si con O) */
+const int MAX_ESPECIALIDADES_FILTRO = 64;
+
+struct FiltroTurnos {
+    int estado;                 /* 0 = cualquiera */
+    int especialidades[MAX_ESPECIALIDADES_FILTRO];
+    int cantidadEspecialidades; /* 0 = todas */
+    bool porPaciente;
+    int paciente;               /* id de DNI; -1 si el DNI no tiene turnos */
+    int desde;                  /* minutos, ambos extremos incluidos */
+    int hasta;
+};
+
+/* Filtro que acepta todos los turnos */
+void filtroTurnosIniciar(FiltroTurnos &f) {
+    f.estado = 0;
+    f.cantidadEspecialidades = 0;
+    f.porPaciente = false;
+    f.paciente = -1;
+    f.desde = -2147483647 - 1;
+    f.hasta = 2147483647;
+}
+
+void filtroTurnosAgregarEspecialidad(FiltroTurnos &f, int codigo) {
+    if (f.cantidadEspecialidades == MAX_ESPECIALIDADES_FILTRO) return;
+    f.especialidades[f.cantidadEspecialidades] = codigo;
+    f.cantidadEspecialidades = f.cantidadEspecialidades + 1;
+}
+
+bool filaCumpleFiltro(const FilaTurno &fila, const FiltroTurnos &f) {
+    if (f.estado != 0 && fila.estado != f.estado) return false;
+    if (f.porPaciente && fila.paciente != f.paciente) return false;
+    if (fila.minutos < f.desde || fila.minutos > f.hasta) return false;
+    if (f.cantidadEspecialidades == 0) return true;
+    int i;
+    for (i = 0; i < f.cantidadEspecialidades; i = i + 1) {
+        if (fila.especialidad == f.especialidades[i]) return true;
+    }
+    return false;
+}
+
+/* Candidatos del filtro entre los slots visibles de la lectura, sin candados: cada
+   condicion recorre una columna con los filtros vectoriales y al final se agregan los
+   slots que cambiaron despues de la foto. El resultado puede tener de mas; cada candidato
+   se confirma con leerFilaVisible y filaCumpleFiltro. */
+void seleccionarFiltro(const LecturaTurnos &l, const FiltroTurnos &f, SeleccionTurnos &resultado) {
+    SeleccionTurnos condicion = { NULL, 0, 0 };
+    SeleccionTurnos alguna = { NULL, 0, 0 };
+    if (f.estado != 0) seleccionarEstado(l, f.estado, resultado);
+    else seleccionarTodos(l, resultado);
+    if (f.cantidadEspecialidades > 0) {
+        seleccionarRango(l, COLUMNA_ESPECIALIDAD, f.especialidades[0], f.especialidades[0], alguna);
+        int i;
+        for (i = 1; i < f.cantidadEspecialidades; i = i + 1) {
+            seleccionarRango(l, COLUMNA_ESPECIALIDAD, f.especialidades[i], f.especialidades[i], condicion);
+            seleccionO(alguna, condicion);
+        }
+        seleccionY(resultado, alguna);
+    }
+    if (f.porPaciente) {
+        /* un DNI sin turnos no tiene id: rango vacio */
+        if (f.paciente == -1) seleccionarRango(l, COLUMNA_PACIENTE, 0, -1, condicion);
+        else seleccionarRango(l, COLUMNA_PACIENTE, f.paciente, f.paciente, condicion);
+        seleccionY(resultado, condicion);
+    }
+    if (f.desde != -2147483647 - 1 || f.hasta != 2147483647) {
+        seleccionarRango(l, COLUMNA_MINUTOS, f.desde, f.hasta, condicion);
+        seleccionY(resultado, condicion);
+    }
+    seleccionarCambiados(l, condicion);
+    seleccionO(resultado, condicion);
+    seleccionLiberar(condicion);
+    seleccionLiberar(alguna);
+}
+
+/* ------- BUSQUEDA DE PACIENTES POR NOMBRE ------- */
+
+/* Dos busquedas sin conocer el DNI, sobre apellido y nombre normalizados (minusculas y
+   sin acentos, ver normalizarNombre):
+   - Por comienzo: cada paciente tiene una clave "apellido<SEP>nombre" guardada en dos
+     arreglos ordenados, uno por apellido y otro por nombre. Cada arreglo tiene una parte
+     principal y un delta chico, tambien ordenado, donde entran las altas; cuando el delta
+     se llena se funde con la principal. Una consulta es una busqueda binaria en cada parte
+     y un recorrido en orden de los primeros n.
+   - Aproximada: un diccionario de terminos (cada apellido y cada nombre distinto) con
+     listas de terminos por trigrama. Los terminos a distancia de edicion chica de la
+     consulta salen de las listas mas cortas, y sus pacientes de los arreglos ordenados.
+   Una modificacion o una baja no borra entradas: las viejas se reconocen al recorrer
+   (la clave ya no coincide con la ficha) y se descartan al reconstruir, cosa que pasa
+   cuando superan a los pacientes vigentes. Como el resto del catalogo, se modifica con
+   candadoCatalogo exclusivo (o un solo hilo) y se consulta con el de lectura. */
+const int LARGO_NOMBRE_NORMALIZADO = 51;                       /* como Paciente::apellido */
+const int LARGO_CLAVE_NOMBRE = 2 * LARGO_NOMBRE_NORMALIZADO + 1; /* apellido SEP nombre */
+const char SEPARADOR_CLAVE_NOMBRE = '\x01';  /* menor que cualquier caracter normalizado */
+const int TAM_DELTA_NOMBRES = 2048;
+const int MINIMO_VIEJAS_RECONSTRUIR = 1024;
+
+struct EntradaNombre {
+    const char *clave;  /* "apellido<SEP>nombre", en clavesNombres */
+    int posicion;       /* en pacientes[] */
+    int separador;      /* largo del apellido: el nombre empieza en clave + separador + 1 */
+};
+
+struct OrdenNombres {
+    bool porNombre;     /* false: ordena por apellido y nombre; true: por nombre y apellido */
+    EntradaNombre *principal;
+    int cantidadPrincipal;
+    int capacidadPrincipal;
+    EntradaNombre *delta;
+    int cantidadDelta;
+};
+
+OrdenNombres nombresPorApellido = { false, NULL, 0, 0, NULL, 0 };
+OrdenNombres nombresPorNombre = { true, NULL, 0, 0, NULL, 0 };
+
+/* Claves y textos de terminos; se liberan juntos al reconstruir */
+Arena clavesNombres = { NULL, 0, 0, 0, 0 };
+
+/* Diccionario de terminos: hash del texto -> id (ver buscarTerminoNombre) */
+TablaEnteros terminosNombre = { NULL, 0, 0 };
+const char **textoTerminos = NULL;
+int *usosTerminos = NULL;       /* fichas vigentes cuyo apellido o nombre es el termino */
+unsigned char *largoTerminos = NULL;
+int cantidadTerminos = 0;
+int capacidadTerminos = 0;
+
+/* trigrama -> lista de ids de terminos que lo contienen */
+TablaEnteros listaDeTrigrama = { NULL, 0, 0 };
+ListaSlots *terminosPorTrigrama = NULL;
+int cantidadListasTrigrama = 0;
+int capacidadListasTrigrama = 0;
+
+int clavesNombresViejas = 0;
+bool indiceNombresSuspendido = false;
+
+/* Pasa a minusculas, saca acentos (UTF-8: a-y con tilde, dieresis o cedilla, y la enie),
+   junta espacios repetidos y recorta los de los bordes. Los caracteres de control cuentan
+   como espacio, asi ninguno coincide con SEPARADOR_CLAVE_NOMBRE. Devuelve el largo. */
+int normalizarNombre(const char *s, size_t maximo, char *salida) {
+    /* letra sin acento para U+00C0..U+00FF (segundo byte 0x80..0xBF); '-' la deja igual */
+    static const char sinAcento[] = "aaaaaa-ceeeeiiii-nooooo-ouuuuy--aaaaaa-ceeeeiiii-nooooo-ouuuuy-y";
+    size_t largo = largoAcotado(s, maximo);
+    int n = 0;
+    bool espacio = false;
+    size_t i = 0;
+    while (i < largo) {
+        unsigned char c = (unsigned char)s[i];
+        i = i + 1;
+        if (c <= ' ') {
+            espacio = n > 0;
+            continue;
+        }
+        if (espacio) {
+            salida[n] = ' ';
+            n = n + 1;
+            espacio = false;
+        }
+        if (c >= 'A' && c <= 'Z') {
+            salida[n] = (char)(c - 'A' + 'a');
+        } else if (c == 0xC3 && i < largo && (unsigned char)s[i] >= 0x80 && (unsigned char)s[i] <= 0xBF &&
+                   sinAcento[(unsigned char)s[i] - 0x80] != '-') {
+            salida[n] = sinAcento[(unsigned char)s[i] - 0x80];
+            i = i + 1;
+        } else {
+            salida[n] = (char)c;
+        }
+        n = n + 1;
+    }
+    salida[n] = '\0';
+    return n;
+}
+
+/* Clave "apellido<SEP>nombre" normalizada; devuelve el largo del apellido */
+int claveNombre(const char *apellido, const char *nombre, char *clave) {
+    int separador = normalizarNombre(apellido, LARGO_NOMBRE_NORMALIZADO - 1, clave);
+    clave[separador] = SEPARADOR_CLAVE_NOMBRE;
+    normalizarNombre(nombre, LARGO_NOMBRE_NORMALIZADO - 1, clave + separador + 1);
+    return separador;
+}
+
+/* Hash FNV-1a de 64 bits del texto de un termino */
+long long hashTermino(const char *texto) {
+    unsigned long long h = 14695981039346656037ULL;
+    int i = 0;
+    while (texto[i] != '\0') {
+        h = (h ^ (unsigned char)texto[i]) * 1099511628211ULL;
+        i = i + 1;
+    }
+    return (long long)h;
+}
+
+/* Id del termino o -1. Dos textos con el mismo hash siguen con hash + 1. */
+int buscarTerminoNombre(const char *texto) {
+    long long clave = hashTermino(texto);
+    while (true) {
+        int id = tablaEnterosBuscar(terminosNombre, clave);
+        if (id == -1 || strcmp(textoTerminos[id], texto) == 0) return id;
+        clave = clave + 1;
+    }
+}
+
+/* Trigramas distintos del texto con un espacio a cada lado (" ana " -> " an", "ana", "na ");
+   devuelve cuantos dejo en codigos, ordenados */
+int trigramasDeTexto(const char *texto, int largo, long long *codigos) {
+    char relleno[LARGO_CLAVE_NOMBRE + 2];
+    relleno[0] = ' ';
+    memcpy(relleno + 1, texto, largo);
+    relleno[largo + 1] = ' ';
+    int n = 0;
+    int i;
+    for (i = 0; i + 3 <= largo + 2; i = i + 1) {
+        long long codigo = ((long long)(unsigned char)relleno[i] << 16) |
+                           ((long long)(unsigned char)relleno[i + 1] << 8) | (unsigned char)relleno[i + 2];
+        int j = n;
+        while (j > 0 && codigos[j - 1] > codigo) j = j - 1;
+        if (j > 0 && codigos[j - 1] == codigo) continue;
+        memmove(codigos + j + 1, codigos + j, sizeof(long long) * (n - j));
+        codigos[j] = codigo;
+        n = n + 1;
+    }
+    return n;
+}
+
+/* Suma usos al termino; si es nuevo lo agrega al diccionario y a sus listas de trigramas.
+   Devuelve su id (-1 para el texto vacio). */
+int usarTerminoNombre(const char *texto, int usos) {
+    int largo = (int)strlen(texto);
+    if (largo == 0) return -1;
+    int id = buscarTerminoNombre(texto);
+    if (id != -1) {
+        usosTerminos[id] = usosTerminos[id] + usos;
+        return id;
+    }
+    if (cantidadTerminos == capacidadTerminos) {
+        int nuevaCapacidad = (capacidadTerminos == 0) ? 256 : capacidadTerminos * 2;
+        const char **textos = new const char *[nuevaCapacidad];
+        int *contadores = new int[nuevaCapacidad];
+        unsigned char *largos = new unsigned char[nuevaCapacidad];
+        int i;
+        for (i = 0; i < cantidadTerminos; i = i + 1) {
+            textos[i] = textoTerminos[i];
+            contadores[i] = usosTerminos[i];
+            largos[i] = largoTerminos[i];
+        }
+        delete[] textoTerminos;
+        delete[] usosTerminos;
+        delete[] largoTerminos;
+        textoTerminos = textos;
+        usosTerminos = contadores;
+        largoTerminos = largos;
+        capacidadTerminos = nuevaCapacidad;
+    }
+    id = cantidadTerminos;
+    cantidadTerminos = cantidadTerminos + 1;
+    textoTerminos[id] = arenaCopiarCadena(clavesNombres, texto, LARGO_NOMBRE_NORMALIZADO);
+    usosTerminos[id] = usos;
+    largoTerminos[id] = (unsigned char)largo;
+    long long clave = hashTermino(texto);
+    while (tablaEnterosBuscar(terminosNombre, clave) != -1) clave = clave + 1;
+    tablaEnterosInsertar(terminosNombre, clave, id);
+
+    long long codigos[LARGO_NOMBRE_NORMALIZADO + 2];
+    int n = trigramasDeTexto(texto, largo, codigos);
+    int i;
+    for (i = 0; i < n; i = i + 1) {
+        int lista = tablaEnterosBuscar(listaDeTrigrama, codigos[i]);
+        if (lista == -1) {
+            lista = cantidadListasTrigrama;
+            asegurarListas(terminosPorTrigrama, capacidadListasTrigrama, lista);
+            cantidadListasTrigrama = cantidadListasTrigrama + 1;
+            tablaEnterosInsertar(listaDeTrigrama, codigos[i], lista);
+        }
+        listaSlotsAnexar(terminosPorTrigrama[lista], id);
+    }
+    return id;
+}
+
+/* Texto por el que ordena el arreglo: la clave entera o desde el nombre */
+const char *campoDeOrden(const OrdenNombres &orden, const EntradaNombre &e) {
+    return orden.porNombre ? e.clave + e.separador + 1 : e.clave;
+}
+
+int compararEntradasNombre(const OrdenNombres &orden, const EntradaNombre &a, const EntradaNombre &b) {
+    int c;
+    if (orden.porNombre) {
+        c = strcmp(a.clave + a.separador + 1, b.clave + b.separador + 1);
+        if (c != 0) return c;
+    }
+    c = strcmp(a.clave, b.clave);
+    if (c != 0) return c;
+    return a.posicion - b.posicion;
+}
+
+/* Asegura lugar en principal para cantidad entradas, duplicando */
+void asegurarPrincipalNombres(OrdenNombres &orden, int cantidad) {
+    if (cantidad <= orden.capacidadPrincipal) return;
+    int nuevaCapacidad = (orden.capacidadPrincipal == 0) ? 1024 : orden.capacidadPrincipal * 2;
+    while (nuevaCapacidad < cantidad) nuevaCapacidad = nuevaCapacidad * 2;
+    EntradaNombre *nuevas = new EntradaNombre[nuevaCapacidad];
+    if (orden.cantidadPrincipal > 0) memcpy(nuevas, orden.principal, sizeof(EntradaNombre) * orden.cantidadPrincipal);
+    delete[] orden.principal;
+    orden.principal = nuevas;
+    orden.capacidadPrincipal = nuevaCapacidad;
+}
+
+/* Funde el delta con la principal desde el final hacia atras, sin arreglo auxiliar. Cada
+   entrada del delta busca su lugar con una busqueda binaria y lo que queda detras se corre
+   en bloque: una comparacion de cadenas por entrada de la principal costaria un fallo de
+   cache por clave. */
+void fundirDeltaNombres(OrdenNombres &orden) {
+    if (orden.cantidadDelta == 0) return;
+    asegurarPrincipalNombres(orden, orden.cantidadPrincipal + orden.cantidadDelta);
+    int fin = orden.cantidadPrincipal;  /* principal[0..fin) todavia no se movio */
+    int j;
+    for (j = orden.cantidadDelta - 1; j >= 0; j = j - 1) {
+        int bajo = 0;
+        int alto = fin;
+        while (bajo < alto) {
+            int medio = (bajo + alto) / 2;
+            if (compararEntradasNombre(orden, orden.principal[medio], orden.delta[j]) <= 0) {
+                bajo = medio + 1;
+            } else {
+                alto = medio;
+            }
+        }
+        memmove(orden.principal + bajo + j + 1, orden.principal + bajo, sizeof(EntradaNombre) * (fin - bajo));
+        orden.principal[bajo + j] = orden.delta[j];
+        fin = bajo;
+    }
+    orden.cantidadPrincipal = orden.cantidadPrincipal + orden.cantidadDelta;
+    orden.cantidadDelta = 0;
+}
+
+void agregarEntradaNombre(OrdenNombres &orden, const EntradaNombre &e) {
+    if (orden.delta == NULL) orden.delta = new EntradaNombre[TAM_DELTA_NOMBRES];
+    if (orden.cantidadDelta == TAM_DELTA_NOMBRES) fundirDeltaNombres(orden);
+    int bajo = 0;
+    int alto = orden.cantidadDelta;
+    while (bajo < alto) {
+        int medio = (bajo + alto) / 2;
+        if (compararEntradasNombre(orden, orden.delta[medio], e) <= 0) {
+            bajo = medio + 1;
+        } else {
+            alto = medio;
+        }
+    }
+    memmove(orden.delta + bajo + 1, orden.delta + bajo, sizeof(EntradaNombre) * (orden.cantidadDelta - bajo));
+    orden.delta[bajo] = e;
+    orden.cantidadDelta = orden.cantidadDelta + 1;
+}
+
+/* Primera entrada cuyo campo de orden es >= prefijo */
+int limiteInferiorNombres(const OrdenNombres &orden, const EntradaNombre *v, int n, const char *prefijo) {
+    int bajo = 0;
+    int alto = n;
+    while (bajo < alto) {
+        int medio = (bajo + alto) / 2;
+        if (strcmp(campoDeOrden(orden, v[medio]), prefijo) < 0) {
+            bajo = medio + 1;
+        } else {
+            alto = medio;
+        }
+    }
+    return bajo;
+}
+
+/* La entrada corresponde a la ficha actual (no es de antes de una baja o modificacion) */
+bool entradaNombreVigente(const EntradaNombre &e) {
+    const FichaPaciente &f = pacientes[e.posicion];
+    if (f.dni == NULL) return false;
+    char clave[LARGO_CLAVE_NOMBRE];
+    claveNombre(f.apellido, f.nombre, clave);
+    return strcmp(clave, e.clave) == 0;
+}
+
+/* Agrega a salida (que ya tiene cantidad posiciones) las de las entradas vigentes cuyo
+   campo de orden empieza con prefijo (o es igual, si completo), en orden y sin repetir,
+   hasta llegar a n. Devuelve la nueva cantidad. */
+int recorrerNombres(const OrdenNombres &orden, const char *prefijo, bool completo, int *salida, int cantidad, int n) {
+    size_t largo = strlen(prefijo);
+    int i = limiteInferiorNombres(orden, orden.principal, orden.cantidadPrincipal, prefijo);
+    int j = limiteInferiorNombres(orden, orden.delta, orden.cantidadDelta, prefijo);
+    while (cantidad < n) {
+        const EntradaNombre *e;
+        if (i < orden.cantidadPrincipal &&
+            (j >= orden.cantidadDelta || compararEntradasNombre(orden, orden.principal[i], orden.delta[j]) <= 0)) {
+            e = &orden.principal[i];
+            i = i + 1;
+        } else if (j < orden.cantidadDelta) {
+            e = &orden.delta[j];
+            j = j + 1;
+        } else {
+            break;
+        }
+        const char *campo = campoDeOrden(orden, *e);
+        if (strncmp(campo, prefijo, largo) != 0) break;
+        if (completo && campo[largo] != '\0') break;
+        if (!entradaNombreVigente(*e)) continue;
+        int k = 0;
+        while (k < cantidad && salida[k] != e->posicion) k = k + 1;
+        if (k < cantidad) continue;
+        salida[cantidad] = e->posicion;
+        cantidad = cantidad + 1;
+    }
+    return cantidad;
+}
+
+/* Agrega la ficha en idx a los dos ordenes y suma sus terminos */
+void indexarNombrePaciente(int idx) {
+    const FichaPaciente &f = pacientes[idx];
+    char clave[LARGO_CLAVE_NOMBRE];
+    EntradaNombre e;
+    e.separador = claveNombre(f.apellido, f.nombre, clave);
+    e.clave = arenaCopiarCadena(clavesNombres, clave, LARGO_CLAVE_NOMBRE);
+    e.posicion = idx;
+    agregarEntradaNombre(nombresPorApellido, e);
+    agregarEntradaNombre(nombresPorNombre, e);
+    clave[e.separador] = '\0';
+    usarTerminoNombre(clave, 1);
+    usarTerminoNombre(clave + e.separador + 1, 1);
+}
+
+void liberarIndiceNombres() {
+    delete[] nombresPorApellido.principal;
+    delete[] nombresPorApellido.delta;
+    delete[] nombresPorNombre.principal;
+    delete[] nombresPorNombre.delta;
+    OrdenNombres porApellido = { false, NULL, 0, 0, NULL, 0 };
+    OrdenNombres porNombre = { true, NULL, 0, 0, NULL, 0 };
+    nombresPorApellido = porApellido;
+    nombresPorNombre = porNombre;
+    int i;
+    for (i = 0; i < cantidadListasTrigrama; i = i + 1) listaSlotsLiberar(terminosPorTrigrama[i]);
+    delete[] terminosPorTrigrama;
+    terminosPorTrigrama = NULL;
+    cantidadListasTrigrama = 0;
+    capacidadListasTrigrama = 0;
+    tablaEnterosLiberar(listaDeTrigrama);
+    tablaEnterosLiberar(terminosNombre);
+    delete[] textoTerminos;
+    delete[] usosTerminos;
+    delete[] largoTerminos;
+    textoTerminos = NULL;
+    usosTerminos = NULL;
+    largoTerminos = NULL;
+    cantidadTerminos = 0;
+    capacidadTerminos = 0;
+    arenaLiberar(clavesNombres);
+    clavesNombresViejas = 0;
+}
+
+int compararTextosTerminos(const void *a, const void *b) {
+    return strcmp(textoTerminos[*(const int *)a], textoTerminos[*(const int *)b]);
+}
+
+/* Pasa los indices de origen a destino ordenados por el rango del termino de cada entrada
+   (0 el texto vacio, r + 1 el termino de rango r). Es estable: a igual rango conserva el
+   orden que traian. */
+void ordenarPorConteo(const int *origen, int *destino, int n, const int *termino, const int *rangoTermino, int *conteo) {
+    int i;
+    for (i = 0; i <= cantidadTerminos + 1; i = i + 1) conteo[i] = 0;
+    for (i = 0; i < n; i = i + 1) {
+        int t = termino[origen[i]];
+        int rango = (t == -1) ? 0 : rangoTermino[t] + 1;
+        conteo[rango + 1] = conteo[rango + 1] + 1;
+    }
+    for (i = 1; i <= cantidadTerminos + 1; i = i + 1) conteo[i] = conteo[i] + conteo[i - 1];
+    for (i = 0; i < n; i = i + 1) {
+        int t = termino[origen[i]];
+        int rango = (t == -1) ? 0 : rangoTermino[t] + 1;
+        destino[conteo[rango]] = origen[i];
+        conteo[rango] = conteo[rango] + 1;
+    }
+}
+
+/* Deja orden.principal con las entradas ordenadas por el rango de su primer termino y
+   despues del segundo: dos pasadas estables, la primera por el segundo termino. Las
+   entradas vienen en orden de posicion, que es el desempate de compararEntradasNombre. */
+void ordenarPorRangos(OrdenNombres &orden, const EntradaNombre *entradas, const int *primero,
+                      const int *segundo, const int *rangoTermino, int n) {
+    int *indices = new int[n > 0 ? n : 1];
+    int *auxiliar = new int[n > 0 ? n : 1];
+    int *conteo = new int[cantidadTerminos + 2];
+    int i;
+    for (i = 0; i < n; i = i + 1) indices[i] = i;
+    ordenarPorConteo(indices, auxiliar, n, segundo, rangoTermino, conteo);
+    ordenarPorConteo(auxiliar, indices, n, primero, rangoTermino, conteo);
+    asegurarPrincipalNombres(orden, n);
+    for (i = 0; i < n; i = i + 1) orden.principal[i] = entradas[indices[i]];
+    orden.cantidadPrincipal = n;
+    delete[] indices;
+    delete[] auxiliar;
+    delete[] conteo;
+}
+
+/* Arma todo de nuevo desde las fichas vigentes, directo en la parte principal. En vez de
+   ordenar comparando claves se ordenan los terminos (muchos menos que los pacientes) y
+   despues las entradas por conteo sobre los rangos de sus terminos: como el separador es
+   menor que cualquier caracter, da el mismo orden que compararEntradasNombre. */
+void reconstruirIndiceNombres() {
+    liberarIndiceNombres();
+    int n = 0;
+    EntradaNombre *entradas = new EntradaNombre[cantidadPacientes > 0 ? cantidadPacientes : 1];
+    int *idApellido = new int[cantidadPacientes > 0 ? cantidadPacientes : 1];
+    int *idNombre = new int[cantidadPacientes > 0 ? cantidadPacientes : 1];
+    int i;
+    for (i = 0; i < posicionesPacientes && n < cantidadPacientes; i = i + 1) {
+        const FichaPaciente &f = pacientes[i];
+        if (f.dni == NULL) continue;
+        char clave[LARGO_CLAVE_NOMBRE];
+        EntradaNombre &e = entradas[n];
+        e.separador = claveNombre(f.apellido, f.nombre, clave);
+        e.clave = arenaCopiarCadena(clavesNombres, clave, LARGO_CLAVE_NOMBRE);
+        e.posicion = i;
+        clave[e.separador] = '\0';
+        idApellido[n] = usarTerminoNombre(clave, 1);
+        idNombre[n] = usarTerminoNombre(clave + e.separador + 1, 1);
+        n = n + 1;
+    }
+    int *porTexto = new int[cantidadTerminos > 0 ? cantidadTerminos : 1];
+    int *rangoTermino = new int[cantidadTerminos > 0 ? cantidadTerminos : 1];
+    for (i = 0; i < cantidadTerminos; i = i + 1) porTexto[i] = i;
+    if (cantidadTerminos > 1) qsort(porTexto, cantidadTerminos, sizeof(int), compararTextosTerminos);
+    for (i = 0; i < cantidadTerminos; i = i + 1) rangoTermino[porTexto[i]] = i;
+    ordenarPorRangos(nombresPorApellido, entradas, idApellido, idNombre, rangoTermino, n);
+    ordenarPorRangos(nombresPorNombre, entradas, idNombre, idApellido, rangoTermino, n);
+    delete[] porTexto;
+    delete[] rangoTermino;
+    delete[] entradas;
+    delete[] idApellido;
+    delete[] idNombre;
+}
+
+/* Para cargas masivas (snapshot): las fichas no se indexan una por una y al reanudar se
+   arma el indice de una vez */
+void suspenderIndiceNombres() {
+    indiceNombresSuspendido = true;
+}
+
+void reanudarIndiceNombres() {
+    indiceNombresSuspendido = false;
+    reconstruirIndiceNombres();
+}
+
+/* Llamadas por las primitivas de pacientes */
+bool nombrePacienteCambia(int idx, const Paciente &p) {
+    const FichaPaciente &f = pacientes[idx];
+    char antes[LARGO_CLAVE_NOMBRE];
+    char despues[LARGO_CLAVE_NOMBRE];
+    claveNombre(f.apellido, f.nombre, antes);
+    claveNombre(p.apellido, p.nombre, despues);
+    return strcmp(antes, despues) != 0;
+}
+
+void nombrePacienteAgregado(int idx) {
+    if (indiceNombresSuspendido) return;
+    indexarNombrePaciente(idx);
+}
+
+/* Antes de cambiar o dar de baja la ficha: su entrada queda vieja y sus terminos pierden un uso */
+void nombrePacienteRetirado(int idx) {
+    if (indiceNombresSuspendido) return;
+    const FichaPaciente &f = pacientes[idx];
+    char clave[LARGO_CLAVE_NOMBRE];
+    int separador = claveNombre(f.apellido, f.nombre, clave);
+    clave[separador] = '\0';
+    usarTerminoNombre(clave, -1);
+    usarTerminoNombre(clave + separador + 1, -1);
+    clavesNombresViejas = clavesNombresViejas + 1;
+}
+
+/* Despues de una baja o modificacion: reconstruye si ya sobran mas entradas viejas que vigentes */
+void revisarIndiceNombres() {
+    if (indiceNombresSuspendido) return;
+    if (clavesNombresViejas > MINIMO_VIEJAS_RECONSTRUIR && clavesNombresViejas > cantidadPacientes) {
+        reconstruirIndiceNombres();
+    }
+}
+
+/* Normaliza lo que escribe el usuario para buscar por comienzo: "Gonz" busca apellidos
+   que empiezan asi; "Gonzalez, Ju" apellido Gonzalez y nombre que empieza con Ju */
+void prefijoDeConsulta(const char *texto, char *prefijo) {
+    const char *coma = strchr(texto, ',');
+    if (coma == NULL) {
+        normalizarNombre(texto, LARGO_NOMBRE_NORMALIZADO - 1, prefijo);
+        return;
+    }
+    char apellido[LARGO_NOMBRE_NORMALIZADO];
+    size_t largo = (size_t)(coma - texto);
+    if (largo > (size_t)LARGO_NOMBRE_NORMALIZADO - 1) largo = LARGO_NOMBRE_NORMALIZADO - 1;
+    memcpy(apellido, texto, largo);
+    apellido[largo] = '\0';
+    claveNombre(apellido, coma + 1, prefijo);
+}
+
+/* Hasta n posiciones de pacientes cuyo apellido empieza con el texto, ordenados por
+   apellido y nombre. Devuelve cuantas dejo en salida. */
+int buscarPacientesPorComienzo(const char *texto, int n, int *salida) {
+    char prefijo[LARGO_CLAVE_NOMBRE];
+    prefijoDeConsulta(texto, prefijo);
+    if (prefijo[0] == '\0') return 0;
+    return recorrerNombres(nombresPorApellido, prefijo, false, salida, 0, n);
+}
+
+/* Distancia de edicion (Levenshtein) entre a y b, o limite + 1 si se pasa de limite.
+   Corta apenas toda una fila supera el limite. */
+int distanciaEdicionAcotada(const char *a, int largoA, const char *b, int largoB, int limite) {
+    if (largoA - largoB > limite || largoB - largoA > limite) return limite + 1;
+    int fila[LARGO_CLAVE_NOMBRE + 1];
+    int i, j;
+    for (j = 0; j <= largoB; j = j + 1) fila[j] = j;
+    for (i = 1; i <= largoA; i = i + 1) {
+        int diagonal = fila[0];
+        fila[0] = i;
+        int minimo = i;
+        for (j = 1; j <= largoB; j = j + 1) {
+            int arriba = fila[j];
+            int valor = diagonal + ((a[i - 1] == b[j - 1]) ? 0 : 1);
+            if (arriba + 1 < valor) valor = arriba + 1;
+            if (fila[j - 1] + 1 < valor) valor = fila[j - 1] + 1;
+            fila[j] = valor;
+            diagonal = arriba;
+            if (valor < minimo) minimo = valor;
+        }
+        if (minimo > limite) return limite + 1;
+    }
+    return (fila[largoB] <= limite) ? fila[largoB] : limite + 1;
+}
+
+/* Termino candidato de una busqueda aproximada, ordenado por distancia y texto */
+struct TerminoCercano {
+    int distancia;
+    int id;
+};
+
+int compararTerminosCercanos(const void *a, const void *b) {
+    const TerminoCercano &x = *(const TerminoCercano *)a;
+    const TerminoCercano &y = *(const TerminoCercano *)b;
+    if (x.distancia != y.distancia) return x.distancia - y.distancia;
+    return strcmp(textoTerminos[x.id], textoTerminos[y.id]);
+}
+
+/* Hasta n pacientes cuyo apellido o nombre esta a pocas ediciones del texto (0 hasta 3
+   letras, 1 hasta 7, 2 desde 8). Primero los mas parecidos; a igual distancia, por termino
+   y despues por apellido y nombre. En distancias (si no es NULL) deja la de cada uno.
+
+   Un termino a distancia e conserva todos los trigramas de la consulta salvo a lo sumo
+   3e, asi que contiene alguno de cualesquiera 3e + 1 de ellos: alcanza con juntar los
+   candidatos de las 3e + 1 listas mas cortas. */
+int buscarPacientesAproximados(const char *texto, int n, int *salida, int *distancias) {
+    char consulta[LARGO_NOMBRE_NORMALIZADO];
+    int largo = normalizarNombre(texto, LARGO_NOMBRE_NORMALIZADO - 1, consulta);
+    if (largo == 0 || n <= 0) return 0;
+    int errores = (largo <= 3) ? 0 : ((largo <= 7) ? 1 : 2);
+
+    long long codigos[LARGO_NOMBRE_NORMALIZADO + 2];
+    int trigramas = trigramasDeTexto(consulta, largo, codigos);
+    while (errores > 0 && 3 * errores >= trigramas) errores = errores - 1;
+
+    /* listas de la consulta de la mas corta a la mas larga (las que no existen, primero) */
+    int listas[LARGO_NOMBRE_NORMALIZADO + 2];
+    int i, j;
+    for (i = 0; i < trigramas; i = i + 1) {
+        int lista = tablaEnterosBuscar(listaDeTrigrama, codigos[i]);
+        int tam = (lista == -1) ? 0 : terminosPorTrigrama[lista].cantidad;
+        j = i;
+        while (j > 0 && (listas[j - 1] == -1 ? 0 : terminosPorTrigrama[listas[j - 1]].cantidad) > tam) {
+            listas[j] = listas[j - 1];
+            j = j - 1;
+        }
+        listas[j] = lista;
+    }
+    int usadas = 3 * errores + 1;
+    if (usadas > trigramas) usadas = trigramas;
+    int candidatos = 0;
+    for (i = 0; i < usadas; i = i + 1) {
+        if (listas[i] != -1) candidatos = candidatos + terminosPorTrigrama[listas[i]].cantidad;
+    }
+
+    TablaEnteros vistos = { NULL, 0, 0 };
+    tablaEnterosReservar(vistos, candidatos);
+    TerminoCercano *cercanos = NULL;
+    int cantidadCercanos = 0;
+    int capacidadCercanos = 0;
+    for (i = 0; i < usadas; i = i + 1) {
+        if (listas[i] == -1) continue;
+        const ListaSlots &lista = terminosPorTrigrama[listas[i]];
+        for (j = 0; j < lista.cantidad; j = j + 1) {
+            int id = lista.slots[j];
+            int diferencia = largoTerminos[id] - largo;
+            if (diferencia > errores || -diferencia > errores) continue;
+            if (usosTerminos[id] <= 0) continue;
+            if (tablaEnterosBuscar(vistos, id) != -1) continue;
+            tablaEnterosInsertar(vistos, id, 1);
+            CONTAR_METRICA(CONTADOR_TERMINOS_COMPARADOS, 1);
+            int distancia = distanciaEdicionAcotada(consulta, largo, textoTerminos[id], largoTerminos[id], errores);
+            if (distancia > errores) continue;
+            if (cantidadCercanos == capacidadCercanos) {
+                int nuevaCapacidad = (capacidadCercanos == 0) ? 16 : capacidadCercanos * 2;
+                TerminoCercano *nuevos = new TerminoCercano[nuevaCapacidad];
+                if (cantidadCercanos > 0) memcpy(nuevos, cercanos, sizeof(TerminoCercano) * cantidadCercanos);
+                delete[] cercanos;
+                cercanos = nuevos;
+                capacidadCercanos = nuevaCapacidad;
+            }
+            cercanos[cantidadCercanos].distancia = distancia;
+            cercanos[cantidadCercanos].id = id;
+            cantidadCercanos = cantidadCercanos + 1;
+        }
+    }
+    tablaEnterosLiberar(vistos);
+    if (cantidadCercanos > 1) qsort(cercanos, cantidadCercanos, sizeof(TerminoCercano), compararTerminosCercanos);
+
+    int cantidad = 0;
+    for (i = 0; i < cantidadCercanos && cantidad < n; i = i + 1) {
+        char prefijo[LARGO_NOMBRE_NORMALIZADO + 1];
+        const char *termino = textoTerminos[cercanos[i].id];
+        int antes = cantidad;
+        size_t largoTermino = strlen(termino);
+        memcpy(prefijo, termino, largoTermino);
+        prefijo[largoTermino] = SEPARADOR_CLAVE_NOMBRE;
+        prefijo[largoTermino + 1] = '\0';
+        cantidad = recorrerNombres(nombresPorApellido, prefijo, false, salida, cantidad, n);
+        cantidad = recorrerNombres(nombresPorNombre, termino, true, salida, cantidad, n);
+        if (distancias != NULL) {
+            for (j = antes; j < cantidad; j = j + 1) distancias[j] = cercanos[i].distancia;
+        }
+    }
+    delete[] cercanos;
+    return cantidad;
+}
+
+/* ------- PRIMITIVAS DE MODIFICACION ------- */
+
+/* Aplican un cambio ya validado a los datos en memoria y a sus indices, sin mensajes.
+   Las usan las funciones ABM y la reproduccion del log. */
+
+/* Posiciones dadas de baja, para reusar en las proximas altas */
+ListaSlots pacientesLibres = { NULL, 0, 0 };
+ListaSlots especialidadesLibres = { NULL, 0, 0 };
+
+/* Devuelve una posicion para una ficha nueva: la ultima liberada o una al final del
+   arreglo, que se duplica si esta lleno. Las fichas existentes se copian pero no
+   cambian de posicion. */
+int reservarPosicionPaciente() {
+    if (pacientesLibres.cantidad > 0) {
+        pacientesLibres.cantidad = pacientesLibres.cantidad - 1;
+        return pacientesLibres.slots[pacientesLibres.cantidad];
+    }
+    if (posicionesPacientes == capacidadPacientes) {
+        int nuevaCapacidad = (capacidadPacientes == 0) ? 64 : capacidadPacientes * 2;
+        FichaPaciente *nuevas = new FichaPaciente[nuevaCapacidad];
+        if (posicionesPacientes > 0) memcpy(nuevas, pacientes, sizeof(FichaPaciente) * posicionesPacientes);
+        delete[] pacientes;
+        pacientes = nuevas;
+        capacidadPacientes = nuevaCapacidad;
+    }
+    posicionesPacientes = posicionesPacientes + 1;
+    return posicionesPacientes - 1;
+}
+
+int reservarPosicionEspecialidad() {
+    if (especialidadesLibres.cantidad > 0) {
+        especialidadesLibres.cantidad = especialidadesLibres.cantidad - 1;
+        return especialidadesLibres.slots[especialidadesLibres.cantidad];
+    }
+    if (posicionesEspecialidades == capacidadEspecialidades) {
+        int nuevaCapacidad = (capacidadEspecialidades == 0) ? 16 : capacidadEspecialidades * 2;
+        FichaEspecialidad *nuevas = new FichaEspecialidad[nuevaCapacidad];
+        if (posicionesEspecialidades > 0) memcpy(nuevas, especialidades, sizeof(FichaEspecialidad) * posicionesEspecialidades);
+        delete[] especialidades;
+        especialidades = nuevas;
+        capacidadEspecialidades = nuevaCapacidad;
+    }
+    posicionesEspecialidades = posicionesEspecialidades + 1;
+    return posicionesEspecialidades - 1;
+}
+
+/* Arma el registro de tamaño fijo (log, snapshot) a partir de la ficha en memoria */
+void registroDePaciente(int idx, Paciente &p) {
+    const FichaPaciente &f = pacientes[idx];
+    copiarCampo(p.apellido, f.apellido, sizeof(p.apellido));
+    copiarCampo(p.nombre, f.nombre, sizeof(p.nombre));
+    copiarCampo(p.dni, f.dni, sizeof(p.dni));
+    copiarCampo(p.telefono, f.telefono, sizeof(p.telefono));
+}
+
+void registroDeEspecialidad(int idx, Especialidad &e) {
+    const FichaEspecialidad &f = especialidades[idx];
+    e.codigo = f.codigo;
+    copiarCampo(e.nombre, f.nombre, sizeof(e.nombre));
+    copiarCampo(e.descripcion, f.descripcion, sizeof(e.descripcion));
+    e.horario = f.horario;
+}
+
+void insertarPaciente(const Paciente &p) {
+    int idx = reservarPosicionPaciente();
+    FichaPaciente &f = pacientes[idx];
+    f.apellido = arenaCopiarCadena(cadenasCatalogo, p.apellido, sizeof(p.apellido));
+    f.nombre = arenaCopiarCadena(cadenasCatalogo, p.nombre, sizeof(p.nombre));
+    f.dni = arenaCopiarCadena(cadenasCatalogo, p.dni, sizeof(p.dni));
+    f.telefono = arenaCopiarCadena(cadenasCatalogo, p.telefono, sizeof(p.telefono));
+    indiceDNIInsertar(indicePacientes, f.dni, idx);
+    internarDNI(p.dni);
+    cantidadPacientes = cantidadPacientes + 1;
+    nombrePacienteAgregado(idx);
+}
+
+/* El DNI no cambia (es la clave del indice); se reemplazan los demas campos */
+void actualizarPaciente(int idx, const Paciente &p) {
+    FichaPaciente &f = pacientes[idx];
+    bool cambiaNombre = nombrePacienteCambia(idx, p);
+    if (cambiaNombre) nombrePacienteRetirado(idx);
+    arenaReemplazarCadena(cadenasCatalogo, f.apellido, p.apellido, sizeof(p.apellido));
+    arenaReemplazarCadena(cadenasCatalogo, f.nombre, p.nombre, sizeof(p.nombre));
+    arenaReemplazarCadena(cadenasCatalogo, f.telefono, p.telefono, sizeof(p.telefono));
+    if (cambiaNombre) {
+        nombrePacienteAgregado(idx);
+        revisarIndiceNombres();
+    }
+}
+
+/* Baja en O(1): la posicion queda libre y ninguna otra ficha se mueve */
+void eliminarPaciente(int idx) {
+    FichaPaciente &f = pacientes[idx];
+    nombrePacienteRetirado(idx);
+    indiceDNIEliminar(indicePacientes, f.dni);
+    arenaDescartarCadena(cadenasCatalogo, f.apellido);
+    arenaDescartarCadena(cadenasCatalogo, f.nombre);
+    arenaDescartarCadena(cadenasCatalogo, f.dni);
+    arenaDescartarCadena(cadenasCatalogo, f.telefono);
+    f.dni = NULL;
+    listaSlotsAnexar(pacientesLibres, idx);
+    cantidadPacientes = cantidadPacientes - 1;
+    revisarIndiceNombres();
+}
+
+void insertarEspecialidad(const Especialidad &e) {
+    int idx = reservarPosicionEspecialidad();
+    FichaEspecialidad &f = especialidades[idx];
+    f.codigo = e.codigo;
+    f.nombre = arenaCopiarCadena(cadenasCatalogo, e.nombre, sizeof(e.nombre));
+    f.descripcion = arenaCopiarCadena(cadenasCatalogo, e.descripcion, sizeof(e.descripcion));
+    f.horario = e.horario;
+    if (e.codigo >= capacidadPosicionPorCodigoEspecialidad) {
+        int nuevaCapacidad = (capacidadPosicionPorCodigoEspecialidad == 0) ? 64 : capacidadPosicionPorCodigoEspecialidad * 2;
+        while (nuevaCapacidad <= e.codigo) nuevaCapacidad = nuevaCapacidad * 2;
+        int *nuevas = new int[nuevaCapacidad];
+        int i;
+        for (i = 0; i < capacidadPosicionPorCodigoEspecialidad; i = i + 1) nuevas[i] = posicionPorCodigoEspecialidad[i];
+        for (i = capacidadPosicionPorCodigoEspecialidad; i < nuevaCapacidad; i = i + 1) nuevas[i] = -1;
+        delete[] posicionPorCodigoEspecialidad;
+        posicionPorCodigoEspecialidad = nuevas;
+        capacidadPosicionPorCodigoEspecialidad = nuevaCapacidad;
+    }
+    posicionPorCodigoEspecialidad[e.codigo] = idx;
+    cantidadEspecialidades = cantidadEspecialidades + 1;
+    if (e.codigo >= proximoCodigoEspecialidad) proximoCodigoEspecialidad = e.codigo + 1;
+    configurarCupos(e.codigo, e.horario);
+    reservarIndicesEspecialidad(e.codigo);
+}
+
+/* Reemplaza los datos de la especialidad; si cambio el horario se recuentan sus cupos */
+void actualizarEspecialidad(int idx, const Especialidad &e) {
+    FichaEspecialidad &f = especialidades[idx];
+    HorarioAtencion anterior = f.horario;
+    arenaReemplazarCadena(cadenasCatalogo, f.nombre, e.nombre, sizeof(e.nombre));
+    arenaReemplazarCadena(cadenasCatalogo, f.descripcion, e.descripcion, sizeof(e.descripcion));
+    f.horario = e.horario;
+    if (memcmp(&anterior, &e.horario, sizeof(anterior)) != 0) reconstruirCuposEspecialidad(e.codigo, e.horario);
+}
+
+void eliminarEspecialidad(int idx) {
+    FichaEspecialidad &f = especialidades[idx];
+    quitarCupos(f.codigo);
+    posicionPorCodigoEspecialidad[f.codigo] = -1;
+    arenaDescartarCadena(cadenasCatalogo, f.nombre);
+    arenaDescartarCadena(cadenasCatalogo, f.descripcion);
+    f.codigo = 0;
+    listaSlotsAnexar(especialidadesLibres, idx);
+    cantidadEspecialidades = cantidadEspecialidades - 1;
+}
+
+/* Copia las cadenas vigentes a una arena nueva y libera la vieja, si mas de la mitad de
+   lo ocupado ya es desperdicio. Las fichas cambian de punteros: hay que llamarla sin
+   lectores del catalogo (candadoCatalogo exclusivo o un solo hilo). */
+void compactarCadenasCatalogo() {
+    if (cadenasCatalogo.desperdicio * 2 <= cadenasCatalogo.ocupado) return;
+    Arena nueva = { NULL, 0, 0, 0, 0 };
+    int i;
+    for (i = 0; i < posicionesPacientes; i = i + 1) {
+        FichaPaciente &f = pacientes[i];
+        if (f.dni == NULL) continue;
+        f.apellido = arenaCopiarCadena(nueva, f.apellido, sizeof(((Paciente *)0)->apellido));
+        f.nombre = arenaCopiarCadena(nueva, f.nombre, sizeof(((Paciente *)0)->nombre));
+        f.dni = arenaCopiarCadena(nueva, f.dni, sizeof(((Paciente *)0)->dni));
+        f.telefono = arenaCopiarCadena(nueva, f.telefono, sizeof(((Paciente *)0)->telefono));
+    }
+    for (i = 0; i < posicionesEspecialidades; i = i + 1) {
+        FichaEspecialidad &f = especialidades[i];
+        if (f.codigo == 0) continue;
+        f.nombre = arenaCopiarCadena(nueva, f.nombre, sizeof(((Especialidad *)0)->nombre));
+        f.descripcion = arenaCopiarCadena(nueva, f.descripcion, sizeof(((Especialidad *)0)->descripcion));
+    }
+    arenaLiberar(cadenasCatalogo);
+    cadenasCatalogo = nueva;
+}
+
+void liberarCatalogo() {
+    delete[] pacientes;
+    delete[] especialidades;
+    delete[] posicionPorCodigoEspecialidad;
+    pacientes = NULL;
+    especialidades = NULL;
+    posicionPorCodigoEspecialidad = NULL;
+    posicionesPacientes = 0;
+    capacidadPacientes = 0;
+    cantidadPacientes = 0;
+    posicionesEspecialidades = 0;
+    capacidadEspecialidades = 0;
+    cantidadEspecialidades = 0;
+    capacidadPosicionPorCodigoEspecialidad = 0;
+    listaSlotsLiberar(pacientesLibres);
+    listaSlotsLiberar(especialidadesLibres);
+    arenaLiberar(cadenasCatalogo);
+    indiceDNILiberar(indicePacientes);
+    liberarIndiceNombres();
+}
+
+/* ------- PERSISTENCIA: SNAPSHOT BINARIO ------- */
+
+/* Formato del archivo (enteros en el orden de bytes de la maquina):
+     CabeceraSnapshot
+     pacientes[cantidadPacientes]          (registros Paciente de tamaño fijo, sin las bajas)
+     especialidades[cantidadEspecialidades]
+     bloques de turnos                     (BloqueTurnos tal cual estan en memoria, en orden;
+                                            el ultimo se guarda entero aunque no este lleno)
+     dnis[cantidadDNIs]                    (heap de DNIs de pacientes y turnos, en orden de id)
+   Cada seccion empieza alineada a ALINEACION_SNAPSHOT. Como los registros tienen
+   tamaño fijo no hay nada que interpretar: al arrancar se mapea el archivo y los
+   bloques completos de turnos pasan a apuntar directamente a la memoria mapeada
+   (copy-on-write, asi que cancelar o modificar un turno no toca el archivo).
+   La cabecera lleva su propio CRC y uno por seccion, que cubre solo los bytes de la
+   seccion (no el relleno).
+   Los indices (hash por DNI, tabla de codigos, agendas, listas por paciente, indice de
+   nombres) no se guardan: son estructuras de punteros que se modifican en el lugar y se
+   agrandan liberando el arreglo anterior, y usarlas desde el mapeo obligaria a pasar toda
+   esa capa a desplazamientos. Se reconstruyen al cargar recorriendo las secciones (con
+   200.000 pacientes y 1.000.000 de turnos lleva del orden de un segundo); para no pagar
+   ademas la escritura en cada salida, al salir solo se compacta si el log supero
+   UMBRAL_COMPACTACION_SALIDA (ver guardarAlSalir).
+   Solo se lee la version actual; un archivo de otra version se trata como dañado. */
+const char MAGIA_SNAPSHOT[8] = { 'S', 'M', 'E', 'D', 'S', 'N', 'A', 'P' };
+const unsigned int VERSION_SNAPSHOT = 5;
+const int ALINEACION_SNAPSHOT = 64;
+const char *ARCHIVO_SNAPSHOT = "sistema_medico.snap";
+
+struct CabeceraSnapshot {
+    char magia[8];
+    unsigned int version;
+    /* tamaños de registro con los que se escribio; si no coinciden el archivo es de otra compilacion */
+    unsigned int tamPaciente;
+    unsigned int tamEspecialidad;
+    unsigned int tamTurno;
+    int cantidadPacientes;
+    int cantidadEspecialidades;
+    int cantidadTurnos;
+    int proximoCodigoEspecialidad;
+    int proximoCodigoTurno;
+    unsigned int crc; /* CRC-32 de la cabecera (ver crcSnapshot) */
+    unsigned long long ultimoLSN; /* ultima operacion del log incluida en el snapshot */
+    long long desplazamientoPacientes;
+    long long desplazamientoEspecialidades;
+    long long desplazamientoTurnos;
+    long long tamArchivo;
+    int cantidadDNIs;
+    int relleno;
+    long long desplazamientoDNIs;
+    unsigned int crcPacientes;
+    unsigned int crcEspecialidades;
+    unsigned int crcTurnos;
+    unsigned int crcDNIs;
+};
+
+/* CRC-32 (polinomio 0xEDB88320) por "slicing-by-8": 8 tablas de 256 entradas, armadas
+   en el primer uso, que procesan 8 bytes por iteracion en vez de uno. */
+unsigned int tablaCRC32[8][256];
+bool tablaCRC32Lista = false;
+
+unsigned int actualizarCRC32(unsigned int crc, const void *datos, size_t cantidad) {
+    const unsigned char *p = (const unsigned char *)datos;
+    if (!tablaCRC32Lista) {
+        unsigned int n;
+        int k;
+        for (n = 0; n < 256; n = n + 1) {
+            unsigned int c = n;
+            for (k = 0; k < 8; k = k + 1) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            tablaCRC32[0][n] = c;
+        }
+        for (n = 0; n < 256; n = n + 1) {
+            for (k = 1; k < 8; k = k + 1) {
+                tablaCRC32[k][n] = (tablaCRC32[k - 1][n] >> 8) ^ tablaCRC32[0][tablaCRC32[k - 1][n] & 0xFF];
+            }
+        }
+        tablaCRC32Lista = true;
+    }
+    crc = ~crc;
+    while (cantidad >= 8) {
+        unsigned int bajo = crc ^ ((unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24));
+        unsigned int alto = (unsigned int)p[4] | ((unsigned int)p[5] << 8) | ((unsigned int)p[6] << 16) | ((unsigned int)p[7] << 24);
+        crc = tablaCRC32[7][bajo & 0xFF] ^ tablaCRC32[6][(bajo >> 8) & 0xFF] ^
+              tablaCRC32[5][(bajo >> 16) & 0xFF] ^ tablaCRC32[4][bajo >> 24] ^
+              tablaCRC32[3][alto & 0xFF] ^ tablaCRC32[2][(alto >> 8) & 0xFF] ^
+              tablaCRC32[1][(alto >> 16) & 0xFF] ^ tablaCRC32[0][alto >> 24];
+        p = p + 8;
+        cantidad = cantidad - 8;
+    }
+    while (cantidad > 0) {
+        crc = tablaCRC32[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+        p = p + 1;
+        cantidad = cantidad - 1;
+    }
+    return ~crc;
+}
+
+/* Numero de secuencia de la ultima operacion registrada en el log (ver LOG DE OPERACIONES) */
+unsigned long long ultimoLSN = 0;
+
+/* Region del snapshot mapeada actualmente (NULL si no hay) */
+char *snapshotMapeado = NULL;
+long long tamSnapshotMapeado = 0;
+
+/* Mapea el archivo completo en modo copy-on-write. Devuelve NULL si no existe o falla. */
+char* mapearArchivo(const char *ruta, long long &tam) {
+#if defined(_WIN32)
+    HANDLE archivo = CreateFileA(ruta, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (archivo == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER tamArchivo;
+    if (!GetFileSizeEx(archivo, &tamArchivo) || tamArchivo.QuadPart == 0) {
+        CloseHandle(archivo);
+        return NULL;
+    }
+    HANDLE mapeo = CreateFileMappingA(archivo, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(archivo);
+    if (mapeo == NULL) return NULL;
+    char *base = (char *)MapViewOfFile(mapeo, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapeo);
+    tam = tamArchivo.QuadPart;
+    return base;
+#else
+    int fd = open(ruta, O_RDONLY);
+    if (fd == -1) return NULL;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void *base = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+    tam = (long long)info.st_size;
+    return (char *)base;
+#endif
+}
+
+void desmapearArchivo(char *base, long long tam) {
+#if defined(_WIN32)
+    (void)tam;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, (size_t)tam);
+#endif
+}
+
+/* Deja de usar la memoria mapeada: los bloques de turnos que apuntaban al snapshot se
+   copian a memoria propia antes de desmapear. Hace falta antes de reemplazar el archivo. */
+void desmapearSnapshot() {
+    if (snapshotMapeado == NULL) return;
+    int i;
+    for (i = 0; i < bloquesTurnosMapeados; i = i + 1) {
+        BloqueTurnos *copia = new BloqueTurnos;
+        memcpy(copia, bloquesTurnos[i], sizeof(BloqueTurnos));
+        bloquesTurnos[i] = copia;
+    }
+    bloquesTurnosMapeados = 0;
+    /* un lector puede estar recorriendo los bloques mapeados: se desmapea por epocas */
+    retirar(RETIRO_MAPEO, snapshotMapeado, tamSnapshotMapeado);
+    snapshotMapeado = NULL;
+    tamSnapshotMapeado = 0;
+}
+
+long long alinearSnapshot(long long desplazamiento) {
+    return (desplazamiento + ALINEACION_SNAPSHOT - 1) / ALINEACION_SNAPSHOT * ALINEACION_SNAPSHOT;
+}
+
+/* Escribe datos en el archivo acumulando el CRC de su seccion. Devuelve false si falla la escritura. */
+bool escribirSnapshot(FILE *f, const void *datos, size_t cantidad, unsigned int &crc, long long &posicion) {
+    if (cantidad == 0) return true;
+    if (fwrite(datos, 1, cantidad, f) != cantidad) return false;
+    crc = actualizarCRC32(crc, datos, cantidad);
+    posicion = posicion + (long long)cantidad;
+    return true;
+}
+
+/* Rellena con ceros hasta el proximo limite de alineacion */
+bool rellenarSnapshot(FILE *f, unsigned int &crc, long long &posicion) {
+    static const char ceros[ALINEACION_SNAPSHOT] = { 0 };
+    return escribirSnapshot(f, ceros, (size_t)(alinearSnapshot(posicion) - posicion), crc, posicion);
+}
+
+/* Fuerza los datos del archivo al disco */
+bool sincronizarArchivo(FILE *f) {
+    if (fflush(f) != 0) return false;
+#if defined(_WIN32)
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+/* Reemplaza destino por origen (en Windows rename no pisa archivos existentes) */
+bool reemplazarArchivo(const char *origen, const char *destino) {
+#if defined(_WIN32)
+    return MoveFileExA(origen, destino, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(origen, destino) == 0;
+#endif
+}
+
+/* CRC de la cabecera, con su campo crc en 0. Cubre tambien los CRC de las secciones,
+   asi una cabecera dañada (cantidades, desplazamientos, proximos codigos) se detecta
+   antes de usar cualquiera de sus campos. */
+unsigned int crcSnapshot(CabeceraSnapshot cab) {
+    cab.crc = 0;
+    return actualizarCRC32(0, &cab, sizeof(cab));
+}
+
+/* Guarda todo el estado en ruta. Se escribe primero un archivo temporal y despues se
+   renombra, asi un corte a mitad de camino nunca deja un snapshot a medias. */
+bool guardarSnapshot(const char *ruta) {
+    char temporal[512];
+    snprintf(temporal, sizeof(temporal), "%s.tmp", ruta);
+    FILE *f = fopen(temporal, "wb");
+    if (f == NULL) return false;
+
+    CabeceraSnapshot cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, MAGIA_SNAPSHOT, sizeof(cab.magia));
+    cab.version = VERSION_SNAPSHOT;
+    cab.tamPaciente = sizeof(Paciente);
+    cab.tamEspecialidad = sizeof(Especialidad);
+    cab.tamTurno = sizeof(BloqueTurnos);
+    cab.cantidadPacientes = cantidadPacientes;
+    cab.cantidadEspecialidades = cantidadEspecialidades;
+    cab.cantidadTurnos = cantidadTurnos;
+    cab.proximoCodigoEspecialidad = proximoCodigoEspecialidad;
+    cab.proximoCodigoTurno = proximoCodigoTurno;
+    cab.ultimoLSN = ultimoLSN;
+    cab.cantidadDNIs = cantidadIdsDNI;
+
+    bool ok = fwrite(&cab, sizeof(cab), 1, f) == 1;
+    unsigned int crcRelleno = 0;
+    long long posicion = sizeof(cab);
+
+    /* las fichas se pasan a registros de tamaño fijo; las posiciones libres no se guardan */
+    int i;
+    ok = ok && rellenarSnapshot(f, crcRelleno, posicion);
+    cab.desplazamientoPacientes = posicion;
+    for (i = 0; ok && i < posicionesPacientes; i = i + 1) {
+        if (pacientes[i].dni == NULL) continue;
+        Paciente p;
+        memset(&p, 0, sizeof(p));
+        registroDePaciente(i, p);
+        ok = escribirSnapshot(f, &p, sizeof(p), cab.crcPacientes, posicion);
+    }
+    ok = ok && rellenarSnapshot(f, crcRelleno, posicion);
+    cab.desplazamientoEspecialidades = posicion;
+    for (i = 0; ok && i < posicionesEspecialidades; i = i + 1) {
+        if (especialidades[i].codigo == 0) continue;
+        Especialidad e;
+        memset(&e, 0, sizeof(e));
+        registroDeEspecialidad(i, e);
+        ok = escribirSnapshot(f, &e, sizeof(e), cab.crcEspecialidades, posicion);
+    }
+    ok = ok && rellenarSnapshot(f, crcRelleno, posicion);
+    cab.desplazamientoTurnos = posicion;
+    /* los turnos se escriben de a bloque, con sus columnas tal cual */
+    int slot;
+    for (slot = 0; ok && slot < cantidadTurnos; slot = slot + TURNOS_POR_BLOQUE) {
+        ok = escribirSnapshot(f, bloqueDeSlot(slot), sizeof(BloqueTurnos), cab.crcTurnos, posicion);
+    }
+    ok = ok && rellenarSnapshot(f, crcRelleno, posicion);
+    cab.desplazamientoDNIs = posicion;
+    for (i = 0; ok && i < cantidadIdsDNI; i = i + DNIS_POR_BLOQUE) {
+        int enBloque = cantidadIdsDNI - i;
+        if (enBloque > DNIS_POR_BLOQUE) enBloque = DNIS_POR_BLOQUE;
+        ok = escribirSnapshot(f, bloquesDNI.load()[i >> BITS_DNIS_POR_BLOQUE], sizeof(ClaveDNI) * enBloque, cab.crcDNIs, posicion);
+    }
+    cab.tamArchivo = posicion;
+    cab.crc = crcSnapshot(cab);
+
+    /* reescribir la cabecera con desplazamientos y CRC definitivos */
+    ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&cab, sizeof(cab), 1, f) == 1;
+    ok = ok && sincronizarArchivo(f);
+    if (fclose(f) != 0) ok = false;
+    if (!ok) {
+        remove(temporal);
+        return false;
+    }
+    /* el archivo viejo puede estar mapeado: primero se deja de usar */
+    desmapearSnapshot();
+    return reemplazarArchivo(temporal, ruta);
+}
+
+/* Revisa que las columnas de turnos leidas del archivo tengan ids de DNI, especialidades
+   y estados dentro de rango, antes de usarlas como indices */
+bool columnasTurnosValidas(const BloqueTurnos *bloques, int cantidad, int cantidadDNIs) {
+    int slot;
+    for (slot = 0; slot < cantidad; slot = slot + 1) {
+        const BloqueTurnos &b = bloques[slot >> BITS_TURNOS_POR_BLOQUE];
+        int i = slot & (TURNOS_POR_BLOQUE - 1);
+        if (b.codigo[i] < 1 || b.paciente[i] < 0 || b.paciente[i] >= cantidadDNIs || b.especialidad[i] < 0 ||
+            (b.estado[i] != ESTADO_ACTIVO && b.estado[i] != ESTADO_CANCELADO)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Carga el estado desde ruta si existe y es valido. Devuelve false (sin tocar nada)
+   si no hay archivo o si esta dañado o es de otra version. */
+bool cargarSnapshot(const char *ruta) {
+    long long tam = 0;
+    char *base = mapearArchivo(ruta, tam);
+    if (base == NULL) return false;
+
+    CabeceraSnapshot cab;
+    memset(&cab, 0, sizeof(cab));
+    bool valido = tam >= (long long)sizeof(cab);
+    if (valido) memcpy(&cab, base, sizeof(cab));
+    long long bloquesArchivo = ((long long)cab.cantidadTurnos + TURNOS_POR_BLOQUE - 1) >> BITS_TURNOS_POR_BLOQUE;
+    if (valido) {
+        valido = crcSnapshot(cab) == cab.crc &&
+                 memcmp(cab.magia, MAGIA_SNAPSHOT, sizeof(cab.magia)) == 0 &&
+                 cab.version == VERSION_SNAPSHOT &&
+                 cab.tamPaciente == sizeof(Paciente) &&
+                 cab.tamEspecialidad == sizeof(Especialidad) &&
+                 cab.tamTurno == sizeof(BloqueTurnos) &&
+                 cab.tamArchivo == tam &&
+                 cab.cantidadPacientes >= 0 &&
+                 cab.desplazamientoPacientes + (long long)cab.tamPaciente * cab.cantidadPacientes <= tam &&
+                 cab.cantidadEspecialidades >= 0 &&
+                 cab.desplazamientoEspecialidades + (long long)cab.tamEspecialidad * cab.cantidadEspecialidades <= tam &&
+                 cab.cantidadTurnos >= 0 &&
+                 /* los bloques se usan en el lugar: tienen que quedar alineados en la memoria mapeada */
+                 cab.desplazamientoTurnos % ALINEACION_SNAPSHOT == 0 &&
+                 cab.desplazamientoTurnos + (long long)sizeof(BloqueTurnos) * bloquesArchivo <= tam &&
+                 cab.cantidadDNIs >= 0 &&
+                 cab.desplazamientoDNIs + (long long)sizeof(ClaveDNI) * cab.cantidadDNIs <= tam;
+    }
+    if (valido) {
+        valido = actualizarCRC32(0, base + cab.desplazamientoPacientes, (size_t)cab.tamPaciente * cab.cantidadPacientes) == cab.crcPacientes &&
+                 actualizarCRC32(0, base + cab.desplazamientoEspecialidades, (size_t)cab.tamEspecialidad * cab.cantidadEspecialidades) == cab.crcEspecialidades &&
+                 actualizarCRC32(0, base + cab.desplazamientoTurnos, sizeof(BloqueTurnos) * (size_t)bloquesArchivo) == cab.crcTurnos &&
+                 actualizarCRC32(0, base + cab.desplazamientoDNIs, sizeof(ClaveDNI) * (size_t)cab.cantidadDNIs) == cab.crcDNIs;
+    }
+    if (valido) {
+        valido = columnasTurnosValidas((const BloqueTurnos *)(base + cab.desplazamientoTurnos), cab.cantidadTurnos, cab.cantidadDNIs);
+    }
+    if (!valido) {
+        desmapearArchivo(base, tam);
+        return false;
+    }
+
+    int i;
+    /* el heap de DNIs esta en orden de id: internarlos uno por uno, antes que los
+       pacientes (que internan el suyo), da los mismos ids */
+    for (i = 0; i < cab.cantidadDNIs; i = i + 1) {
+        ClaveDNI clave;
+        memcpy(&clave, base + cab.desplazamientoDNIs + (long long)sizeof(ClaveDNI) * i, sizeof(clave));
+        clave.dni[sizeof(clave.dni) - 1] = '\0';
+        internarDNI(clave.dni);
+    }
+
+    /* pacientes y especialidades: cada registro pasa a una ficha con sus cadenas en la arena;
+       el indice de nombres se arma una sola vez al final */
+    suspenderIndiceNombres();
+    for (i = 0; i < cab.cantidadPacientes; i = i + 1) {
+        Paciente p;
+        memcpy(&p, base + cab.desplazamientoPacientes + (long long)sizeof(Paciente) * i, sizeof(p));
+        insertarPaciente(p);
+    }
+    reanudarIndiceNombres();
+    for (i = 0; i < cab.cantidadEspecialidades; i = i + 1) {
+        Especialidad e;
+        memcpy(&e, base + cab.desplazamientoEspecialidades + (long long)sizeof(Especialidad) * i, sizeof(e));
+        insertarEspecialidad(e);
+    }
+    proximoCodigoEspecialidad = cab.proximoCodigoEspecialidad;
+    proximoCodigoTurno = cab.proximoCodigoTurno;
+    ultimoLSN = cab.ultimoLSN;
+
+    /* los bloques completos se usan en el lugar; el ultimo, incompleto, se copia
+       porque va a seguir recibiendo altas y el archivo termina ahi */
+    BloqueTurnos *bloques = (BloqueTurnos *)(base + cab.desplazamientoTurnos);
+    int completos = cab.cantidadTurnos >> BITS_TURNOS_POR_BLOQUE;
+    if (bloquesArchivo > 0) asegurarDirectorioTurnos((int)bloquesArchivo - 1);
+    for (i = 0; i < (int)bloquesArchivo; i = i + 1) {
+        if (i < completos) {
+            bloquesTurnos[i] = bloques + i;
+        } else {
+            BloqueTurnos *copia = new BloqueTurnos;
+            memcpy(copia, bloques + i, sizeof(BloqueTurnos));
+            bloquesTurnos[i] = copia;
+        }
+        reservarControlBloque(i);
+    }
+    bloquesTurnosMapeados = completos;
+    cantidadTurnos = cab.cantidadTurnos;
+    int slot;
+    for (slot = 0; slot < cantidadTurnos; slot = slot + 1) {
+        registrarCodigoTurno(codigoEnSlot(slot), slot);
+    }
+    /* los indices son estructuras en memoria: se reconstruyen recorriendo el almacen */
+    reconstruirIndicesTurnos();
+    turnosPublicados = cantidadTurnos;
+
+    if (completos > 0) {
+        snapshotMapeado = base;
+        tamSnapshotMapeado = tam;
+    } else {
+        desmapearArchivo(base, tam);
+    }
+    return true;
+}
+
+/* ------- LOG DE OPERACIONES (WAL) CON CONFIRMACION EN GRUPO ------- */
+
+/* Entre snapshots, cada cambio se agrega a ARCHIVO_LOG como un registro:
+     CabeceraRegistroLog + datos (el registro o los campos que cambiaron)
+   El CRC cubre la cabecera (con crc en 0) y los datos, asi un registro cortado por
+   un apagon se detecta y se descarta junto con todo lo que sigue.
+   Los registros se acumulan en memoria y se escriben con un solo fsync cuando se
+   juntan operacionesPorGrupoLog o pasan milisegundosPorGrupoLog desde el primero
+   pendiente (confirmacion en grupo). Con grupo 1 cada operacion se confirma sola.
+   Al arrancar se reproducen los registros con LSN mayor al del snapshot; compactar
+   escribe un snapshot nuevo y vacia el log. */
+const char *ARCHIVO_LOG = "sistema_medico.log";
+const long long UMBRAL_COMPACTACION_LOG = 64LL * 1024 * 1024;
+/* al salir alcanza con un log mas chico: reproducirlo al arrancar cuesta menos que reescribir el snapshot */
+const long long UMBRAL_COMPACTACION_SALIDA = 1LL * 1024 * 1024;
+
+enum TipoRegistroLog {
+    LOG_ALTA_PACIENTE = 1,
+    LOG_MODIFICACION_PACIENTE = 2,
+    LOG_BAJA_PACIENTE = 3,
+    LOG_ALTA_ESPECIALIDAD = 4,
+    LOG_MODIFICACION_ESPECIALIDAD = 5,
+    LOG_BAJA_ESPECIALIDAD = 6,
+    LOG_ALTA_TURNO = 7,
+    LOG_MODIFICACION_TURNO = 8,
+    LOG_CANCELACION_TURNO = 9
+};
+
+struct CabeceraRegistroLog {
+    unsigned int tipo;
+    unsigned int longitud; /* bytes de datos que siguen a la cabecera */
+    unsigned long long lsn;
+    unsigned int crc;
+    unsigned int reservado;
+};
+
+/* Datos de LOG_MODIFICACION_TURNO */
+struct RegistroReprogramacion {
+    int codigo;
+    int dia;
+    int mes;
+    int anio;
+    int hora;
+    int minuto;
+};
+
+FILE *archivoLog = NULL;
+long long tamArchivoLog = 0;
+
+/* Todo el estado del log se protege con candadoLog. Los registros se agregan a bufferLog;
+   quien confirma intercambia bufferLog con bufferVuelco, suelta el candado y escribe y
+   sincroniza bufferVuelco mientras los demas hilos siguen agregando. */
+mutex candadoLog;
+condition_variable logConfirmado;
+char *bufferLog = NULL;
+size_t usadoBufferLog = 0;
+size_t capacidadBufferLog = 0;
+char *bufferVuelco = NULL;
+size_t capacidadBufferVuelco = 0;
+int pendientesLog = 0;
+long long inicioPendientesLog = 0; /* milisegundos del primer registro pendiente */
+unsigned long long lsnDurable = 0;  /* todo registro con lsn <= lsnDurable esta en disco */
+bool volcandoLog = false;           /* hay un hilo escribiendo bufferVuelco */
+bool errorLog = false;
+
+/* Confirmacion en grupo (se pueden cambiar con --wal-grupo y --wal-ms) */
+int operacionesPorGrupoLog = 1;
+int milisegundosPorGrupoLog = 0;
+
+/* registrarEnLog solo agrega el registro (con los candados de la operacion tomados, asi el
+   orden del log es el de las modificaciones); el fsync se espera despues de soltarlos,
+   para no frenar a los lectores del catalogo ni a las reservas de la franja. Sin
+   confirmacion diferida cada operacion llama a confirmarRegistroHilo, que espera si su
+   registro cerro un grupo. En modo servidor (y en la importacion) la confirmacion es
+   diferida: cada hilo llama a esperarLogDurable al terminar su tanda de lineas, y un solo
+   fsync cubre a todos los hilos que esperaban (confirmacion en grupo natural). */
+bool confirmacionDiferidaLog = false;
+
+/* LSN del ultimo registro agregado por este hilo */
+thread_local unsigned long long lsnUltimaOperacionHilo = 0;
+
+/* El ultimo registro de este hilo cerro un grupo y falta esperar que llegue a disco */
+thread_local bool confirmacionPendienteHilo = false;
+
+/* Milisegundos de un reloj monotono (solo sirve para medir intervalos) */
+long long milisegundosMonotonos() {
+#if defined(_WIN32)
+    return (long long)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+/* Lo mismo en microsegundos, para medir operaciones cortas */
+long long microsegundosMonotonos() {
+#if defined(_WIN32)
+    LARGE_INTEGER frecuencia;
+    LARGE_INTEGER ahora;
+    QueryPerformanceFrequency(&frecuencia);
+    QueryPerformanceCounter(&ahora);
+    return (long long)(ahora.QuadPart / frecuencia.QuadPart) * 1000000 +
+           (long long)(ahora.QuadPart % frecuencia.QuadPart) * 1000000 / frecuencia.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/* Abre (o crea) el log para agregar registros al final */
+bool abrirLog(const char *ruta) {
+    archivoLog = fopen(ruta, "ab");
+    if (archivoLog == NULL) return false;
+    fseek(archivoLog, 0, SEEK_END);
+    tamArchivoLog = ftell(archivoLog);
+    lsnDurable = ultimoLSN;
+    return true;
+}
+
+/* Espera a que el registro lsn este en disco. Si nadie esta escribiendo, este hilo
+   escribe todo lo pendiente (de todos los hilos) con un unico fsync. Devuelve false si
+   el registro no llego a disco: una escritura o un fsync fallidos no avanzan lsnDurable,
+   y a partir de ahi el log queda en error y no acepta mas registros (el archivo puede
+   haber quedado con un registro a medias, que la reproduccion descarta). */
+bool esperarLogDurable(unsigned long long lsn) {
+    unique_lock<mutex> guarda(candadoLog);
+    while (archivoLog != NULL && lsnDurable < lsn && !errorLog) {
+        if (volcandoLog) {
+            logConfirmado.wait(guarda);
+            continue;
+        }
+        char *datos = bufferLog;
+        size_t n = usadoBufferLog;
+        unsigned long long hasta = ultimoLSN;
+        bufferLog = bufferVuelco;
+        bufferVuelco = datos;
+        size_t capacidad = capacidadBufferLog;
+        capacidadBufferLog = capacidadBufferVuelco;
+        capacidadBufferVuelco = capacidad;
+        usadoBufferLog = 0;
+        pendientesLog = 0;
+        volcandoLog = true;
+        guarda.unlock();
+
+        bool ok = fwrite(datos, 1, n, archivoLog) == n;
+        ok = ok && sincronizarArchivo(archivoLog);
+        CONTAR_METRICA(CONTADOR_VUELCOS_LOG, 1);
+        CONTAR_METRICA(CONTADOR_BYTES_LOG, n);
+
+        guarda.lock();
+        if (ok) {
+            tamArchivoLog = tamArchivoLog + (long long)n;
+            lsnDurable = hasta;
+        } else {
+            errorLog = true;
+        }
+        volcandoLog = false;
+        logConfirmado.notify_all();
+    }
+    return archivoLog == NULL || lsnDurable >= lsn;
+}
+
+/* Ultimo LSN que ya esta en disco */
+unsigned long long lsnConfirmado() {
+    lock_guard<mutex> guarda(candadoLog);
+    return lsnDurable;
+}
+
+/* Escribe los registros pendientes y los fuerza a disco con un unico fsync */
+bool confirmarLog() {
+    unsigned long long hasta;
+    {
+        lock_guard<mutex> guarda(candadoLog);
+        hasta = ultimoLSN;
+    }
+    bool durable = esperarLogDurable(hasta);
+    lock_guard<mutex> guarda(candadoLog);
+    return durable && !errorLog;
+}
+
+/* Confirma el grupo si ya se cumplio el plazo. Se llama tambien desde los menus,
+   para que un grupo a medio llenar no quede esperando otra operacion. */
+void revisarGrupoLog() {
+    bool vencido;
+    {
+        lock_guard<mutex> guarda(candadoLog);
+        vencido = pendientesLog > 0 && milisegundosMonotonos() - inicioPendientesLog >= milisegundosPorGrupoLog;
+    }
+    if (vencido) confirmarLog();
+}
+
+/* Agrega una operacion al log, sin esperar el disco (ver confirmarRegistroHilo). No hace
+   nada mientras no haya log abierto (por ejemplo durante la reproduccion al arrancar).
+   Devuelve false si el log esta en error. */
+bool registrarEnLog(unsigned int tipo, const void *datos, unsigned int longitud) {
+    if (archivoLog == NULL) return true;
+    unique_lock<mutex> guarda(candadoLog);
+    if (errorLog) return false;
+    size_t necesario = usadoBufferLog + sizeof(CabeceraRegistroLog) + longitud;
+    if (necesario > capacidadBufferLog) {
+        size_t nuevaCapacidad = (capacidadBufferLog == 0) ? 64 * 1024 : capacidadBufferLog * 2;
+        while (nuevaCapacidad < necesario) nuevaCapacidad = nuevaCapacidad * 2;
+        char *nuevo = new char[nuevaCapacidad];
+        if (usadoBufferLog > 0) memcpy(nuevo, bufferLog, usadoBufferLog);
+        delete[] bufferLog;
+        bufferLog = nuevo;
+        capacidadBufferLog = nuevaCapacidad;
+    }
+    CabeceraRegistroLog cab;
+    ultimoLSN = ultimoLSN + 1;
+    cab.tipo = tipo;
+    cab.longitud = longitud;
+    cab.lsn = ultimoLSN;
+    cab.crc = 0;
+    cab.reservado = 0;
+    cab.crc = actualizarCRC32(actualizarCRC32(0, &cab, sizeof(cab)), datos, longitud);
+    memcpy(bufferLog + usadoBufferLog, &cab, sizeof(cab));
+    memcpy(bufferLog + usadoBufferLog + sizeof(cab), datos, longitud);
+    usadoBufferLog = necesario;
+    lsnUltimaOperacionHilo = cab.lsn;
+
+    if (pendientesLog == 0) inicioPendientesLog = milisegundosMonotonos();
+    pendientesLog = pendientesLog + 1;
+    confirmacionPendienteHilo = !confirmacionDiferidaLog
+                                && (pendientesLog >= operacionesPorGrupoLog
+                                    || milisegundosMonotonos() - inicioPendientesLog >= milisegundosPorGrupoLog);
+    return true;
+}
+
+/* Se llama despues de soltar los candados de la operacion: si su registro cerro un grupo,
+   espera a que llegue a disco. Devuelve false si no llego. */
+bool confirmarRegistroHilo() {
+    if (!confirmacionPendienteHilo) return true;
+    confirmacionPendienteHilo = false;
+    return esperarLogDurable(lsnUltimaOperacionHilo);
+}
+
+/* Aplica un registro del log a los datos en memoria con las primitivas de modificacion */
+void aplicarRegistroLog(unsigned int tipo, const char *datos, unsigned int longitud) {
+    int idx;
+    if (tipo == LOG_ALTA_PACIENTE && longitud == sizeof(Paciente)) {
+        Paciente p;
+        memcpy(&p, datos, sizeof(p));
+        if (!buscarPacientePorDNI(p.dni, idx)) insertarPaciente(p);
+    } else if (tipo == LOG_MODIFICACION_PACIENTE && longitud == sizeof(Paciente)) {
+        Paciente p;
+        memcpy(&p, datos, sizeof(p));
+        if (buscarPacientePorDNI(p.dni, idx)) actualizarPaciente(idx, p);
+    } else if (tipo == LOG_BAJA_PACIENTE && longitud == sizeof(((Paciente *)0)->dni)) {
+        char dni[15];
+        memcpy(dni, datos, sizeof(dni));
+        dni[14] = '\0';
+        if (buscarPacientePorDNI(dni, idx)) eliminarPaciente(idx);
+    } else if (tipo == LOG_ALTA_ESPECIALIDAD && longitud == sizeof(Especialidad)) {
+        Especialidad e;
+        memcpy(&e, datos, sizeof(e));
+        if (!buscarEspecialidadPorCodigo(e.codigo, idx)) insertarEspecialidad(e);
+    } else if (tipo == LOG_MODIFICACION_ESPECIALIDAD && longitud == sizeof(Especialidad)) {
+        Especialidad e;
+        memcpy(&e, datos, sizeof(e));
+        if (buscarEspecialidadPorCodigo(e.codigo, idx)) actualizarEspecialidad(idx, e);
+    } else if (tipo == LOG_BAJA_ESPECIALIDAD && longitud == sizeof(int)) {
+        int codigo;
+        memcpy(&codigo, datos, sizeof(codigo));
+        if (buscarEspecialidadPorCodigo(codigo, idx)) eliminarEspecialidad(idx);
+    } else if (tipo == LOG_ALTA_TURNO && longitud == sizeof(Turno)) {
+        Turno t;
+        memcpy(&t, datos, sizeof(t));
+        if (slotDeTurno(t.codigo) == -1) {
+            t.pacienteDNI[sizeof(t.pacienteDNI) - 1] = '\0';
+            registrarTurno(t);
+            if (t.codigo >= proximoCodigoTurno) proximoCodigoTurno = t.codigo + 1;
+        }
+    } else if (tipo == LOG_MODIFICACION_TURNO && longitud == sizeof(RegistroReprogramacion)) {
+        RegistroReprogramacion r;
+        memcpy(&r, datos, sizeof(r));
+        int slot = slotDeTurno(r.codigo);
+        if (slot != -1) reprogramarTurno(slot, r.dia, r.mes, r.anio, r.hora, r.minuto);
+    } else if (tipo == LOG_CANCELACION_TURNO && longitud == sizeof(int)) {
+        int codigo;
+        memcpy(&codigo, datos, sizeof(codigo));
+        int slot = slotDeTurno(codigo);
+        if (slot != -1 && estadoEnSlot(slot) == ESTADO_ACTIVO) cancelarTurnoEnSlot(slot);
+    }
+}
+
+/* Acorta el archivo a la longitud dada (descarta una cola dañada) */
+bool truncarArchivo(const char *ruta, long long longitud) {
+#if defined(_WIN32)
+    FILE *f = fopen(ruta, "r+b");
+    if (f == NULL) return false;
+    bool ok = _chsize_s(_fileno(f), longitud) == 0;
+    fclose(f);
+    return ok;
+#else
+    return truncate(ruta, (off_t)longitud) == 0;
+#endif
+}
+
+/* Reproduce sobre el estado cargado las operaciones del log posteriores al snapshot.
+   Se detiene en el primer registro incompleto o con CRC invalido y recorta el archivo
+   en ese punto. Devuelve la cantidad de operaciones aplicadas. */
+int reproducirLog(const char *ruta) {
+    long long tam = 0;
+    char *base = mapearArchivo(ruta, tam);
+    if (base == NULL) return 0;
+    long long pos = 0;
+    int aplicadas = 0;
+    while (pos + (long long)sizeof(CabeceraRegistroLog) <= tam) {
+        CabeceraRegistroLog cab;
+        memcpy(&cab, base + pos, sizeof(cab));
+        long long fin = pos + (long long)sizeof(cab) + cab.longitud;
+        if (fin > tam) break;
+        unsigned int crcGuardado = cab.crc;
+        cab.crc = 0;
+        unsigned int crc = actualizarCRC32(actualizarCRC32(0, &cab, sizeof(cab)), base + pos + sizeof(cab), cab.longitud);
+        if (crc != crcGuardado) break;
+        if (cab.lsn > ultimoLSN) {
+            aplicarRegistroLog(cab.tipo, base + pos + sizeof(cab), cab.longitud);
+            ultimoLSN = cab.lsn;
+            aplicadas = aplicadas + 1;
+        }
+        pos = fin;
+    }
+    desmapearArchivo(base, tam);
+    if (pos < tam) truncarArchivo(ruta, pos);
+    return aplicadas;
+}
+
+/* Escribe un snapshot con todo el estado y vacia el log. Si el snapshot no se pudo
+   guardar el log queda intacto. Un corte entre ambos pasos no duplica operaciones:
+   el snapshot guarda ultimoLSN y la reproduccion saltea lo que ya incluye. */
+bool compactarLog() {
+    /* con el log en error la memoria puede tener cambios que nunca se confirmaron;
+       no se guardan en el snapshot */
+    if (!confirmarLog()) return false;
+    if (!guardarSnapshot(ARCHIVO_SNAPSHOT)) return false;
+    compactarCadenasCatalogo();
+    lock_guard<mutex> guarda(candadoLog);
+    if (archivoLog == NULL) return true;
+    fclose(archivoLog);
+    archivoLog = fopen(ARCHIVO_LOG, "wb");
+    if (archivoLog == NULL) return false;
+    tamArchivoLog = 0;
+    return true;
+}
+
+/* Confirma el grupo vencido y compacta si el log supero el umbral.
+   Los menus la llaman cada vez que vuelven a mostrar opciones. */
+void mantenimientoLog() {
+    revisarGrupoLog();
+    bool compactar;
+    {
+        lock_guard<mutex> guarda(candadoLog);
+        compactar = archivoLog != NULL && tamArchivoLog > UMBRAL_COMPACTACION_LOG;
+    }
+    if (compactar) compactarLog();
+}
+
+/* Al salir: confirma el log y solo escribe un snapshot nuevo si el log ya es grande
+   (o si no hay log, y el snapshot es lo unico que guarda los cambios). Si no, el
+   snapshot actual mas el log quedan como estan y se reproducen al arrancar. */
+bool guardarAlSalir() {
+    if (!confirmarLog()) return false;
+    bool compactar;
+    {
+        lock_guard<mutex> guarda(candadoLog);
+        compactar = archivoLog == NULL || tamArchivoLog > UMBRAL_COMPACTACION_SALIDA;
+    }
+    if (!compactar) return true;
+    return compactarLog();
+}
+
+void cerrarLog() {
+    confirmarLog();
+    if (archivoLog != NULL) fclose(archivoLog);
+    archivoLog = NULL;
+    delete[] bufferLog;
+    delete[] bufferVuelco;
+    bufferLog = NULL;
+    bufferVuelco = NULL;
+    usadoBufferLog = 0;
+    capacidadBufferLog = 0;
+    capacidadBufferVuelco = 0;
+}
+
+/* ------- API DE OPERACIONES (sin entrada/salida) ------- */
+
+/* Cada operacion valida sus datos, aplica el cambio, lo registra en el log y devuelve
+   un codigo de resultado. No leen ni escriben en consola: las usan los menus
+   interactivos, el modo lote y el servidor. Toman los candados descriptos en
+   CONCURRENCIA, por lo que se pueden llamar desde varios hilos a la vez. */
+enum ResultadoOperacion {
+    OPERACION_OK = 0,
+    ERROR_CAMPO_OBLIGATORIO,
+    ERROR_LIMITE_ALCANZADO,
+    ERROR_DNI_DUPLICADO,
+    ERROR_PACIENTE_INEXISTENTE,
+    ERROR_ESPECIALIDAD_INEXISTENTE,
+    ERROR_TURNO_INEXISTENTE,
+    ERROR_TURNO_NO_ACTIVO,
+    ERROR_TURNO_DUPLICADO,
+    ERROR_FECHA_INVALIDA,
+    ERROR_PLAZO_CANCELACION,
+    ERROR_TURNOS_ACTIVOS,
+    ERROR_COMANDO_DESCONOCIDO,
+    ERROR_CANTIDAD_CAMPOS,
+    ERROR_VALOR_INVALIDO,
+    ERROR_ARCHIVO,
+    ERROR_HORARIO_INVALIDO,
+    ERROR_FUERA_DE_HORARIO,
+    ERROR_SIN_CUPO,
+    ERROR_INDICES_INCONSISTENTES,
+    ERROR_LOG
+};
+
+const char *mensajeResultado(int resultado) {
+    switch (resultado) {
+        case OPERACION_OK: return "Operacion realizada.";
+        case ERROR_CAMPO_OBLIGATORIO: return "Falta un dato obligatorio.";
+        case ERROR_LIMITE_ALCANZADO: return "Alcanzado el maximo de registros.";
+        case ERROR_DNI_DUPLICADO: return "Ya existe un paciente con ese DNI.";
+        case ERROR_PACIENTE_INEXISTENTE: return "Paciente no encontrado.";
+        case ERROR_ESPECIALIDAD_INEXISTENTE: return "Especialidad no encontrada.";
+        case ERROR_TURNO_INEXISTENTE: return "Turno no encontrado.";
+        case ERROR_TURNO_NO_ACTIVO: return "El turno no esta activo.";
+        case ERROR_TURNO_DUPLICADO: return "El paciente ya tiene un turno activo para esa especialidad.";
+        case ERROR_FECHA_INVALIDA: return "Fecha u hora invalida.";
+        case ERROR_PLAZO_CANCELACION: return "Falta menos de 48 horas para el turno.";
+        case ERROR_TURNOS_ACTIVOS: return "Posee turnos activos.";
+        case ERROR_COMANDO_DESCONOCIDO: return "Comando desconocido.";
+        case ERROR_CANTIDAD_CAMPOS: return "Cantidad de campos incorrecta.";
+        case ERROR_VALOR_INVALIDO: return "Valor invalido.";
+        case ERROR_ARCHIVO: return "No se pudo escribir el archivo.";
+        case ERROR_HORARIO_INVALIDO: return "Horario de atencion invalido.";
+        case ERROR_FUERA_DE_HORARIO: return "El horario no coincide con un turno de la especialidad.";
+        case ERROR_SIN_CUPO: return "No queda cupo en ese horario.";
+        case ERROR_INDICES_INCONSISTENTES: return "Los indices de turnos no coinciden con el almacen.";
+        case ERROR_LOG: return "No se pudo guardar la operacion en el log.";
+    }
+    return "Error desconocido.";
+}
+
+int ejecutarAltaPaciente(const char *apellido, const char *nombre, const char *dni, const char *telefono) {
+    MEDIR_OPERACION(MEDIDA_ALTA_PACIENTE);
+    GuardaEscritura catalogo(candadoCatalogo);
+    if (esVacio(apellido) || esVacio(nombre) || esVacio(dni) || esVacio(telefono)) return RESULTADO_MEDIDO(ERROR_CAMPO_OBLIGATORIO);
+    Paciente nuevo;
+    copiarCampo(nuevo.apellido, apellido, sizeof(nuevo.apellido));
+    copiarCampo(nuevo.nombre, nombre, sizeof(nuevo.nombre));
+    copiarCampo(nuevo.dni, dni, sizeof(nuevo.dni));
+    copiarCampo(nuevo.telefono, telefono, sizeof(nuevo.telefono));
+    int idx;
+    if (buscarPacientePorDNI(nuevo.dni, idx)) return RESULTADO_MEDIDO(ERROR_DNI_DUPLICADO);
+    insertarPaciente(nuevo);
+    if (!registrarEnLog(LOG_ALTA_PACIENTE, &nuevo, sizeof(nuevo))) return RESULTADO_MEDIDO(ERROR_LOG);
+    catalogo.soltar();
+    if (!confirmarRegistroHilo()) return RESULTADO_MEDIDO(ERROR_LOG);
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* Los campos en NULL no se modifican. El DNI no cambia, asi el indice sigue valido. */
+int ejecutarModificacionPaciente(const char *dni, const char *apellido, const char *nombre, const char *telefono) {
+    MEDIR_OPERACION(MEDIDA_MODIFICACION_PACIENTE);
+    GuardaEscritura catalogo(candadoCatalogo);
+    int idx;
+    if (!buscarPacientePorDNI(dni, idx)) return RESULTADO_MEDIDO(ERROR_PACIENTE_INEXISTENTE);
+    Paciente p;
+    memset(&p, 0, sizeof(p));
+    registroDePaciente(idx, p);
+    if (apellido != NULL) copiarCampo(p.apellido, apellido, sizeof(p.apellido));
+    if (nombre != NULL) copiarCampo(p.nombre, nombre, sizeof(p.nombre));
+    if (telefono != NULL) copiarCampo(p.telefono, telefono, sizeof(p.telefono));
+    actualizarPaciente(idx, p);
+    if (!registrarEnLog(LOG_MODIFICACION_PACIENTE, &p, sizeof(p))) return RESULTADO_MEDIDO(ERROR_LOG);
+    catalogo.soltar();
+    if (!confirmarRegistroHilo()) return RESULTADO_MEDIDO(ERROR_LOG);
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* No se permite la baja si el paciente tiene turnos activos */
+int ejecutarBajaPaciente(const char *dni) {
+    MEDIR_OPERACION(MEDIDA_BAJA_PACIENTE);
+    GuardaEscritura catalogo(candadoCatalogo);
+    int idx;
+    if (!buscarPacientePorDNI(dni, idx)) return RESULTADO_MEDIDO(ERROR_PACIENTE_INEXISTENTE);
+    if (contarTurnosActivosPaciente(dni) > 0) return RESULTADO_MEDIDO(ERROR_TURNOS_ACTIVOS);
+    char clave[sizeof(((Paciente *)0)->dni)];
+    memset(clave, 0, sizeof(clave));
+    copiarCampo(clave, pacientes[idx].dni, sizeof(clave));
+    if (!registrarEnLog(LOG_BAJA_PACIENTE, clave, sizeof(clave))) return RESULTADO_MEDIDO(ERROR_LOG);
+    eliminarPaciente(idx);
+    catalogo.soltar();
+    if (!confirmarRegistroHilo()) return RESULTADO_MEDIDO(ERROR_LOG);
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* Devuelve en codigo el codigo asignado a la nueva especialidad */
+int ejecutarAltaEspecialidad(const char *nombre, const char *descripcion, const HorarioAtencion &horario, int &codigo) {
+    MEDIR_OPERACION(MEDIDA_ALTA_ESPECIALIDAD);
+    GuardaEscritura catalogo(candadoCatalogo);
+    if (esVacio(nombre)) return RESULTADO_MEDIDO(ERROR_CAMPO_OBLIGATORIO);
+    if (!horarioValido(horario)) return RESULTADO_MEDIDO(ERROR_HORARIO_INVALIDO);
+    Especialidad e;
+    e.codigo = proximoCodigoEspecialidad.fetch_add(1);
+    copiarCampo(e.nombre, nombre, sizeof(e.nombre));
+    copiarCampo(e.descripcion, descripcion != NULL ? descripcion : "", sizeof(e.descripcion));
+    e.horario = horario;
+    insertarEspecialidad(e);
+    if (!registrarEnLog(LOG_ALTA_ESPECIALIDAD, &e, sizeof(e))) return RESULTADO_MEDIDO(ERROR_LOG);
+    catalogo.soltar();
+    if (!confirmarRegistroHilo()) return RESULTADO_MEDIDO(ERROR_LOG);
+    codigo = e.codigo;
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* Con horario en NULL se conserva el horario actual. Si cambia, los turnos ya dados se
+   mantienen aunque queden fuera del nuevo horario o excedan el cupo. */
+int ejecutarModificacionEspecialidad(int codigo, const char *nombre, const char *descripcion, const HorarioAtencion *horario) {
+    MEDIR_OPERACION(MEDIDA_MODIFICACION_ESPECIALIDAD);
+    GuardaEscritura catalogo(candadoCatalogo);
+    int idx;
+    if (!buscarEspecialidadPorCodigo(codigo, idx)) return RESULTADO_MEDIDO(ERROR_ESPECIALIDAD_INEXISTENTE);
+    if (horario != NULL && !horarioValido(*horario)) return RESULTADO_MEDIDO(ERROR_HORARIO_INVALIDO);
+    Especialidad e;
+    memset(&e, 0, sizeof(e));
+    registroDeEspecialidad(idx, e);
+    copiarCampo(e.nombre, nombre, sizeof(e.nombre));
+    copiarCampo(e.descripcion, descripcion, sizeof(e.descripcion));
+    if (horario != NULL) e.horario = *horario;
+    {
+        /* el recuento de cupos recorre la agenda de la especialidad */
+        lock_guard<mutex> franja(franjaEspecialidad(codigo));
+        actualizarEspecialidad(idx, e);
+    }
+    if (!registrarEnLog(LOG_MODIFICACION_ESPECIALIDAD, &e, sizeof(e))) return RESULTADO_MEDIDO(ERROR_LOG);
+    catalogo.soltar();
+    if (!confirmarRegistroHilo()) return RESULTADO_MEDIDO(ERROR_LOG);
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* No se permite la baja si la especialidad se usa en turnos activos */
+int ejecutarBajaEspecialidad(int codigo) {
+    MEDIR_OPERACION(MEDIDA_BAJA_ESPECIALIDAD);
+    GuardaEscritura catalogo(candadoCatalogo);
+    int idx;
+    if (!buscarEspecialidadPorCodigo(codigo, idx)) return RESULTADO_MEDIDO(ERROR_ESPECIALIDAD_INEXISTENTE);
+    if (contarTurnosActivosEspecialidad(codigo) > 0) return RESULTADO_MEDIDO(ERROR_TURNOS_ACTIVOS);
+    eliminarEspecialidad(idx);
+    if (!registrarEnLog(LOG_BAJA_ESPECIALIDAD, &codigo, sizeof(codigo))) return RESULTADO_MEDIDO(ERROR_LOG);
+    catalogo.soltar();
+    if (!confirmarRegistroHilo()) return RESULTADO_MEDIDO(ERROR_LOG);
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* Alta de turno: valida paciente y especialidad, impide duplicado paciente+especialidad activo,
+   valida la fecha y que el horario sea un turno de la especialidad con cupo libre.
+   El codigo se asigna recien cuando el turno es valido. La franja de la especialidad se
+   mantiene desde la comprobacion de duplicado hasta el registro en el log, asi dos reservas
+   simultaneas del mismo paciente y especialidad (o del ultimo cupo de un horario) no pasan
+   ambas. candadoAlmacen se toma solo para guardar el turno (ver CONCURRENCIA). */
+int ejecutarAltaTurno(const char *dni, int codigoEspecialidad, int dia, int mes, int anio, int hora, int minuto, int &codigo) {
+    MEDIR_OPERACION(MEDIDA_ALTA_TURNO);
+    if (esVacio(dni)) return RESULTADO_MEDIDO(ERROR_CAMPO_OBLIGATORIO);
+    Turno nuevo;
+    copiarCampo(nuevo.pacienteDNI, dni, sizeof(nuevo.pacienteDNI));
+    GuardaLectura catalogo(candadoCatalogo);
+    int idx;
+    if (!buscarPacientePorDNI(nuevo.pacienteDNI, idx)) return RESULTADO_MEDIDO(ERROR_PACIENTE_INEXISTENTE);
+    if (!buscarEspecialidadPorCodigo(codigoEspecialidad, idx)) return RESULTADO_MEDIDO(ERROR_ESPECIALIDAD_INEXISTENTE);
+
+    unique_lock<mutex> franja(franjaEspecialidad(codigoEspecialidad));
+    if (existeTurnoActivoPacienteEspecial(nuevo.pacienteDNI, codigoEspecialidad)) return RESULTADO_MEDIDO(ERROR_TURNO_DUPLICADO);
+    if (!fechaHoraValida(dia, mes, anio, hora, minuto)) return RESULTADO_MEDIDO(ERROR_FECHA_INVALIDA);
+
+    nuevo.codigoEspecialidad = codigoEspecialidad;
+    nuevo.dia = dia;
+    nuevo.mes = mes;
+    nuevo.anio = anio;
+    nuevo.hora = hora;
+    nuevo.minuto = minuto;
+    nuevo.estado = ESTADO_ACTIVO;
+    int cupo = estadoCupo(codigoEspecialidad, minutosDeTurno(&nuevo));
+    if (cupo == CUPO_FUERA_DE_HORARIO) return RESULTADO_MEDIDO(ERROR_FUERA_DE_HORARIO);
+    if (cupo == CUPO_COMPLETO) return RESULTADO_MEDIDO(ERROR_SIN_CUPO);
+    nuevo.codigo = proximoCodigoTurno.fetch_add(1);
+    int slot;
+    {
+        lock_guard<mutex> almacen(candadoAlmacen);
+        slot = guardarTurno(nuevo);
+    }
+    indexarTurnoEnEspecialidad(slot);
+    if (!registrarEnLog(LOG_ALTA_TURNO, &nuevo, sizeof(nuevo))) return RESULTADO_MEDIDO(ERROR_LOG);
+    franja.unlock();
+    catalogo.soltar();
+    if (!confirmarRegistroHilo()) return RESULTADO_MEDIDO(ERROR_LOG);
+    codigo = nuevo.codigo;
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* Busca el turno y devuelve su slot (-1 si no existe) y su especialidad (0 si no existe).
+   El slot sigue valido al soltar candadoAlmacen: los bloques del almacen no se mueven. */
+int ubicarTurno(int codigo, int &codigoEspecialidad) {
+    lock_guard<mutex> almacen(candadoAlmacen);
+    int slot = slotDeTurno(codigo);
+    codigoEspecialidad = (slot != -1) ? especialidadEnSlot(slot) : 0;
+    return slot;
+}
+
+/* Cambia fecha/hora de un turno activo (no cambia paciente ni especialidad) */
+int ejecutarModificacionTurno(int codigo, int dia, int mes, int anio, int hora, int minuto) {
+    MEDIR_OPERACION(MEDIDA_MODIFICACION_TURNO);
+    GuardaLectura catalogo(candadoCatalogo);
+    int codigoEspecialidad;
+    int slot = ubicarTurno(codigo, codigoEspecialidad);
+    if (slot == -1) return RESULTADO_MEDIDO(ERROR_TURNO_INEXISTENTE);
+    /* el estado y la fecha de un turno solo cambian con la franja de su especialidad */
+    unique_lock<mutex> franja(franjaEspecialidad(codigoEspecialidad));
+    if (estadoEnSlot(slot) != ESTADO_ACTIVO) return RESULTADO_MEDIDO(ERROR_TURNO_NO_ACTIVO);
+    if (!fechaHoraValida(dia, mes, anio, hora, minuto)) return RESULTADO_MEDIDO(ERROR_FECHA_INVALIDA);
+    RegistroReprogramacion r = { codigo, dia, mes, anio, hora, minuto };
+    int minutosViejos = minutosEnSlot(slot);
+    int minutosNuevos = diasDesdeEpoca(dia, mes, anio) * 1440 + hora * 60 + minuto;
+    int cupo = estadoCupo(codigoEspecialidad, minutosNuevos);
+    if (cupo == CUPO_FUERA_DE_HORARIO) return RESULTADO_MEDIDO(ERROR_FUERA_DE_HORARIO);
+    /* dentro de su misma franja el turno ya tiene su lugar */
+    if (cupo == CUPO_COMPLETO && !mismaFranja(codigoEspecialidad, minutosViejos, minutosNuevos)) return RESULTADO_MEDIDO(ERROR_SIN_CUPO);
+    {
+        lock_guard<mutex> almacen(candadoAlmacen);
+        reprogramarTurnoEnAlmacen(slot, minutosNuevos);
+    }
+    reprogramarTurnoEnEspecialidad(slot, minutosViejos, minutosNuevos);
+    if (!registrarEnLog(LOG_MODIFICACION_TURNO, &r, sizeof(r))) return RESULTADO_MEDIDO(ERROR_LOG);
+    franja.unlock();
+    catalogo.soltar();
+    if (!confirmarRegistroHilo()) return RESULTADO_MEDIDO(ERROR_LOG);
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* Deja en minutosSalida (hasta n) los comienzos de los proximos turnos con cupo libre de la
+   especialidad a partir de desde, y en cantidad cuantos encontro. */
+int ejecutarBusquedaCuposLibres(int codigoEspecialidad, int desde, int n, int *minutosSalida, int &cantidad) {
+    MEDIR_OPERACION(MEDIDA_BUSQUEDA_CUPOS);
+    cantidad = 0;
+    GuardaLectura catalogo(candadoCatalogo);
+    int idx;
+    if (!buscarEspecialidadPorCodigo(codigoEspecialidad, idx)) return RESULTADO_MEDIDO(ERROR_ESPECIALIDAD_INEXISTENTE);
+    lock_guard<mutex> franja(franjaEspecialidad(codigoEspecialidad));
+    cantidad = buscarCuposLibres(codigoEspecialidad, desde, n, minutosSalida);
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* Busquedas por nombre (ver BUSQUEDA DE PACIENTES POR NOMBRE): copian hasta n pacientes a
+   salida y dejan en cantidad cuantos encontro. La aproximada deja ademas en distancias
+   (si no es NULL) cuantas letras difiere cada uno. */
+int ejecutarBusquedaPacientesPorApellido(const char *texto, int n, Paciente *salida, int &cantidad) {
+    MEDIR_OPERACION(MEDIDA_BUSQUEDA_PACIENTES);
+    cantidad = 0;
+    if (esVacio(texto)) return RESULTADO_MEDIDO(ERROR_CAMPO_OBLIGATORIO);
+    if (n <= 0) return RESULTADO_MEDIDO(OPERACION_OK);
+    int *posiciones = new int[n];
+    GuardaLectura catalogo(candadoCatalogo);
+    cantidad = buscarPacientesPorComienzo(texto, n, posiciones);
+    int i;
+    for (i = 0; i < cantidad; i = i + 1) registroDePaciente(posiciones[i], salida[i]);
+    delete[] posiciones;
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+int ejecutarBusquedaPacientesAproximada(const char *texto, int n, Paciente *salida, int *distancias, int &cantidad) {
+    MEDIR_OPERACION(MEDIDA_BUSQUEDA_APROXIMADA);
+    cantidad = 0;
+    if (esVacio(texto)) return RESULTADO_MEDIDO(ERROR_CAMPO_OBLIGATORIO);
+    if (n <= 0) return RESULTADO_MEDIDO(OPERACION_OK);
+    int *posiciones = new int[n];
+    GuardaLectura catalogo(candadoCatalogo);
+    cantidad = buscarPacientesAproximados(texto, n, posiciones, distancias);
+    int i;
+    for (i = 0; i < cantidad; i = i + 1) registroDePaciente(posiciones[i], salida[i]);
+    delete[] posiciones;
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* Cancelacion con regla de 48 horas respecto de minutosAhora (hora civil local en minutos,
+   ver minutosActuales). */
+int ejecutarCancelacionTurno(int codigo, long minutosAhora) {
+    MEDIR_OPERACION(MEDIDA_CANCELACION_TURNO);
+    GuardaLectura catalogo(candadoCatalogo);
+    int codigoEspecialidad;
+    int slot = ubicarTurno(codigo, codigoEspecialidad);
+    if (slot == -1) return RESULTADO_MEDIDO(ERROR_TURNO_INEXISTENTE);
+    unique_lock<mutex> franja(franjaEspecialidad(codigoEspecialidad));
+    if (estadoEnSlot(slot) != ESTADO_ACTIVO) return RESULTADO_MEDIDO(ERROR_TURNO_NO_ACTIVO);
+    /* la fecha se valido al dar el alta: los minutos guardados siempre son una fecha valida */
+    long minutosTurno = minutosEnSlot(slot);
+    if (minutosTurno - minutosAhora < (48L * 60L)) return RESULTADO_MEDIDO(ERROR_PLAZO_CANCELACION); /* menos de 48 horas */
+    {
+        lock_guard<mutex> almacen(candadoAlmacen);
+        cancelarTurnoEnAlmacen(slot);
+    }
+    cancelarTurnoEnEspecialidad(slot);
+    if (!registrarEnLog(LOG_CANCELACION_TURNO, &codigo, sizeof(codigo))) return RESULTADO_MEDIDO(ERROR_LOG);
+    franja.unlock();
+    catalogo.soltar();
+    if (!confirmarRegistroHilo()) return RESULTADO_MEDIDO(ERROR_LOG);
+    return RESULTADO_MEDIDO(OPERACION_OK);
+}
+
+/* Compara los contadores y la tabla de activos con el almacen (verificarContadoresActivos).
+   Con candadoCatalogo exclusivo no hay ninguna operacion de turnos en curso. */
+int ejecutarVerificacionIndices() {
+    GuardaEscritura catalogo(candadoCatalogo);
+    lock_guard<mutex> almacen(candadoAlmacen);
+    return verificarContadoresActivos() ? OPERACION_OK : ERROR_INDICES_INCONSISTENTES;
+}
+
+/* ------- ESTADO Y VOLCADO DE METRICAS ------- */
+
+/* Texto de las metricas (ver METRICAS DE OPERACIONES), una por linea con los campos
+   separados por espacios, para leerlo con cualquier herramienta:
+     operacion NOMBRE llamadas N total_ns N p50_ns N p99_ns N max_ns N
+     resultado NOMBRE CODIGO CANTIDAD MENSAJE     (solo los resultados que ocurrieron)
+     contador NOMBRE VALOR
+   p50 y p99 son el techo de la cubeta del histograma donde caen. Lo devuelven el comando
+   "estado" (modo lote y servidor) y el volcado periodico de --metricas RUTA, que cada
+   --metricas-segundos S (10 por defecto) y al terminar escribe un temporal y lo renombra:
+   quien lee el archivo nunca lo ve a medias. */
+const int TAM_TEXTO_METRICAS = 16 * 1024;
+const int SEGUNDOS_VOLCADO_METRICAS = 10;
+
+#if defined(CON_METRICAS)
+/* Latencia por debajo de la cual cae el percentil de las llamadas (sin pasar del maximo) */
+unsigned long long percentilCubetas(const MetricasHilo &m, int operacion, int percentil) {
+    unsigned long long llamadas = m.llamadas[operacion].load(memory_order_relaxed);
+    unsigned long long maximo = m.maximo[operacion].load(memory_order_relaxed);
+    if (llamadas == 0) return 0;
+    unsigned long long objetivo = (llamadas * (unsigned long long)percentil + 99) / 100;
+    unsigned long long acumuladas = 0;
+    int i;
+    for (i = 0; i < CUBETAS_LATENCIA; i = i + 1) {
+        acumuladas = acumuladas + m.cubetas[operacion][i].load(memory_order_relaxed);
+        if (acumuladas >= objetivo) break;
+    }
+    if (i == CUBETAS_LATENCIA) i = CUBETAS_LATENCIA - 1;
+    unsigned long long techo = techoCubetaLatencia(i);
+    return (techo < maximo) ? techo : maximo;
+}
+#endif
+
+/* Escribe el texto en salida (como maximo tam bytes, con el \0). Devuelve el largo. */
+int escribirMetricas(char *salida, int tam) {
+    int usado = 0;
+#if defined(CON_METRICAS)
+    MetricasHilo *total = new MetricasHilo();
+    sumarMetricas(*total);
+    int i;
+    int j;
+    for (i = 0; i < CANTIDAD_OPERACIONES_MEDIDAS && usado < tam; i = i + 1) {
+        usado = usado + snprintf(salida + usado, tam - usado, "operacion %s llamadas %llu total_ns %llu p50_ns %llu p99_ns %llu max_ns %llu\n",
+                                 NOMBRES_OPERACIONES_MEDIDAS[i], total->llamadas[i].load(), total->nanosegundos[i].load(),
+                                 percentilCubetas(*total, i, 50), percentilCubetas(*total, i, 99), total->maximo[i].load());
+    }
+    for (i = 0; i < CANTIDAD_OPERACIONES_MEDIDAS; i = i + 1) {
+        for (j = 0; j < RESULTADOS_POR_OPERACION && usado < tam; j = j + 1) {
+            unsigned long long cantidad = total->resultados[i][j].load();
+            if (cantidad == 0) continue;
+            usado = usado + snprintf(salida + usado, tam - usado, "resultado %s %d %llu %s\n",
+                                     NOMBRES_OPERACIONES_MEDIDAS[i], j, cantidad, mensajeResultado(j));
+        }
+    }
+    for (i = 0; i < CANTIDAD_CONTADORES_METRICA && usado < tam; i = i + 1) {
+        usado = usado + snprintf(salida + usado, tam - usado, "contador %s %llu\n", NOMBRES_CONTADORES_METRICA[i],
+                                 total->contadores[i].load());
+    }
+    delete total;
+#else
+    usado = snprintf(salida, tam, "# metricas desactivadas (compilado con SIN_METRICAS)\n");
+#endif
+    return (usado < tam) ? usado : tam - 1;
+}
+
+/* Escribe las metricas en ruta (- es la salida estandar) */
+int exportarMetricas(const char *ruta) {
+    char *texto = new char[TAM_TEXTO_METRICAS];
+    int largo = escribirMetricas(texto, TAM_TEXTO_METRICAS);
+    bool ok;
+    if (strcmp(ruta, "-") == 0) {
+        cout.flush();
+        ok = fwrite(texto, 1, largo, stdout) == (size_t)largo;
+        fflush(stdout);
+    } else {
+        FILE *f = fopen(ruta, "w");
+        ok = f != NULL && fwrite(texto, 1, largo, f) == (size_t)largo;
+        if (f != NULL) ok = (fclose(f) == 0) && ok;
+    }
+    delete[] texto;
+    return ok ? OPERACION_OK : ERROR_ARCHIVO;
+}
+
+/* Volcado periodico: un hilo que escribe ruta.tmp y lo renombra a ruta */
+mutex candadoVolcadoMetricas;
+condition_variable finVolcadoMetricas;
+bool volcadoMetricasActivo = false;
+thread hiloVolcadoMetricas;
+
+bool volcarMetricas(const char *ruta) {
+    char temporal[1024];
+    snprintf(temporal, sizeof(temporal), "%s.tmp", ruta);
+    return exportarMetricas(temporal) == OPERACION_OK && reemplazarArchivo(temporal, ruta);
+}
+
+void volcadoPeriodicoMetricas(const char *ruta, int segundos) {
+    unique_lock<mutex> guarda(candadoVolcadoMetricas);
+    while (true) {
+        if (volcadoMetricasActivo) finVolcadoMetricas.wait_for(guarda, chrono::seconds(segundos));
+        bool ultimo = !volcadoMetricasActivo;
+        guarda.unlock();
+        volcarMetricas(ruta);
+        guarda.lock();
+        if (ultimo) return;
+    }
+}
+
+void iniciarVolcadoMetricas(const char *ruta, int segundos) {
+    if (segundos < 1) segundos = 1;
+    volcadoMetricasActivo = true;
+    hiloVolcadoMetricas = thread(volcadoPeriodicoMetricas, ruta, segundos);
+}
+
+/* Detiene el hilo; el ultimo volcado queda con las metricas finales */
+void detenerVolcadoMetricas() {
+    if (!hiloVolcadoMetricas.joinable()) return;
+    {
+        lock_guard<mutex> guarda(candadoVolcadoMetricas);
+        volcadoMetricasActivo = false;
+    }
+    finVolcadoMetricas.notify_all();
+    hiloVolcadoMetricas.join();
+}
+
+/* ------- ESCRITOR DE REPORTES ------- */
+
+/* Los listados y exportaciones se arman en un buffer grande que se reutiliza entre
+   reportes y se escribe con fwrite en bloques, en lugar de un cout << por campo.
+   Los enteros se formatean a mano (de a dos digitos con una tabla). */
+const size_t TAM_BUFFER_REPORTE = 256 * 1024;
+
+enum FormatoReporte {
+    FORMATO_TEXTO = 0, /* el mismo formato de los listados por pantalla */
+    FORMATO_CSV = 1,
+    FORMATO_JSON = 2
+};
+
+enum TipoReporte {
+    REPORTE_PACIENTES = 0,
+    REPORTE_ESPECIALIDADES = 1,
+    REPORTE_TURNOS = 2
+};
+
+const char DIGITOS_PARES[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/* Buffer compartido por todos los reportes (se crea en el primer uso) */
+char *bufferReporte = NULL;
+
+struct EscritorReporte {
+    FILE *destino;
+    char *buffer;
+    size_t usado;
+    bool error;
+};
+
+/* El buffer es unico: no se generan dos reportes a la vez */
+mutex candadoReporte;
+
+void escritorIniciar(EscritorReporte &e, FILE *destino) {
+    if (bufferReporte == NULL) bufferReporte = new char[TAM_BUFFER_REPORTE];
+    e.destino = destino;
+    e.buffer = bufferReporte;
+    e.usado = 0;
+    e.error = false;
+}
+
+void escritorVolcar(EscritorReporte &e) {
+    if (e.usado > 0 && fwrite(e.buffer, 1, e.usado, e.destino) != e.usado) e.error = true;
+    e.usado = 0;
+}
+
+/* Vuelca lo pendiente y devuelve false si hubo algun error de escritura */
+bool escritorFinalizar(EscritorReporte &e) {
+    escritorVolcar(e);
+    if (fflush(e.destino) != 0) e.error = true;
+    return !e.error;
+}
+
+void escribirBytes(EscritorReporte &e, const char *datos, size_t n) {
+    if (n > TAM_BUFFER_REPORTE - e.usado) {
+        escritorVolcar(e);
+        if (n > TAM_BUFFER_REPORTE) {
+            if (fwrite(datos, 1, n, e.destino) != n) e.error = true;
+            return;
+        }
+    }
+    memcpy(e.buffer + e.usado, datos, n);
+    e.usado = e.usado + n;
+}
+
+void escribirTexto(EscritorReporte &e, const char *s) {
+    escribirBytes(e, s, strlen(s));
+}
+
+void escribirCaracter(EscritorReporte &e, char c) {
+    if (e.usado == TAM_BUFFER_REPORTE) escritorVolcar(e);
+    e.buffer[e.usado] = c;
+    e.usado = e.usado + 1;
+}
+
+void escribirEntero(EscritorReporte &e, long long valor) {
+    char tmp[24];
+    int pos = 24;
+    unsigned long long v = (valor < 0) ? 0ULL - (unsigned long long)valor : (unsigned long long)valor;
+    while (v >= 100) {
+        int resto = (int)(v % 100);
+        v = v / 100;
+        pos = pos - 2;
+        memcpy(tmp + pos, DIGITOS_PARES + 2 * resto, 2);
+    }
+    if (v >= 10) {
+        pos = pos - 2;
+        memcpy(tmp + pos, DIGITOS_PARES + 2 * v, 2);
+    } else {
+        pos = pos - 1;
+        tmp[pos] = (char)('0' + v);
+    }
+    if (valor < 0) {
+        pos = pos - 1;
+        tmp[pos] = '-';
+    }
+    escribirBytes(e, tmp + pos, 24 - pos);
+}
+
+/* Entero no negativo con ceros a la izquierda hasta completar ancho digitos */
+void escribirEnteroRelleno(EscritorReporte &e, int valor, int ancho) {
+    char tmp[12];
+    int pos = 12;
+    while ((valor > 0 || 12 - pos < ancho) && pos > 0) {
+        pos = pos - 1;
+        tmp[pos] = (char)('0' + valor % 10);
+        valor = valor / 10;
+    }
+    escribirBytes(e, tmp + pos, 12 - pos);
+}
+
+/* Campo CSV: entre comillas solo si contiene separador, comillas o saltos de linea
+   (el mismo formato que lee el modo lote) */
+void escribirCampoCSV(EscritorReporte &e, const char *s) {
+    if (strpbrk(s, ",\"\r\n") == NULL) {
+        escribirTexto(e, s);
+        return;
+    }
+    escribirCaracter(e, '"');
+    int i;
+    for (i = 0; s[i] != '\0'; i = i + 1) {
+        if (s[i] == '"') escribirCaracter(e, '"');
+        escribirCaracter(e, s[i]);
+    }
+    escribirCaracter(e, '"');
+}
+
+/* Cadena JSON entre comillas; los bytes no ASCII se copian tal cual */
+void escribirCadenaJSON(EscritorReporte &e, const char *s) {
+    escribirCaracter(e, '"');
+    int i;
+    for (i = 0; s[i] != '\0'; i = i + 1) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            escribirCaracter(e, '\\');
+            escribirCaracter(e, (char)c);
+        } else if (c < 0x20) {
+            escribirTexto(e, "\\u00");
+            escribirCaracter(e, "0123456789abcdef"[c >> 4]);
+            escribirCaracter(e, "0123456789abcdef"[c & 15]);
+        } else {
+            escribirCaracter(e, (char)c);
+        }
+    }
+    escribirCaracter(e, '"');
+}
+
+/* Fecha AAAA-MM-DD y hora HH:MM para CSV y JSON */
+void escribirFechaISO(EscritorReporte &e, const Turno *t) {
+    escribirEnteroRelleno(e, t->anio, 4);
+    escribirCaracter(e, '-');
+    escribirEnteroRelleno(e, t->mes, 2);
+    escribirCaracter(e, '-');
+    escribirEnteroRelleno(e, t->dia, 2);
+}
+
+void escribirHoraISO(EscritorReporte &e, const Turno *t) {
+    escribirEnteroRelleno(e, t->hora, 2);
+    escribirCaracter(e, ':');
+    escribirEnteroRelleno(e, t->minuto, 2);
+}
+
+void reportePacientes(EscritorReporte &e, int formato) {
+    int i;
+    if (formato == FORMATO_CSV) escribirTexto(e, "apellido,nombre,dni,telefono\n");
+    if (formato == FORMATO_JSON) escribirCaracter(e, '[');
+    bool primero = true;
+    for (i = 0; i < posicionesPacientes; i = i + 1) {
+        const FichaPaciente &p = pacientes[i];
+        if (p.dni == NULL) continue;
+        if (formato == FORMATO_CSV) {
+            escribirCampoCSV(e, p.apellido);
+            escribirCaracter(e, ',');
+            escribirCampoCSV(e, p.nombre);
+            escribirCaracter(e, ',');
+            escribirCampoCSV(e, p.dni);
+            escribirCaracter(e, ',');
+            escribirCampoCSV(e, p.telefono);
+            escribirCaracter(e, '\n');
+        } else if (formato == FORMATO_JSON) {
+            escribirTexto(e, primero ? "\n{\"apellido\":" : ",\n{\"apellido\":");
+            primero = false;
+            escribirCadenaJSON(e, p.apellido);
+            escribirTexto(e, ",\"nombre\":");
+            escribirCadenaJSON(e, p.nombre);
+            escribirTexto(e, ",\"dni\":");
+            escribirCadenaJSON(e, p.dni);
+            escribirTexto(e, ",\"telefono\":");
+            escribirCadenaJSON(e, p.telefono);
+            escribirCaracter(e, '}');
+        } else {
+            escribirTexto(e, "Apellido: ");
+            escribirTexto(e, p.apellido);
+            escribirTexto(e, " | Nombre: ");
+            escribirTexto(e, p.nombre);
+            escribirTexto(e, " | DNI: ");
+            escribirTexto(e, p.dni);
+            escribirTexto(e, " | Tel: ");
+            escribirTexto(e, p.telefono);
+            escribirCaracter(e, '\n');
+        }
+    }
+    if (formato == FORMATO_JSON) escribirTexto(e, "\n]\n");
+}
+
+void reporteEspecialidades(EscritorReporte &e, int formato) {
     int i;
+    char inicio[6];
+    char fin[6];
+    if (formato == FORMATO_CSV) escribirTexto(e, "codigo,nombre,descripcion,inicio,fin,duracion,cupo\n");
+    if (formato == FORMATO_JSON) escribirCaracter(e, '[');
+    bool primero = true;
+    for (i = 0; i < posicionesEspecialidades; i = i + 1) {
+        const FichaEspecialidad &esp = especialidades[i];
+        if (esp.codigo == 0) continue;
+        formatearHoraDelDia(esp.horario.inicio, inicio);
+        formatearHoraDelDia(esp.horario.fin, fin);
+        if (formato == FORMATO_CSV) {
+            escribirEntero(e, esp.codigo);
+            escribirCaracter(e, ',');
+            escribirCampoCSV(e, esp.nombre);
+            escribirCaracter(e, ',');
+            escribirCampoCSV(e, esp.descripcion);
+            escribirCaracter(e, ',');
+            escribirTexto(e, inicio);
+            escribirCaracter(e, ',');
+            escribirTexto(e, fin);
+            escribirCaracter(e, ',');
+            escribirEntero(e, esp.horario.duracion);
+            escribirCaracter(e, ',');
+            escribirEntero(e, esp.horario.cupo);
+            escribirCaracter(e, '\n');
+        } else if (formato == FORMATO_JSON) {
+            escribirTexto(e, primero ? "\n{\"codigo\":" : ",\n{\"codigo\":");
+            primero = false;
+            escribirEntero(e, esp.codigo);
+            escribirTexto(e, ",\"nombre\":");
+            escribirCadenaJSON(e, esp.nombre);
+            escribirTexto(e, ",\"descripcion\":");
+            escribirCadenaJSON(e, esp.descripcion);
+            escribirTexto(e, ",\"inicio\":");
+            escribirCadenaJSON(e, inicio);
+            escribirTexto(e, ",\"fin\":");
+            escribirCadenaJSON(e, fin);
+            escribirTexto(e, ",\"duracion\":");
+            escribirEntero(e, esp.horario.duracion);
+            escribirTexto(e, ",\"cupo\":");
+            escribirEntero(e, esp.horario.cupo);
+            escribirCaracter(e, '}');
+        } else {
+            escribirTexto(e, "Codigo: ");
+            escribirEntero(e, esp.codigo);
+            escribirTexto(e, " | Nombre: ");
+            escribirTexto(e, esp.nombre);
+            escribirTexto(e, " | Desc: ");
+            escribirTexto(e, esp.descripcion);
+            escribirTexto(e, " | Horario: ");
+            escribirTexto(e, inicio);
+            escribirTexto(e, " a ");
+            escribirTexto(e, fin);
+            escribirTexto(e, ", turnos de ");
+            escribirEntero(e, esp.horario.duracion);
+            escribirTexto(e, " min, cupo ");
+            escribirEntero(e, esp.horario.cupo);
+            escribirCaracter(e, '\n');
+        }
+    }
+    if (formato == FORMATO_JSON) escribirTexto(e, "\n]\n");
+}
+
+/* Recorre una foto del almacen (ver VERSIONES DE TURNOS): no frena altas ni cancelaciones */
+void reporteTurnos(EscritorReporte &e, int formato) {
+    int slot;
+    int escritos = 0;
+    LecturaTurnos lectura;
+    Turno visible;
+    if (formato == FORMATO_CSV) escribirTexto(e, "codigo,fecha,hora,dni,especialidad,estado\n");
+    if (formato == FORMATO_JSON) escribirCaracter(e, '[');
+    iniciarLecturaTurnos(lectura);
+    for (slot = 0; slot < lectura.cantidad; slot = slot + 1) {
+        if (!leerTurnoVisible(lectura, slot, visible)) continue;
+        const Turno *t = &visible;
+        const char *estado = (t->estado == ESTADO_ACTIVO) ? "ACTIVO" : "CANCELADO";
+        if (formato == FORMATO_CSV) {
+            escribirEntero(e, t->codigo);
+            escribirCaracter(e, ',');
+            escribirFechaISO(e, t);
+            escribirCaracter(e, ',');
+            escribirHoraISO(e, t);
+            escribirCaracter(e, ',');
+            escribirCampoCSV(e, t->pacienteDNI);
+            escribirCaracter(e, ',');
+            escribirEntero(e, t->codigoEspecialidad);
+            escribirCaracter(e, ',');
+            escribirTexto(e, estado);
+            escribirCaracter(e, '\n');
+        } else if (formato == FORMATO_JSON) {
+            escribirTexto(e, escritos == 0 ? "\n{\"codigo\":" : ",\n{\"codigo\":");
+            escribirEntero(e, t->codigo);
+            escribirTexto(e, ",\"fecha\":\"");
+            escribirFechaISO(e, t);
+            escribirTexto(e, "\",\"hora\":\"");
+            escribirHoraISO(e, t);
+            escribirTexto(e, "\",\"dni\":");
+            escribirCadenaJSON(e, t->pacienteDNI);
+            escribirTexto(e, ",\"especialidad\":");
+            escribirEntero(e, t->codigoEspecialidad);
+            escribirTexto(e, ",\"estado\":\"");
+            escribirTexto(e, estado);
+            escribirTexto(e, "\"}");
+        } else {
+            escribirTexto(e, "Codigo: ");
+            escribirEntero(e, t->codigo);
+            escribirTexto(e, " | Fecha: ");
+            escribirEntero(e, t->dia);
+            escribirCaracter(e, '/');
+            escribirEntero(e, t->mes);
+            escribirCaracter(e, '/');
+            escribirEntero(e, t->anio);
+            escribirTexto(e, " | Hora: ");
+            escribirEntero(e, t->hora);
+            escribirCaracter(e, ':');
+            escribirEnteroRelleno(e, t->minuto, 2);
+            escribirTexto(e, " | DNI paciente: ");
+            escribirTexto(e, t->pacienteDNI);
+            escribirTexto(e, " | Especialidad: ");
+            escribirEntero(e, t->codigoEspecialidad);
+            escribirTexto(e, " | Estado: ");
+            escribirTexto(e, estado);
+            escribirCaracter(e, '\n');
+        }
+        escritos = escritos + 1;
+    }
+    terminarLecturaTurnos(lectura);
+    if (formato == FORMATO_JSON) escribirTexto(e, "\n]\n");
+}
+
+void generarReporte(EscritorReporte &e, int tipo, int formato) {
+    if (tipo == REPORTE_PACIENTES) {
+        reportePacientes(e, formato);
+    } else if (tipo == REPORTE_ESPECIALIDADES) {
+        reporteEspecialidades(e, formato);
+    } else {
+        reporteTurnos(e, formato);
+    }
+}
+
+/* Escribe el reporte completo en ruta ("-" es la salida estandar) */
+int exportarReporte(int tipo, int formato, const char *ruta) {
+    bool salidaEstandar = strcmp(ruta, "-") == 0;
+    FILE *f = salidaEstandar ? stdout : fopen(ruta, "wb");
+    if (f == NULL) return ERROR_ARCHIVO;
+    lock_guard<mutex> reporte(candadoReporte);
+    /* el escritor ya junta bloques grandes: sin buffer de stdio se evita una copia */
+    if (!salidaEstandar) setvbuf(f, NULL, _IONBF, 0);
+    EscritorReporte e;
+    escritorIniciar(e, f);
+    if (tipo == REPORTE_TURNOS) {
+        generarReporte(e, tipo, formato);
+    } else {
+        GuardaLectura catalogo(candadoCatalogo);
+        generarReporte(e, tipo, formato);
+    }
+    bool ok = escritorFinalizar(e);
+    if (!salidaEstandar && fclose(f) != 0) ok = false;
+    return ok ? OPERACION_OK : ERROR_ARCHIVO;
+}
+
+void liberarBufferReporte() {
+    delete[] bufferReporte;
+    bufferReporte = NULL;
+}
+
+/* ------- FUNCIONES PARA PACIENTES (ABM) ------- */
+
+void altaPaciente() {
+    Paciente nuevo;
+    cout << "Alta de paciente\n";
+    cout << "Apellido: ";
+    cin.getline(nuevo.apellido, 51);
+    if (esVacio(nuevo.apellido)) {
+        cout << "Apellido obligatorio. Alta abortada.\n";
+        return;
+    }
+
+    cout << "Nombre: ";
+    cin.getline(nuevo.nombre, 51);
+    if (esVacio(nuevo.nombre)) {
+        cout << "Nombre obligatorio. Alta abortada.\n";
+        return;
+    }
+
+    cout << "DNI: ";
+    cin.getline(nuevo.dni, 15);
+    if (esVacio(nuevo.dni)) {
+        cout << "DNI obligatorio. Alta abortada.\n";
+        return;
+    }
+    /* comprobar dni unico antes de pedir el resto */
+    int idxPaciente;
+    if (buscarPacientePorDNI(nuevo.dni, idxPaciente)) {
+        cout << "Ya existe un paciente con ese DNI. Alta abortada.\n";
+        return;
+    }
+
+    cout << "Telefono: ";
+    cin.getline(nuevo.telefono, 21);
+    if (esVacio(nuevo.telefono)) {
+        cout << "Telefono obligatorio. Alta abortada.\n";
+        return;
+    }
+
+    int resultado = ejecutarAltaPaciente(nuevo.apellido, nuevo.nombre, nuevo.dni, nuevo.telefono);
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << " Alta abortada.\n";
+        return;
+    }
+    cout << "Paciente dado de alta correctamente.\n";
+}
+
+void modificacionPaciente() {
+    char dni[15];
+    cout << "Modificacion de paciente - Ingrese DNI: ";
+    cin.getline(dni, 15);
+    int idx;
+    if (!buscarPacientePorDNI(dni, idx)) {
+        cout << "Paciente no encontrado.\n";
+        return;
+    }
+    cout << "Paciente encontrado: " << pacientes[idx].apellido << ", " << pacientes[idx].nombre << "\n";
+    cout << "1) Modificar nombre\n2) Modificar apellido\n3) Modificar telefono\nElija opcion (1-3): ";
+    char opcion[4];
+    cin.getline(opcion, 4);
+
+    char valor[51];
+    int resultado;
+    if (strcmp(opcion, "1") == 0) {
+        cout << "Nuevo nombre: ";
+        cin.getline(valor, 51);
+        resultado = ejecutarModificacionPaciente(dni, NULL, valor, NULL);
+    } else if (strcmp(opcion, "2") == 0) {
+        cout << "Nuevo apellido: ";
+        cin.getline(valor, 51);
+        resultado = ejecutarModificacionPaciente(dni, valor, NULL, NULL);
+    } else if (strcmp(opcion, "3") == 0) {
+        cout << "Nuevo telefono: ";
+        cin.getline(valor, 21);
+        resultado = ejecutarModificacionPaciente(dni, NULL, NULL, valor);
+    } else {
+        cout << "Opcion invalida.\n";
+        return;
+    }
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << "\n";
+        return;
+    }
+    cout << "Datos actualizados.\n";
+}
+
+void bajaPaciente() {
+    char dni[15];
+    cout << "Baja de paciente - Ingrese DNI: ";
+    cin.getline(dni, 15);
+    int resultado = ejecutarBajaPaciente(dni);
+    if (resultado == ERROR_TURNOS_ACTIVOS) {
+        cout << "No se puede eliminar paciente: posee " << contarTurnosActivosPaciente(dni) << " turno(s) activo(s).\n";
+        return;
+    }
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << "\n";
+        return;
+    }
+    cout << "Paciente eliminado correctamente.\n";
+}
+void listadoPacientesCompleto() {
     if (cantidadPacientes == 0) {
         cout << "No hay pacientes registrados.\n";
         return;
     }
-    cout << "Listado de pacientes:\n";
-    for (i = 0; i < cantidadPacientes; i = i + 1) {
-        cout << "Apellido: " << pacientes[i].apellido << " | Nombre: " << pacientes[i].nombre
-             << " | DNI: " << pacientes[i].dni << " | Tel: " << pacientes[i].telefono << "\n";
+    cout << "Listado de pacientes:\n";
+    exportarReporte(REPORTE_PACIENTES, FORMATO_TEXTO, "-");
+}
+
+void buscarPaciente() {
+    char dni[15];
+    cout << "Busqueda paciente por DNI: ";
+    cin.getline(dni, 15);
+    int idx;
+    if (!buscarPacientePorDNI(dni, idx)) {
+        cout << "Paciente no encontrado.\n";
+        return;
+    }
+    cout << "Apellido: " << pacientes[idx].apellido << "\n";
+    cout << "Nombre: " << pacientes[idx].nombre << "\n";
+    cout << "Telefono: " << pacientes[idx].telefono << "\n";
+}
+
+const int MAXIMO_PACIENTES_POR_BUSQUEDA = 20;
+
+void mostrarPacientesEncontrados(const Paciente *encontrados, const int *distancias, int cantidad) {
+    if (cantidad == 0) {
+        cout << "No se encontraron pacientes.\n";
+        return;
+    }
+    int i;
+    for (i = 0; i < cantidad; i = i + 1) {
+        cout << encontrados[i].apellido << ", " << encontrados[i].nombre << " | DNI: " << encontrados[i].dni
+             << " | Tel: " << encontrados[i].telefono;
+        if (distancias != NULL && distancias[i] > 0) cout << " (difiere en " << distancias[i] << " letra(s))";
+        cout << "\n";
+    }
+    if (cantidad == MAXIMO_PACIENTES_POR_BUSQUEDA) {
+        cout << "Se muestran los primeros " << MAXIMO_PACIENTES_POR_BUSQUEDA << "; precise la busqueda para ver otros.\n";
+    }
+}
+
+void buscarPacientePorApellido() {
+    char texto[51];
+    cout << "Comienzo del apellido (o Apellido, comienzo del nombre): ";
+    cin.getline(texto, 51);
+    Paciente encontrados[MAXIMO_PACIENTES_POR_BUSQUEDA];
+    int cantidad;
+    int resultado = ejecutarBusquedaPacientesPorApellido(texto, MAXIMO_PACIENTES_POR_BUSQUEDA, encontrados, cantidad);
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << "\n";
+        return;
+    }
+    mostrarPacientesEncontrados(encontrados, NULL, cantidad);
+}
+
+/* Tolera errores de tipeo en un apellido o un nombre */
+void buscarPacienteAproximado() {
+    char texto[51];
+    cout << "Apellido o nombre (aproximado): ";
+    cin.getline(texto, 51);
+    Paciente encontrados[MAXIMO_PACIENTES_POR_BUSQUEDA];
+    int distancias[MAXIMO_PACIENTES_POR_BUSQUEDA];
+    int cantidad;
+    int resultado = ejecutarBusquedaPacientesAproximada(texto, MAXIMO_PACIENTES_POR_BUSQUEDA, encontrados, distancias, cantidad);
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << "\n";
+        return;
+    }
+    mostrarPacientesEncontrados(encontrados, distancias, cantidad);
+}
+
+/* ------- FUNCIONES PARA ESPECIALIDADES (ABM) ------- */
+
+/* Pide el horario de atencion. Cada dato dejado vacio conserva el valor que ya tiene h,
+   que se muestra entre parentesis; la validacion la hace la operacion. */
+void pedirHorario(HorarioAtencion &h) {
+    char buffer[10];
+    char hora[6];
+    formatearHoraDelDia(h.inicio, hora);
+    cout << "Inicio de atencion HH:MM (vacio = " << hora << "): ";
+    cin.getline(buffer, 10);
+    if (!esVacio(buffer)) h.inicio = leerHoraDelDia(buffer);
+    formatearHoraDelDia(h.fin, hora);
+    cout << "Fin de atencion HH:MM (vacio = " << hora << "): ";
+    cin.getline(buffer, 10);
+    if (!esVacio(buffer)) h.fin = leerHoraDelDia(buffer);
+    cout << "Duracion de cada turno en minutos (vacio = " << h.duracion << "): ";
+    cin.getline(buffer, 10);
+    if (!esVacio(buffer)) h.duracion = atoi(buffer);
+    cout << "Pacientes por turno (vacio = " << h.cupo << "): ";
+    cin.getline(buffer, 10);
+    if (!esVacio(buffer)) h.cupo = atoi(buffer);
+}
+
+void altaEspecialidad() {
+    char nombre[51];
+    char descripcion[101];
+
+    cout << "Alta de especialidad\n";
+    cout << "Nombre: ";
+    cin.getline(nombre, 51);
+    if (esVacio(nombre)) {
+        cout << "Nombre obligatorio. Alta abortada.\n";
+        return;
+    }
+    cout << "Descripcion (opcional): ";
+    cin.getline(descripcion, 101);
+    HorarioAtencion horario = HORARIO_POR_DEFECTO;
+    pedirHorario(horario);
+
+    int codigo;
+    int resultado = ejecutarAltaEspecialidad(nombre, descripcion, horario, codigo);
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << " Alta abortada.\n";
+        return;
+    }
+    cout << "Especialidad dada de alta. Codigo: " << codigo << "\n";
+}
+
+void modificacionEspecialidad() {
+    char buffer[10];
+    cout << "Modificacion de especialidad - Ingrese codigo: ";
+    cin.getline(buffer, 10);
+    int codigo = atoi(buffer);
+    int idx;
+    if (!buscarEspecialidadPorCodigo(codigo, idx)) {
+        cout << "Especialidad no encontrada.\n";
+        return;
+    }
+    char nombre[51];
+    char descripcion[101];
+    cout << "Nombre actual: " << especialidades[idx].nombre << "\n";
+    cout << "Nuevo nombre: ";
+    cin.getline(nombre, 51);
+    cout << "Nueva descripcion: ";
+    cin.getline(descripcion, 101);
+    HorarioAtencion horario = especialidades[idx].horario;
+    pedirHorario(horario);
+    int resultado = ejecutarModificacionEspecialidad(codigo, nombre, descripcion, &horario);
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << "\n";
+        return;
+    }
+    cout << "Especialidad modificada.\n";
+}
+
+void bajaEspecialidad() {
+    char buffer[10];
+    cout << "Baja de especialidad - Ingrese codigo: ";
+    cin.getline(buffer, 10);
+    int codigo = atoi(buffer);
+    int resultado = ejecutarBajaEspecialidad(codigo);
+    if (resultado == ERROR_TURNOS_ACTIVOS) {
+        cout << "No se puede eliminar: la especialidad tiene " << contarTurnosActivosEspecialidad(codigo)
+             << " turno(s) activo(s).\n";
+        return;
+    }
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << "\n";
+        return;
+    }
+    cout << "Especialidad eliminada.\n";
+}
+void listadoEspecialidadesCompleto() {
+    if (cantidadEspecialidades == 0) {
+        cout << "No hay especialidades registradas.\n";
+        return;
+    }
+    cout << "Listado de especialidades:\n";
+    exportarReporte(REPORTE_ESPECIALIDADES, FORMATO_TEXTO, "-");
+}
+
+void buscarEspecialidad() {
+    char buffer[10];
+    cout << "Busqueda especialidad por codigo: ";
+    cin.getline(buffer, 10);
+    int codigo = atoi(buffer);
+    int idx;
+    if (!buscarEspecialidadPorCodigo(codigo, idx)) {
+        cout << "Especialidad no encontrada.\n";
+        return;
+    }
+    cout << "Codigo: " << especialidades[idx].codigo << "\n";
+    cout << "Nombre: " << especialidades[idx].nombre << "\n";
+    cout << "Descripcion: " << especialidades[idx].descripcion << "\n";
+    char inicio[6];
+    char fin[6];
+    formatearHoraDelDia(especialidades[idx].horario.inicio, inicio);
+    formatearHoraDelDia(especialidades[idx].horario.fin, fin);
+    cout << "Horario: " << inicio << " a " << fin << ", turnos de " << especialidades[idx].horario.duracion
+         << " min, cupo " << especialidades[idx].horario.cupo << "\n";
+}
+
+/* ------- FUNCIONES PARA TURNOS (almacen por bloques) ------- */
+
+/* Muestra los proximos n horarios con cupo de la especialidad a partir de desde */
+void mostrarCuposLibres(int codigoEsp, int desde, int n) {
+    int minutos[100];
+    int cantidad;
+    if (n > 100) n = 100;
+    int resultado = ejecutarBusquedaCuposLibres(codigoEsp, desde, n, minutos, cantidad);
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << "\n";
+        return;
+    }
+    if (cantidad == 0) {
+        cout << "No hay horarios libres en el proximo anio.\n";
+        return;
+    }
+    cout << "Proximos horarios libres:\n";
+    int i;
+    for (i = 0; i < cantidad; i = i + 1) {
+        int dia, mes, anio;
+        int dias = divisionPiso(minutos[i], 1440);
+        int minutoDelDia = minutos[i] - dias * 1440;
+        fechaDesdeDias(dias, dia, mes, anio);
+        cout << "Fecha: " << dia << "/" << mes << "/" << anio << " Hora: " << minutoDelDia / 60 << ":"
+             << (minutoDelDia % 60 < 10 ? "0" : "") << minutoDelDia % 60 << "\n";
+    }
+}
+
+/* Alta de turno: pide los datos y delega la validacion y el registro en ejecutarAltaTurno */
+void altaTurno() {
+    if (cantidadPacientes == 0) {
+        cout << "No hay pacientes registrados. Alta de turno imposible.\n";
+        return;
+    }
+    if (cantidadEspecialidades == 0) {
+        cout << "No hay especialidades registradas. Alta de turno imposible.\n";
+        return;
+    }
+
+    cout << "Alta de turno\n";
+    char buffer[10];
+    char dni[15];
+
+    cout << "DNI del paciente: ";
+    cin.getline(dni, 15);
+    if (esVacio(dni)) {
+        cout << "DNI obligatorio. Alta abortada.\n";
+        return;
+    }
+    int idxPac;
+    if (!buscarPacientePorDNI(dni, idxPac)) {
+        cout << "Paciente no registrado. Alta abortada.\n";
+        return;
+    }
+
+    cout << "Codigo de especialidad: ";
+    cin.getline(buffer, 10);
+    int codEsp = atoi(buffer);
+    int idxEsp;
+    if (!buscarEspecialidadPorCodigo(codEsp, idxEsp)) {
+        cout << "Especialidad no encontrada. Alta abortada.\n";
+        return;
+    }
+
+    /* evitar carga duplicada paciente+especialidad (activo) antes de pedir la fecha */
+    if (existeTurnoActivoPacienteEspecial(dni, codEsp)) {
+        cout << "El paciente ya tiene un turno activo para esa especialidad. Alta abortada.\n";
+        return;
+    }
+
+    /* Leer fecha y hora como enteros */
+    int dia, mes, anio, hora, minuto;
+    cout << "Fecha - dia: ";
+    cin.getline(buffer, 10); dia = atoi(buffer);
+    cout << "Fecha - mes: ";
+    cin.getline(buffer, 10); mes = atoi(buffer);
+    cout << "Fecha - anio: ";
+    cin.getline(buffer, 10); anio = atoi(buffer);
+    cout << "Hora (0-23): ";
+    cin.getline(buffer, 10); hora = atoi(buffer);
+    cout << "Minuto (0-59): ";
+    cin.getline(buffer, 10); minuto = atoi(buffer);
+
+    int codigo;
+    int resultado = ejecutarAltaTurno(dni, codEsp, dia, mes, anio, hora, minuto, codigo);
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << " Alta abortada.\n";
+        if (resultado == ERROR_SIN_CUPO || resultado == ERROR_FUERA_DE_HORARIO) {
+            mostrarCuposLibres(codEsp, (int)convertirFechaHoraAMinutos(dia, mes, anio, hora, minuto), 5);
+        }
+        return;
+    }
+    cout << "Turno creado. Codigo: " << codigo << "\n";
+}
+
+/* Modificar turno: busca por codigo y permite cambiar fecha/hora (no cambia paciente ni especialidad) */
+void modificacionTurno() {
+    char buffer[10];
+    cout << "Modificacion de turno - Ingrese codigo de turno: ";
+    cin.getline(buffer, 10);
+    int codigo = atoi(buffer);
+    int slot = slotDeTurno(codigo);
+    if (slot == -1) {
+        cout << "Turno no encontrado.\n";
+        return;
+    }
+    if (estadoEnSlot(slot) != ESTADO_ACTIVO) {
+        cout << "Solo se pueden modificar turnos activos.\n";
+        return;
+    }
+
+    int dia, mes, anio, hora, minuto;
+    cout << "Ingrese nueva fecha y hora:\n";
+    cout << "Dia: "; cin.getline(buffer, 10); dia = atoi(buffer);
+    cout << "Mes: "; cin.getline(buffer, 10); mes = atoi(buffer);
+    cout << "Anio: "; cin.getline(buffer, 10); anio = atoi(buffer);
+    cout << "Hora: "; cin.getline(buffer, 10); hora = atoi(buffer);
+    cout << "Minuto: "; cin.getline(buffer, 10); minuto = atoi(buffer);
+
+    /* La validacion ocurre antes de tocar el turno, para no dejarlo a medio modificar */
+    int resultado = ejecutarModificacionTurno(codigo, dia, mes, anio, hora, minuto);
+    if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << " No se modifico.\n";
+        if (resultado == ERROR_SIN_CUPO || resultado == ERROR_FUERA_DE_HORARIO) {
+            mostrarCuposLibres(especialidadEnSlot(slot), (int)convertirFechaHoraAMinutos(dia, mes, anio, hora, minuto), 5);
+        }
+        return;
+    }
+    cout << "Turno modificado correctamente.\n";
+}
+
+/* Cancelacion de turno con regla de 48 horas: si falta menos de 48h no se permite la cancelacion. */
+void cancelacionTurno() {
+    char buffer[10];
+    cout << "Cancelacion de turno - Ingrese codigo de turno: ";
+    cin.getline(buffer, 10);
+    int codigo = atoi(buffer);
+    int resultado = ejecutarCancelacionTurno(codigo, minutosActuales());
+    if (resultado == ERROR_TURNO_NO_ACTIVO) {
+        cout << "El turno ya esta cancelado.\n";
+    } else if (resultado == ERROR_PLAZO_CANCELACION) {
+        cout << "No se puede cancelar el turno: falta menos de 48 horas.\n";
+    } else if (resultado == ERROR_FECHA_INVALIDA) {
+        cout << "Error al interpretar fecha/hora del turno. Cancelacion no realizada.\n";
+    } else if (resultado != OPERACION_OK) {
+        cout << mensajeResultado(resultado) << "\n";
+    } else {
+        cout << "Turno cancelado correctamente.\n";
+    }
+}
+
+/* Listado completo de turnos (muestra todos o filtra por estado) */
+void listadoTurnosCompleto() {
+    if (cantidadTurnos == 0) {
+        cout << "No hay turnos registrados.\n";
+        return;
+    }
+    cout << "Listado de turnos:\n";
+    exportarReporte(REPORTE_TURNOS, FORMATO_TEXTO, "-");
+}
+
+/* Filtro avanzado: estado, especialidades (varias se combinan con O), DNI y rango de fechas,
+   todo combinado con Y. No usa indices: cada condicion recorre una columna de la foto del
+   almacen con los filtros vectoriales, sin candados (ver seleccionarFiltro), asi un
+   filtro largo no frena las altas. */
+void filtroAvanzadoTurnos() {
+    char estado[4];
+    char lista[101];
+    char dni[15];
+    char fecha[16];
+    FiltroTurnos filtro;
+    filtroTurnosIniciar(filtro);
+    int dias;
+    cout << "Estado (A = activos, C = cancelados, vacio = todos): ";
+    cin.getline(estado, 4);
+    if (strcmp(estado, "A") == 0 || strcmp(estado, "a") == 0) filtro.estado = ESTADO_ACTIVO;
+    else if (strcmp(estado, "C") == 0 || strcmp(estado, "c") == 0) filtro.estado = ESTADO_CANCELADO;
+    else if (!esVacio(estado)) {
+        cout << "Estado invalido.\n";
+        return;
+    }
+    cout << "Codigos de especialidad separados por coma (vacio = todas): ";
+    cin.getline(lista, 101);
+    cout << "DNI (vacio = todos): ";
+    cin.getline(dni, 15);
+    cout << "Desde fecha dd/mm/aaaa (vacio = sin limite): ";
+    cin.getline(fecha, 16);
+    if (!esVacio(fecha)) {
+        if (!leerFecha(fecha, dias)) {
+            cout << "Fecha invalida.\n";
+            return;
+        }
+        filtro.desde = dias * 1440;
+    }
+    cout << "Hasta fecha dd/mm/aaaa (vacio = sin limite): ";
+    cin.getline(fecha, 16);
+    if (!esVacio(fecha)) {
+        if (!leerFecha(fecha, dias)) {
+            cout << "Fecha invalida.\n";
+            return;
+        }
+        filtro.hasta = (dias + 1) * 1440 - 1; /* incluye todo el ultimo dia */
+    }
+    if (!esVacio(lista)) {
+        char *p = lista;
+        while (*p != '\0') {
+            char *fin;
+            long codigo = strtol(p, &fin, 10);
+            if (fin == p) {
+                p = p + 1;
+                continue;
+            }
+            filtroTurnosAgregarEspecialidad(filtro, (int)codigo);
+            p = fin;
+        }
+        /* una lista sin ningun codigo no deja pasar nada */
+        if (filtro.cantidadEspecialidades == 0) filtroTurnosAgregarEspecialidad(filtro, -1);
+    }
+    if (!esVacio(dni)) {
+        GuardaLectura catalogo(candadoCatalogo);
+        filtro.porPaciente = true;
+        filtro.paciente = idDeDNI(dni);
+    }
+
+    SeleccionTurnos resultado = { NULL, 0, 0 };
+    LecturaTurnos lectura;
+    {
+        MEDIR_OPERACION(MEDIDA_FILTRO_TURNOS);
+        iniciarLecturaTurnos(lectura);
+        seleccionarFiltro(lectura, filtro, resultado);
+    }
+
+    int encontrados = 0;
+    int slot = seleccionSiguiente(resultado, 0);
+    while (slot != -1) {
+        FilaTurno fila;
+        if (leerFilaVisible(lectura, slot, fila) && filaCumpleFiltro(fila, filtro)) {
+            Turno actual;
+            turnoDesdeFila(fila, actual);
+            cout << "Codigo: " << actual.codigo << " Fecha: " << actual.dia << "/" << actual.mes << "/" << actual.anio
+                 << " Hora: " << actual.hora << ":" << (actual.minuto < 10 ? "0" : "") << actual.minuto
+                 << " DNI: " << actual.pacienteDNI << " Especialidad: " << actual.codigoEspecialidad
+                 << " Estado: " << (actual.estado == ESTADO_ACTIVO ? "ACTIVO" : "CANCELADO") << "\n";
+            encontrados = encontrados + 1;
+        }
+        slot = seleccionSiguiente(resultado, slot + 1);
+    }
+    terminarLecturaTurnos(lectura);
+    seleccionLiberar(resultado);
+    if (encontrados == 0) cout << "No hay turnos que cumplan el filtro.\n";
+    else cout << "Turnos encontrados: " << encontrados << "\n";
+}
+
+/* Búsqueda de turnos por filtros simples (por paciente DNI, por fecha, por especialidad,
+   por rango de fechas o proximos de una especialidad), y de horarios libres. Los indices y
+   agendas solo se pueden recorrer con candadoAlmacen o la franja, que frenarian las altas
+   mientras dura el recorrido; por eso cada opcion es un filtro sobre las columnas de una
+   foto del almacen, sin candados, como el filtro avanzado (ver seleccionarFiltro), y los
+   resultados se ordenan por fecha y hora como en la agenda. */
+void buscarTurnosPorFiltro() {
+    cout << "Opciones de busqueda:\n";
+    cout << "1) Por DNI de paciente\n";
+    cout << "2) Por fecha (dia,mes,anio)\n";
+    cout << "3) Por codigo de especialidad\n";
+    cout << "4) Por rango de fechas (agenda)\n";
+    cout << "5) Proximos turnos activos de una especialidad\n";
+    cout << "6) Proximos horarios libres de una especialidad\n";
+    cout << "7) Filtro avanzado (estado, especialidades, DNI y fechas combinados)\n";
+    cout << "Elija opcion (1-7): ";
+    char opcion[4];
+    cin.getline(opcion, 4);
+    char buffer[10];
+    char dni[15];
+    int codigo = 0;
+    int desde = 0;
+    int hasta = 0;
+    int n = 0;
+    bool fechaValida = true;
+    if (strcmp(opcion, "1") == 0) {
+        cout << "Ingrese DNI: ";
+        cin.getline(dni, 15);
+    } else if (strcmp(opcion, "2") == 0) {
+        int dia, mes, anio;
+        cout << "Dia: "; cin.getline(buffer, 10); dia = atoi(buffer);
+        cout << "Mes: "; cin.getline(buffer, 10); mes = atoi(buffer);
+        cout << "Anio: "; cin.getline(buffer, 10); anio = atoi(buffer);
+        fechaValida = fechaHoraValida(dia, mes, anio, 0, 0);
+        if (fechaValida) {
+            desde = diasDesdeEpoca(dia, mes, anio) * 1440;
+            hasta = desde + 1440;
+        }
+    } else if (strcmp(opcion, "3") == 0) {
+        cout << "Codigo de especialidad: ";
+        cin.getline(buffer, 10);
+        codigo = atoi(buffer);
+    } else if (strcmp(opcion, "4") == 0) {
+        /* ambos extremos incluidos: desde las 00:00 del primer dia hasta el fin del ultimo */
+        int dia1, mes1, anio1, dia2, mes2, anio2;
+        cout << "Desde - Dia: "; cin.getline(buffer, 10); dia1 = atoi(buffer);
+        cout << "Desde - Mes: "; cin.getline(buffer, 10); mes1 = atoi(buffer);
+        cout << "Desde - Anio: "; cin.getline(buffer, 10); anio1 = atoi(buffer);
+        cout << "Hasta - Dia: "; cin.getline(buffer, 10); dia2 = atoi(buffer);
+        cout << "Hasta - Mes: "; cin.getline(buffer, 10); mes2 = atoi(buffer);
+        cout << "Hasta - Anio: "; cin.getline(buffer, 10); anio2 = atoi(buffer);
+        if (!fechaHoraValida(dia1, mes1, anio1, 0, 0) || !fechaHoraValida(dia2, mes2, anio2, 0, 0)) {
+            cout << "Fecha invalida.\n";
+            return;
+        }
+        desde = diasDesdeEpoca(dia1, mes1, anio1) * 1440;
+        hasta = (diasDesdeEpoca(dia2, mes2, anio2) + 1) * 1440;
+    } else if (strcmp(opcion, "5") == 0) {
+        cout << "Codigo de especialidad: ";
+        cin.getline(buffer, 10);
+        codigo = atoi(buffer);
+        cout << "Cantidad de turnos a mostrar: ";
+        cin.getline(buffer, 10);
+        n = atoi(buffer);
+        if (n < 1) n = 1;
+        if (n > 100) n = 100;
+    } else if (strcmp(opcion, "6") == 0) {
+        /* no lista turnos sino franjas con cupo: se resuelve con los mapas de ocupacion */
+        int dia, mes, anio;
+        cout << "Codigo de especialidad: ";
+        cin.getline(buffer, 10);
+        codigo = atoi(buffer);
+        cout << "Desde - Dia: "; cin.getline(buffer, 10); dia = atoi(buffer);
+        cout << "Desde - Mes: "; cin.getline(buffer, 10); mes = atoi(buffer);
+        cout << "Desde - Anio: "; cin.getline(buffer, 10); anio = atoi(buffer);
+        cout << "Cantidad de horarios a mostrar: ";
+        cin.getline(buffer, 10);
+        n = atoi(buffer);
+        if (n < 1) n = 1;
+        if (!fechaHoraValida(dia, mes, anio, 0, 0)) {
+            cout << "Fecha invalida.\n";
+            return;
+        }
+        mostrarCuposLibres(codigo, diasDesdeEpoca(dia, mes, anio) * 1440, n);
+        return;
+    } else if (strcmp(opcion, "7") == 0) {
+        filtroAvanzadoTurnos();
+        return;
+    } else {
+        cout << "Opcion invalida.\n";
+        return;
+    }
+
+    FiltroTurnos filtro;
+    filtroTurnosIniciar(filtro);
+    if (strcmp(opcion, "1") == 0) {
+        GuardaLectura catalogo(candadoCatalogo);
+        filtro.porPaciente = true;
+        filtro.paciente = idDeDNI(dni);
+    } else if (strcmp(opcion, "3") == 0) {
+        filtroTurnosAgregarEspecialidad(filtro, codigo);
+    } else if (strcmp(opcion, "5") == 0) {
+        filtroTurnosAgregarEspecialidad(filtro, codigo);
+        filtro.estado = ESTADO_ACTIVO;
+        filtro.desde = (int)minutosActuales();
+    } else if (fechaValida) {
+        filtro.desde = desde;
+        filtro.hasta = hasta - 1;
+    } else {
+        filtro.desde = 0;
+        filtro.hasta = -1;
+    }
+
+    /* filtrar la foto sin candados y confirmar cada candidato en la version de la foto */
+    EntradaAgenda *encontrados;
+    int cantidad = 0;
+    LecturaTurnos lectura;
+    {
+        MEDIR_OPERACION(MEDIDA_BUSQUEDA_TURNOS);
+        SeleccionTurnos candidatos = { NULL, 0, 0 };
+        iniciarLecturaTurnos(lectura);
+        seleccionarFiltro(lectura, filtro, candidatos);
+        int maximo = seleccionContar(candidatos);
+        encontrados = new EntradaAgenda[maximo > 0 ? maximo : 1];
+        int slot = seleccionSiguiente(candidatos, 0);
+        while (slot != -1) {
+            FilaTurno fila;
+            if (leerFilaVisible(lectura, slot, fila) && filaCumpleFiltro(fila, filtro)) {
+                encontrados[cantidad].minutos = fila.minutos;
+                encontrados[cantidad].slot = slot;
+                cantidad = cantidad + 1;
+            }
+            slot = seleccionSiguiente(candidatos, slot + 1);
+        }
+        seleccionLiberar(candidatos);
+        /* por DNI quedan en orden de alta; las demas, en el orden de la agenda */
+        if (strcmp(opcion, "1") != 0 && cantidad > 1) {
+            qsort(encontrados, cantidad, sizeof(EntradaAgenda), compararEntradasAgenda);
+        }
+        if (strcmp(opcion, "5") == 0 && cantidad > n) cantidad = n;
+    }
+
+    int i;
+    for (i = 0; i < cantidad; i = i + 1) {
+        Turno visible;
+        if (!leerTurnoVisible(lectura, encontrados[i].slot, visible)) continue;
+        Turno *actual = &visible;
+        if (strcmp(opcion, "1") == 0) {
+            cout << "Codigo: " << actual->codigo << " Fecha: " << actual->dia << "/" << actual->mes << "/" << actual->anio
+                 << " Hora: " << actual->hora << ":" << (actual->minuto < 10 ? "0" : "") << actual->minuto
+                 << " Estado: " << (actual->estado == ESTADO_ACTIVO ? "ACTIVO" : "CANCELADO") << "\n";
+        } else if (strcmp(opcion, "2") == 0) {
+            cout << "Codigo: " << actual->codigo << " Hora: " << actual->hora << ":" << (actual->minuto < 10 ? "0" : "") << actual->minuto
+                 << " DNI: " << actual->pacienteDNI << " Estado: " << (actual->estado == ESTADO_ACTIVO ? "ACTIVO" : "CANCELADO") << "\n";
+        } else if (strcmp(opcion, "3") == 0) {
+            cout << "Codigo: " << actual->codigo << " Fecha: " << actual->dia << "/" << actual->mes << "/" << actual->anio
+                 << " Hora: " << actual->hora << ":" << (actual->minuto < 10 ? "0" : "") << actual->minuto
+                 << " DNI: " << actual->pacienteDNI << " Estado: " << (actual->estado == ESTADO_ACTIVO ? "ACTIVO" : "CANCELADO") << "\n";
+        } else if (strcmp(opcion, "4") == 0) {
+            cout << "Codigo: " << actual->codigo << " Fecha: " << actual->dia << "/" << actual->mes << "/" << actual->anio
+                 << " Hora: " << actual->hora << ":" << (actual->minuto < 10 ? "0" : "") << actual->minuto
+                 << " DNI: " << actual->pacienteDNI << " Especialidad: " << actual->codigoEspecialidad
+                 << " Estado: " << (actual->estado == ESTADO_ACTIVO ? "ACTIVO" : "CANCELADO") << "\n";
+        } else {
+            cout << "Codigo: " << actual->codigo << " Fecha: " << actual->dia << "/" << actual->mes << "/" << actual->anio
+                 << " Hora: " << actual->hora << ":" << (actual->minuto < 10 ? "0" : "") << actual->minuto
+                 << " DNI: " << actual->pacienteDNI << "\n";
+        }
+    }
+    terminarLecturaTurnos(lectura);
+    if (cantidad == 0) {
+        if (strcmp(opcion, "1") == 0) cout << "No se encontraron turnos para ese DNI.\n";
+        else if (strcmp(opcion, "2") == 0) cout << "No hay turnos en esa fecha.\n";
+        else if (strcmp(opcion, "3") == 0) cout << "No se encontraron turnos para esa especialidad.\n";
+        else if (strcmp(opcion, "4") == 0) cout << "No hay turnos en ese rango.\n";
+        else cout << "No hay turnos proximos para esa especialidad.\n";
+    }
+    delete[] encontrados;
+}
+
+/* ------- MODO LOTE ------- */
+
+/* Ejecuta comandos sin menus, uno por linea, leidos de un archivo o de la entrada estandar
+   (--lote RUTA, o --lote - para stdin). Cada linea es un registro CSV cuyo primer campo es
+   el comando; los campos pueden ir entre comillas dobles ("" dentro de comillas es una comilla).
+   Las lineas vacias y las que empiezan con # se ignoran.
+
+     alta paciente,APELLIDO,NOMBRE,DNI,TELEFONO
+     modificar paciente,DNI,APELLIDO,NOMBRE,TELEFONO
+     baja paciente,DNI
+     alta especialidad,NOMBRE,DESCRIPCION[,INICIO,FIN,DURACION,CUPO]
+     modificar especialidad,CODIGO,NOMBRE,DESCRIPCION[,INICIO,FIN,DURACION,CUPO]
+     baja especialidad,CODIGO
+     alta turno,DNI,CODIGO_ESPECIALIDAD,DIA,MES,ANIO,HORA,MINUTO
+     modificar turno,CODIGO,DIA,MES,ANIO,HORA,MINUTO
+     cancelar,CODIGO
+     exportar,pacientes|especialidades|turnos,texto|csv|json,RUTA   (RUTA - es la salida estandar)
+     estado[,RUTA]      (metricas de las operaciones, ver ESTADO Y VOLCADO DE METRICAS)
+     verificar          (compara los indices de turnos con el almacen, ver verificarContadoresActivos)
+
+   INICIO y FIN son horas del dia HH:MM y DURACION esta en minutos; sin ellos la especialidad
+   nueva recibe HORARIO_POR_DEFECTO y la modificada conserva su horario.
+   Los codigos se asignan en orden, igual que en el modo interactivo, por lo que un lote
+   aplicado sobre el mismo estado inicial produce siempre los mismos codigos. */
+const int MAX_CAMPOS_LOTE = 10;
+const int LARGO_LINEA_LOTE = 1024;
+
+/* Separa la linea en campos en el mismo buffer. Devuelve la cantidad de campos. */
+int separarCamposLote(char *linea, char *campos[], int maxCampos) {
+    int cantidad = 0;
+    char *p = linea;
+    while (true) {
+        while (*p == ' ' || *p == '\t') p++;
+        char *campo = p;
+        char *escritura = p;
+        if (*p == '"') {
+            p++;
+            while (*p != '\0') {
+                if (*p == '"') {
+                    if (p[1] != '"') {
+                        p++;
+                        break;
+                    }
+                    p++;
+                }
+                *escritura = *p;
+                escritura++;
+                p++;
+            }
+            while (*p != ',' && *p != '\0') p++;
+        } else {
+            while (*p != ',' && *p != '\0') p++;
+            escritura = p;
+            while (escritura > campo && (escritura[-1] == ' ' || escritura[-1] == '\t')) escritura--;
+        }
+        char separador = *p;
+        *escritura = '\0';
+        if (cantidad < maxCampos) campos[cantidad] = campo;
+        cantidad = cantidad + 1;
+        if (separador == '\0') break;
+        p++;
+    }
+    return cantidad;
+}
+
+/* Arma un horario con los cuatro campos INICIO,FIN,DURACION,CUPO. Los valores mal escritos
+   quedan fuera de rango y la operacion los rechaza con ERROR_HORARIO_INVALIDO. */
+HorarioAtencion horarioDesdeCampos(char *campos[]) {
+    HorarioAtencion h;
+    h.inicio = leerHoraDelDia(campos[0]);
+    h.fin = leerHoraDelDia(campos[1]);
+    h.duracion = atoi(campos[2]);
+    h.cupo = atoi(campos[3]);
+    return h;
+}
+
+/* Ejecuta un comando ya separado en campos y devuelve el resultado de la operacion.
+   En las altas de especialidad y turno deja en codigo el codigo asignado (si no, 0). */
+int ejecutarComandoLote(char *campos[], int n, int &codigo) {
+    const char *comando = campos[0];
+    codigo = 0;
+    if (strcmp(comando, "alta paciente") == 0) {
+        if (n != 5) return ERROR_CANTIDAD_CAMPOS;
+        return ejecutarAltaPaciente(campos[1], campos[2], campos[3], campos[4]);
+    } else if (strcmp(comando, "modificar paciente") == 0) {
+        if (n != 5) return ERROR_CANTIDAD_CAMPOS;
+        return ejecutarModificacionPaciente(campos[1], campos[2], campos[3], campos[4]);
+    } else if (strcmp(comando, "baja paciente") == 0) {
+        if (n != 2) return ERROR_CANTIDAD_CAMPOS;
+        return ejecutarBajaPaciente(campos[1]);
+    } else if (strcmp(comando, "alta especialidad") == 0) {
+        if (n != 2 && n != 3 && n != 7) return ERROR_CANTIDAD_CAMPOS;
+        HorarioAtencion horario = (n == 7) ? horarioDesdeCampos(campos + 3) : HORARIO_POR_DEFECTO;
+        return ejecutarAltaEspecialidad(campos[1], n >= 3 ? campos[2] : "", horario, codigo);
+    } else if (strcmp(comando, "modificar especialidad") == 0) {
+        if (n != 4 && n != 8) return ERROR_CANTIDAD_CAMPOS;
+        if (n == 4) return ejecutarModificacionEspecialidad(atoi(campos[1]), campos[2], campos[3], NULL);
+        HorarioAtencion horario = horarioDesdeCampos(campos + 4);
+        return ejecutarModificacionEspecialidad(atoi(campos[1]), campos[2], campos[3], &horario);
+    } else if (strcmp(comando, "baja especialidad") == 0) {
+        if (n != 2) return ERROR_CANTIDAD_CAMPOS;
+        return ejecutarBajaEspecialidad(atoi(campos[1]));
+    } else if (strcmp(comando, "alta turno") == 0) {
+        if (n != 8) return ERROR_CANTIDAD_CAMPOS;
+        return ejecutarAltaTurno(campos[1], atoi(campos[2]), atoi(campos[3]), atoi(campos[4]), atoi(campos[5]),
+                                 atoi(campos[6]), atoi(campos[7]), codigo);
+    } else if (strcmp(comando, "modificar turno") == 0) {
+        if (n != 7) return ERROR_CANTIDAD_CAMPOS;
+        return ejecutarModificacionTurno(atoi(campos[1]), atoi(campos[2]), atoi(campos[3]), atoi(campos[4]),
+                                         atoi(campos[5]), atoi(campos[6]));
+    } else if (strcmp(comando, "cancelar") == 0 || strcmp(comando, "cancelar turno") == 0) {
+        if (n != 2) return ERROR_CANTIDAD_CAMPOS;
+        return ejecutarCancelacionTurno(atoi(campos[1]), minutosActuales());
+    } else if (strcmp(comando, "exportar") == 0) {
+        if (n != 4) return ERROR_CANTIDAD_CAMPOS;
+        int tipo;
+        int formato;
+        if (strcmp(campos[1], "pacientes") == 0) tipo = REPORTE_PACIENTES;
+        else if (strcmp(campos[1], "especialidades") == 0) tipo = REPORTE_ESPECIALIDADES;
+        else if (strcmp(campos[1], "turnos") == 0) tipo = REPORTE_TURNOS;
+        else return ERROR_VALOR_INVALIDO;
+        if (strcmp(campos[2], "texto") == 0) formato = FORMATO_TEXTO;
+        else if (strcmp(campos[2], "csv") == 0) formato = FORMATO_CSV;
+        else if (strcmp(campos[2], "json") == 0) formato = FORMATO_JSON;
+        else return ERROR_VALOR_INVALIDO;
+        return exportarReporte(tipo, formato, campos[3]);
+    } else if (strcmp(comando, "estado") == 0) {
+        if (n != 1 && n != 2) return ERROR_CANTIDAD_CAMPOS;
+        return exportarMetricas(n == 2 ? campos[1] : "-");
+    } else if (strcmp(comando, "verificar") == 0) {
+        if (n != 1) return ERROR_CANTIDAD_CAMPOS;
+        return ejecutarVerificacionIndices();
+    }
+    return ERROR_COMANDO_DESCONOCIDO;
+}
+
+/* Procesa todas las lineas de f. Informa cada linea con error y un resumen al final.
+   Devuelve la cantidad de lineas con error. */
+/* Las operaciones del lote se confirman en grupos: si el grupo no llega a disco, las
+   lineas que ya se contaban como aplicadas pasan a ser errores */
+void descartarPendientesLote(int primeraLinea, int ultimaLinea, int &pendientes, int &aplicadas, int &errores) {
+    if (pendientes == 0) return;
+    cout << "Lineas " << primeraLinea << " a " << ultimaLinea << ": " << mensajeResultado(ERROR_LOG) << "\n";
+    aplicadas = aplicadas - pendientes;
+    errores = errores + pendientes;
+    pendientes = 0;
+}
+
+int procesarLote(FILE *f) {
+    char linea[LARGO_LINEA_LOTE];
+    char *campos[MAX_CAMPOS_LOTE];
+    int numeroLinea = 0;
+    int aplicadas = 0;
+    int errores = 0;
+    int pendientes = 0;         /* aplicadas que todavia no estan en disco */
+    int primeraPendiente = 0;
+    int ultimaPendiente = 0;
+    while (fgets(linea, LARGO_LINEA_LOTE, f) != NULL) {
+        numeroLinea = numeroLinea + 1;
+        size_t largo = strlen(linea);
+        if (largo > 0 && linea[largo - 1] != '\n' && !feof(f)) {
+            /* linea demasiado larga: descartar el resto */
+            int c = fgetc(f);
+            while (c != '\n' && c != EOF) c = fgetc(f);
+            cout << "Linea " << numeroLinea << ": linea demasiado larga.\n";
+            errores = errores + 1;
+            continue;
+        }
+        while (largo > 0 && (linea[largo - 1] == '\n' || linea[largo - 1] == '\r')) {
+            largo = largo - 1;
+            linea[largo] = '\0';
+        }
+        if (esVacio(linea) || linea[0] == '#') continue;
+
+        int n = separarCamposLote(linea, campos, MAX_CAMPOS_LOTE);
+        int codigo;
+        unsigned long long lsnAnterior = lsnUltimaOperacionHilo;
+        int resultado = (n > MAX_CAMPOS_LOTE) ? ERROR_CANTIDAD_CAMPOS : ejecutarComandoLote(campos, n, codigo);
+        if (resultado == OPERACION_OK) {
+            aplicadas = aplicadas + 1;
+            if (lsnUltimaOperacionHilo != lsnAnterior) {
+                if (pendientes == 0) primeraPendiente = numeroLinea;
+                ultimaPendiente = numeroLinea;
+                pendientes = pendientes + 1;
+            }
+        } else {
+            if (resultado == ERROR_LOG) descartarPendientesLote(primeraPendiente, ultimaPendiente, pendientes, aplicadas, errores);
+            cout << "Linea " << numeroLinea << ": " << mensajeResultado(resultado) << "\n";
+            errores = errores + 1;
+        }
+        mantenimientoLog();
+        if (pendientes > 0 && lsnConfirmado() >= lsnUltimaOperacionHilo) pendientes = 0;
+    }
+    if (pendientes > 0 && !confirmarLog()) descartarPendientesLote(primeraPendiente, ultimaPendiente, pendientes, aplicadas, errores);
+    cout << "Lote procesado: " << aplicadas << " operacion(es) aplicada(s), " << errores << " con error.\n";
+    return errores;
+}
+
+/* ------- POOL DE HILOS CON ROBO DE TAREAS ------- */
+
+/* Cada hilo del pool tiene su propia cola y saca de ella sus tareas; cuando se queda sin
+   trabajo roba de la cola de otro hilo, asi uno que termina antes ayuda a los demas sin
+   que todos compitan por una cola comun. El dueño toma la tarea mas vieja de su cola y el
+   ladron la mas nueva de la ajena: quien consume los resultados suele hacerlo en el orden
+   en que se encolaron, y asi las primeras no quedan esperando detras de las ultimas.
+   Las tareas son bloques grandes de trabajo, por eso alcanza un candado por cola. */
+struct Tarea {
+    void (*funcion)(void *dato);
+    void *dato;
+};
+
+struct ColaTareas {
+    mutex candado;
+    Tarea *tareas;      /* circular */
+    int capacidad;
+    int inicio;
+    int cantidad;
+};
+
+struct PoolTareas {
+    int hilos;
+    ColaTareas *colas;
+    thread *trabajadores;
+    mutex candadoEspera;
+    condition_variable hayTareas;
+    atomic<int> pendientes;             /* encoladas y todavia no tomadas */
+    atomic<bool> activo;
+    atomic<unsigned int> proximaCola;   /* reparto de las tareas que llegan de afuera del pool */
+    atomic<long long> robadas;
+};
+
+/* Hilo del pool que se esta ejecutando (-1 fuera del pool) */
+thread_local int trabajadorActual = -1;
+
+void colaAgregar(ColaTareas &c, const Tarea &t) {
+    lock_guard<mutex> guarda(c.candado);
+    if (c.cantidad == c.capacidad) {
+        int nuevaCapacidad = (c.capacidad == 0) ? 64 : c.capacidad * 2;
+        Tarea *nuevas = new Tarea[nuevaCapacidad];
+        int i;
+        for (i = 0; i < c.cantidad; i = i + 1) nuevas[i] = c.tareas[(c.inicio + i) % c.capacidad];
+        delete[] c.tareas;
+        c.tareas = nuevas;
+        c.capacidad = nuevaCapacidad;
+        c.inicio = 0;
+    }
+    c.tareas[(c.inicio + c.cantidad) % c.capacidad] = t;
+    c.cantidad = c.cantidad + 1;
+}
+
+/* La mas vieja (la toma el dueño de la cola) */
+bool colaSacarPrimera(ColaTareas &c, Tarea &t) {
+    lock_guard<mutex> guarda(c.candado);
+    if (c.cantidad == 0) return false;
+    t = c.tareas[c.inicio];
+    c.inicio = (c.inicio + 1) % c.capacidad;
+    c.cantidad = c.cantidad - 1;
+    return true;
+}
+
+/* La mas nueva (la roba otro hilo) */
+bool colaSacarUltima(ColaTareas &c, Tarea &t) {
+    lock_guard<mutex> guarda(c.candado);
+    if (c.cantidad == 0) return false;
+    t = c.tareas[(c.inicio + c.cantidad - 1) % c.capacidad];
+    c.cantidad = c.cantidad - 1;
+    return true;
+}
+
+bool tomarTarea(PoolTareas &pool, int propio, Tarea &t) {
+    if (colaSacarPrimera(pool.colas[propio], t)) {
+        pool.pendientes.fetch_sub(1);
+        return true;
+    }
+    int i;
+    for (i = 1; i < pool.hilos; i = i + 1) {
+        if (colaSacarUltima(pool.colas[(propio + i) % pool.hilos], t)) {
+            pool.pendientes.fetch_sub(1);
+            pool.robadas.fetch_add(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Ejecuta tareas hasta que el pool se detiene y no queda ninguna pendiente */
+void trabajadorPool(PoolTareas *pool, int propio) {
+    trabajadorActual = propio;
+    while (true) {
+        Tarea t;
+        if (tomarTarea(*pool, propio, t)) {
+            t.funcion(t.dato);
+            continue;
+        }
+        unique_lock<mutex> espera(pool->candadoEspera);
+        while (pool->pendientes.load() == 0 && pool->activo.load()) pool->hayTareas.wait(espera);
+        if (pool->pendientes.load() == 0) return;
+    }
+}
+
+void iniciarPool(PoolTareas &pool, int hilos) {
+    if (hilos < 1) hilos = 1;
+    pool.hilos = hilos;
+    pool.colas = new ColaTareas[hilos];
+    int i;
+    for (i = 0; i < hilos; i = i + 1) {
+        pool.colas[i].tareas = NULL;
+        pool.colas[i].capacidad = 0;
+        pool.colas[i].inicio = 0;
+        pool.colas[i].cantidad = 0;
+    }
+    pool.pendientes.store(0);
+    pool.activo.store(true);
+    pool.proximaCola.store(0);
+    pool.robadas.store(0);
+    pool.trabajadores = new thread[hilos];
+    for (i = 0; i < hilos; i = i + 1) pool.trabajadores[i] = thread(trabajadorPool, &pool, i);
+}
+
+/* Desde un hilo del pool la tarea va a su propia cola; desde afuera, a las colas por turno */
+void encolarTarea(PoolTareas &pool, void (*funcion)(void *), void *dato) {
+    Tarea t;
+    t.funcion = funcion;
+    t.dato = dato;
+    int cola = (trabajadorActual >= 0 && trabajadorActual < pool.hilos)
+                   ? trabajadorActual : (int)(pool.proximaCola.fetch_add(1) % (unsigned int)pool.hilos);
+    colaAgregar(pool.colas[cola], t);
+    pool.pendientes.fetch_add(1);
+    {
+        lock_guard<mutex> espera(pool.candadoEspera);
+    }
+    pool.hayTareas.notify_one();
+}
+
+/* Termina las tareas pendientes y espera a todos los hilos */
+void detenerPool(PoolTareas &pool) {
+    {
+        lock_guard<mutex> espera(pool.candadoEspera);
+        pool.activo.store(false);
+    }
+    pool.hayTareas.notify_all();
+    int i;
+    for (i = 0; i < pool.hilos; i = i + 1) pool.trabajadores[i].join();
+    for (i = 0; i < pool.hilos; i = i + 1) delete[] pool.colas[i].tareas;
+    delete[] pool.trabajadores;
+    delete[] pool.colas;
+    pool.trabajadores = NULL;
+    pool.colas = NULL;
+}
+
+/* ------- IMPORTACION MASIVA ------- */
+
+/* --importar RUTA (o - para stdin) carga los pacientes y turnos de una clinica nueva desde
+   un archivo con lineas "alta paciente,..." y "alta turno,..." del modo lote; las
+   especialidades ya tienen que existir. Trabaja en tres etapas:
+   1. lectura: el hilo principal lee bloques de TAM_BLOQUE_IMPORTACION bytes cortados
+      despues de un fin de linea;
+   2. analisis: el pool separa los campos y valida cada linea (datos obligatorios, cantidad
+      de campos, fecha). No depende del estado, asi que los bloques se analizan en paralelo;
+   3. confirmacion: el hilo principal aplica los bloques en el orden del archivo, con las
+      comprobaciones que dependen del estado (DNI repetido, paciente y especialidad
+      existentes, turno activo repetido del paciente en la especialidad, cupo) y asigna los
+      codigos de turno. Cada bloque se confirma en el log con un solo fsync.
+   Importar el mismo archivo sobre el mismo estado da siempre los mismos codigos y los
+   mismos errores que --lote (salvo los comandos que no son altas, que se rechazan).
+   Hay a lo sumo BLOQUES_POR_HILO_IMPORTACION bloques por hilo leidos y sin confirmar. */
+const int TAM_BLOQUE_IMPORTACION = 1024 * 1024;
+const int BLOQUES_POR_HILO_IMPORTACION = 4;
+
+enum TipoRegistroImportacion {
+    IMPORTAR_PACIENTE,
+    IMPORTAR_TURNO,
+    IMPORTAR_ERROR,
+    IMPORTAR_LINEA_LARGA
+};
+
+/* Una linea con datos ya validada (o su error) */
+struct RegistroImportacion {
+    int linea;          /* dentro del bloque, desde 0 */
+    int tipo;
+    int resultado;      /* IMPORTAR_ERROR: el error de la linea */
+    Paciente paciente;
+    Turno turno;
+    bool fechaValida;   /* la fecha se informa despues de los errores que dependen del estado */
+    int minutos;        /* del turno, en la escala de minutosDeTurno */
+};
+
+struct BloqueImportacion {
+    char *texto;
+    int largo;
+    int lineas;
+    RegistroImportacion *registros;
+    int cantidadRegistros;
+    long long microsegundos;    /* que llevo analizarlo */
+    bool analizado;             /* protegido por candadoImportacion */
+};
+
+mutex candadoImportacion;
+condition_variable bloqueAnalizado;
+
+/* Valida una linea (ya sin fin de linea) sin mirar el estado */
+void analizarLineaImportacion(char *linea, RegistroImportacion &r) {
+    char *campos[MAX_CAMPOS_LOTE];
+    int n = separarCamposLote(linea, campos, MAX_CAMPOS_LOTE);
+    r.tipo = IMPORTAR_ERROR;
+    if (n > MAX_CAMPOS_LOTE) {
+        r.resultado = ERROR_CANTIDAD_CAMPOS;
+    } else if (strcmp(campos[0], "alta paciente") == 0) {
+        if (n != 5) {
+            r.resultado = ERROR_CANTIDAD_CAMPOS;
+        } else if (esVacio(campos[1]) || esVacio(campos[2]) || esVacio(campos[3]) || esVacio(campos[4])) {
+            r.resultado = ERROR_CAMPO_OBLIGATORIO;
+        } else {
+            copiarCampo(r.paciente.apellido, campos[1], sizeof(r.paciente.apellido));
+            copiarCampo(r.paciente.nombre, campos[2], sizeof(r.paciente.nombre));
+            copiarCampo(r.paciente.dni, campos[3], sizeof(r.paciente.dni));
+            copiarCampo(r.paciente.telefono, campos[4], sizeof(r.paciente.telefono));
+            r.tipo = IMPORTAR_PACIENTE;
+        }
+    } else if (strcmp(campos[0], "alta turno") == 0) {
+        if (n != 8) {
+            r.resultado = ERROR_CANTIDAD_CAMPOS;
+        } else if (esVacio(campos[1])) {
+            r.resultado = ERROR_CAMPO_OBLIGATORIO;
+        } else {
+            Turno &t = r.turno;
+            memset(&t, 0, sizeof(t));
+            copiarCampo(t.pacienteDNI, campos[1], sizeof(t.pacienteDNI));
+            t.codigoEspecialidad = atoi(campos[2]);
+            t.dia = atoi(campos[3]);
+            t.mes = atoi(campos[4]);
+            t.anio = atoi(campos[5]);
+            t.hora = atoi(campos[6]);
+            t.minuto = atoi(campos[7]);
+            t.estado = ESTADO_ACTIVO;
+            r.tipo = IMPORTAR_TURNO;    /* la fecha se valida con las del bloque */
+        }
+    } else {
+        r.resultado = ERROR_COMANDO_DESCONOCIDO;
+    }
+}
+
+/* Valida y convierte juntas las fechas de los turnos del bloque, pasadas a columnas */
+void convertirFechasBloqueImportacion(BloqueImportacion *b) {
+    int n = b->cantidadRegistros;
+    int *columnas = new int[6 * (n > 0 ? n : 1)];
+    int *dias = columnas;
+    int *meses = columnas + n;
+    int *anios = columnas + 2 * n;
+    int *horas = columnas + 3 * n;
+    int *minutos = columnas + 4 * n;
+    int *salida = columnas + 5 * n;
+    int turnos = 0;
+    int i;
+    for (i = 0; i < n; i = i + 1) {
+        const RegistroImportacion &r = b->registros[i];
+        if (r.tipo != IMPORTAR_TURNO) continue;
+        dias[turnos] = r.turno.dia;
+        meses[turnos] = r.turno.mes;
+        anios[turnos] = r.turno.anio;
+        horas[turnos] = r.turno.hora;
+        minutos[turnos] = r.turno.minuto;
+        turnos = turnos + 1;
+    }
+    convertirFechasHorasAMinutos(dias, meses, anios, horas, minutos, salida, turnos);
+    turnos = 0;
+    for (i = 0; i < n; i = i + 1) {
+        RegistroImportacion &r = b->registros[i];
+        if (r.tipo != IMPORTAR_TURNO) continue;
+        r.minutos = salida[turnos];
+        r.fechaValida = salida[turnos] != (int)MINUTOS_INVALIDOS;
+        turnos = turnos + 1;
+    }
+    delete[] columnas;
+}
+
+/* Tarea del pool: separa el bloque en lineas y las valida */
+void analizarBloqueImportacion(void *dato) {
+    BloqueImportacion *b = (BloqueImportacion *)dato;
+    long long comienzo = microsegundosMonotonos();
+    int lineas = 0;
+    int i;
+    for (i = 0; i < b->largo; i = i + 1) {
+        if (b->texto[i] == '\n') lineas = lineas + 1;
+    }
+    if (b->largo > 0 && b->texto[b->largo - 1] != '\n') lineas = lineas + 1;
+    b->registros = new RegistroImportacion[lineas > 0 ? lineas : 1];
+    b->cantidadRegistros = 0;
+    b->lineas = lineas;
+
+    char *p = b->texto;
+    char *finTexto = b->texto + b->largo;
+    int numero = 0;
+    while (p < finTexto) {
+        char *fin = (char *)memchr(p, '\n', finTexto - p);
+        if (fin == NULL) fin = finTexto;
+        *fin = '\0';
+        size_t largo = (size_t)(fin - p);
+        /* mismo limite que fgets con LARGO_LINEA_LOTE en procesarLote */
+        bool larga = largo + 1 > (size_t)LARGO_LINEA_LOTE - 1;
+        while (largo > 0 && p[largo - 1] == '\r') {
+            largo = largo - 1;
+            p[largo] = '\0';
+        }
+        if (larga || (!esVacio(p) && p[0] != '#')) {
+            RegistroImportacion &r = b->registros[b->cantidadRegistros];
+            r.linea = numero;
+            if (larga) {
+                r.tipo = IMPORTAR_LINEA_LARGA;
+            } else {
+                analizarLineaImportacion(p, r);
+            }
+            b->cantidadRegistros = b->cantidadRegistros + 1;
+        }
+        numero = numero + 1;
+        p = fin + 1;
+    }
+    convertirFechasBloqueImportacion(b);
+    b->microsegundos = microsegundosMonotonos() - comienzo;
+    {
+        lock_guard<mutex> guarda(candadoImportacion);
+        b->analizado = true;
+    }
+    bloqueAnalizado.notify_all();
+}
+
+/* Lee el proximo bloque: lo que sobro del anterior mas lo que entre hasta completar
+   TAM_BLOQUE_IMPORTACION, cortado despues del ultimo fin de linea (lo que sigue queda en
+   resto). Si una sola linea no entra, el bloque crece. NULL al terminar el archivo. */
+BloqueImportacion *leerBloqueImportacion(FILE *f, char *&resto, int &largoResto) {
+    int capacidad = TAM_BLOQUE_IMPORTACION;
+    while (capacidad < largoResto * 2) capacidad = capacidad * 2;
+    char *texto = new char[capacidad + 1];
+    int largo = largoResto;
+    if (largoResto > 0) memcpy(texto, resto, largoResto);
+    delete[] resto;
+    resto = NULL;
+    largoResto = 0;
+    while (true) {
+        largo = largo + (int)fread(texto + largo, 1, capacidad - largo, f);
+        if (largo < capacidad) break;   /* fin del archivo */
+        int corte = largo;
+        while (corte > 0 && texto[corte - 1] != '\n') corte = corte - 1;
+        if (corte > 0) {
+            largoResto = largo - corte;
+            resto = new char[largoResto > 0 ? largoResto : 1];
+            memcpy(resto, texto + corte, largoResto);
+            largo = corte;
+            break;
+        }
+        char *mayor = new char[capacidad * 2 + 1];
+        memcpy(mayor, texto, largo);
+        delete[] texto;
+        texto = mayor;
+        capacidad = capacidad * 2;
+    }
+    if (largo == 0) {
+        delete[] texto;
+        return NULL;
+    }
+    texto[largo] = '\0';
+    BloqueImportacion *b = new BloqueImportacion;
+    b->texto = texto;
+    b->largo = largo;
+    b->lineas = 0;
+    b->registros = NULL;
+    b->cantidadRegistros = 0;
+    b->microsegundos = 0;
+    b->analizado = false;
+    return b;
+}
+
+/* Aplica un registro valido con las comprobaciones que dependen del estado, igual que
+   ejecutarAltaPaciente y ejecutarAltaTurno. Se llama con candadoCatalogo exclusivo. */
+int confirmarRegistroImportacion(RegistroImportacion &r) {
+    int idx;
+    if (r.tipo == IMPORTAR_PACIENTE) {
+        if (buscarPacientePorDNI(r.paciente.dni, idx)) return ERROR_DNI_DUPLICADO;
+        insertarPaciente(r.paciente);
+        if (!registrarEnLog(LOG_ALTA_PACIENTE, &r.paciente, sizeof(r.paciente))) return ERROR_LOG;
+        return OPERACION_OK;
+    }
+    Turno &t = r.turno;
+    if (!buscarPacientePorDNI(t.pacienteDNI, idx)) return ERROR_PACIENTE_INEXISTENTE;
+    if (!buscarEspecialidadPorCodigo(t.codigoEspecialidad, idx)) return ERROR_ESPECIALIDAD_INEXISTENTE;
+    lock_guard<mutex> franja(franjaEspecialidad(t.codigoEspecialidad));
+    if (existeTurnoActivoPacienteEspecial(t.pacienteDNI, t.codigoEspecialidad)) return ERROR_TURNO_DUPLICADO;
+    if (!r.fechaValida) return ERROR_FECHA_INVALIDA;
+    int cupo = estadoCupo(t.codigoEspecialidad, r.minutos);
+    if (cupo == CUPO_FUERA_DE_HORARIO) return ERROR_FUERA_DE_HORARIO;
+    if (cupo == CUPO_COMPLETO) return ERROR_SIN_CUPO;
+    t.codigo = proximoCodigoTurno.fetch_add(1);
+    int slot;
+    {
+        lock_guard<mutex> almacen(candadoAlmacen);
+        slot = guardarTurno(t);
+    }
+    indexarTurnoEnEspecialidad(slot);
+    if (!registrarEnLog(LOG_ALTA_TURNO, &t, sizeof(t))) return ERROR_LOG;
+    return OPERACION_OK;
+}
+
+/* Contadores de la etapa de confirmacion */
+struct ConfirmacionImportacion {
+    int pacientes;
+    int turnos;
+    int errores;
+    long long microsegundos;
+    long long espera;           /* esperando que el pool termine el bloque siguiente */
+};
+
+/* Aplica el bloque en orden e informa sus errores con el numero de linea del archivo */
+void confirmarBloqueImportacion(BloqueImportacion *b, int primeraLinea, ConfirmacionImportacion &c) {
+    long long comienzo = microsegundosMonotonos();
+    int pacientesAntes = c.pacientes;
+    int turnosAntes = c.turnos;
+    {
+        GuardaEscritura catalogo(candadoCatalogo);
+        int i;
+        for (i = 0; i < b->cantidadRegistros; i = i + 1) {
+            RegistroImportacion &r = b->registros[i];
+            int numeroLinea = primeraLinea + r.linea;
+            if (r.tipo == IMPORTAR_LINEA_LARGA) {
+                cout << "Linea " << numeroLinea << ": linea demasiado larga.\n";
+                c.errores = c.errores + 1;
+                continue;
+            }
+            int resultado = (r.tipo == IMPORTAR_ERROR) ? r.resultado : confirmarRegistroImportacion(r);
+            if (resultado != OPERACION_OK) {
+                cout << "Linea " << numeroLinea << ": " << mensajeResultado(resultado) << "\n";
+                c.errores = c.errores + 1;
+            } else if (r.tipo == IMPORTAR_PACIENTE) {
+                c.pacientes = c.pacientes + 1;
+            } else {
+                c.turnos = c.turnos + 1;
+            }
+        }
+    }
+    /* las altas del bloque se confirman juntas, con un solo fsync; si no llegan a disco
+       ninguna cuenta como aplicada */
+    if (!esperarLogDurable(lsnUltimaOperacionHilo)) {
+        int perdidas = (c.pacientes - pacientesAntes) + (c.turnos - turnosAntes);
+        if (perdidas > 0) {
+            cout << "Lineas " << primeraLinea << " a " << primeraLinea + b->lineas - 1 << ": "
+                 << mensajeResultado(ERROR_LOG) << "\n";
+        }
+        c.errores = c.errores + perdidas;
+        c.pacientes = pacientesAntes;
+        c.turnos = turnosAntes;
     }
+    mantenimientoLog();
+    c.microsegundos = c.microsegundos + (microsegundosMonotonos() - comienzo);
 }
 
-void buscarPaciente() {
-    char dni[15];
-    cout << "Busqueda paciente por DNI: ";
-    cin.getline(dni, 15);
-    int idx;
-    if (!buscarPacientePorDNI(dni, idx)) {
-        cout << "Paciente no encontrado.\n";
-        return;
-    }
-    cout << "Apellido: " << pacientes[idx].apellido << "\n";
-    cout << "Nombre: " << pacientes[idx].nombre << "\n";
-    cout << "Telefono: " << pacientes[idx].telefono << "\n";
+void liberarBloqueImportacion(BloqueImportacion *b) {
+    delete[] b->texto;
+    delete[] b->registros;
+    delete b;
 }
 
-/* ------- FUNCIONES PARA ESPECIALIDADES (ABM) ------- */
+/* Elementos por segundo de una etapa, sin dividir por cero */
+double porSegundo(long long elementos, long long microsegundos) {
+    if (microsegundos <= 0) return 0.0;
+    return (double)elementos * 1000000.0 / (double)microsegundos;
+}
 
-void altaEspecialidad() {
-    if (cantidadEspecialidades >= MAX_ESPECIALIDADES) {
-        cout << "No se pueden dar mas de alta: alcanzado maximo de especialidades.\n";
-        return;
-    }
-    Especialidad e;
-    e.codigo = proximoCodigoEspecialidad;
-    proximoCodigoEspecialidad = proximoCodigoEspecialidad + 1;
+/* Importa el archivo con hilos hilos de analisis. Devuelve la cantidad de lineas con error. */
+int importarArchivo(FILE *f, int hilos) {
+    long long comienzo = microsegundosMonotonos();
+    PoolTareas pool;
+    iniciarPool(pool, hilos);
+    int ventana = pool.hilos * BLOQUES_POR_HILO_IMPORTACION;
+    BloqueImportacion **enVuelo = new BloqueImportacion *[ventana];
+    int leidos = 0;
+    int confirmados = 0;
+    bool finArchivo = false;
+    char *resto = NULL;
+    int largoResto = 0;
+    long long bytes = 0;
+    long long microsegundosLectura = 0;
+    long long lineas = 0;
+    long long microsegundosAnalisis = 0;
+    ConfirmacionImportacion c = { 0, 0, 0, 0, 0 };
 
-    cout << "Alta de especialidad\n";
-    cout << "Nombre: ";
-    cin.getline(e.nombre, 51);
-    if (esVacio(e.nombre)) {
-        cout << "Nombre obligatorio. Alta abortada.\n";
-        return;
+    /* el indice de nombres se arma una sola vez al final, como al cargar el snapshot */
+    suspenderIndiceNombres();
+    confirmacionDiferidaLog = true;
+    while (true) {
+        while (!finArchivo && leidos - confirmados < ventana) {
+            long long inicioLectura = microsegundosMonotonos();
+            BloqueImportacion *b = leerBloqueImportacion(f, resto, largoResto);
+            microsegundosLectura = microsegundosLectura + (microsegundosMonotonos() - inicioLectura);
+            if (b == NULL) {
+                finArchivo = true;
+                break;
+            }
+            bytes = bytes + b->largo;
+            enVuelo[leidos % ventana] = b;
+            leidos = leidos + 1;
+            encolarTarea(pool, analizarBloqueImportacion, b);
+        }
+        if (confirmados == leidos) break;
+        BloqueImportacion *b = enVuelo[confirmados % ventana];
+        long long inicioEspera = microsegundosMonotonos();
+        {
+            unique_lock<mutex> guarda(candadoImportacion);
+            while (!b->analizado) bloqueAnalizado.wait(guarda);
+        }
+        c.espera = c.espera + (microsegundosMonotonos() - inicioEspera);
+        confirmarBloqueImportacion(b, (int)lineas + 1, c);
+        lineas = lineas + b->lineas;
+        microsegundosAnalisis = microsegundosAnalisis + b->microsegundos;
+        liberarBloqueImportacion(b);
+        confirmados = confirmados + 1;
     }
-    cout << "Descripcion (opcional): ";
-    cin.getline(e.descripcion, 101);
+    confirmacionDiferidaLog = false;
+    long long robadas = pool.robadas.load();
+    detenerPool(pool);
+    delete[] enVuelo;
+    delete[] resto;
+    {
+        GuardaEscritura catalogo(candadoCatalogo);
+        reanudarIndiceNombres();
+    }
+    long long total = microsegundosMonotonos() - comienzo;
 
-    especialidades[cantidadEspecialidades] = e;
-    cantidadEspecialidades = cantidadEspecialidades + 1;
-    cout << "Especialidad dada de alta. Codigo: " << e.codigo << "\n";
+    int aplicadas = c.pacientes + c.turnos;
+    char texto[256];
+    snprintf(texto, sizeof(texto), "Importacion: %lld linea(s), %d aplicada(s) (%d paciente(s), %d turno(s)), %d con error, "
+             "en %.2f s con %d hilo(s).\n", lineas, aplicadas, c.pacientes, c.turnos, c.errores, total / 1e6, pool.hilos);
+    cout << texto;
+    snprintf(texto, sizeof(texto), "  Lectura:      %lld bytes en %d bloque(s), %.3f s -> %.1f MB/s\n",
+             bytes, leidos, microsegundosLectura / 1e6, porSegundo(bytes, microsegundosLectura) / 1e6);
+    cout << texto;
+    snprintf(texto, sizeof(texto), "  Analisis:     %lld linea(s), %.3f s de hilo -> %.0f lineas/s por hilo; %lld bloque(s) robado(s)\n",
+             lineas, microsegundosAnalisis / 1e6, porSegundo(lineas, microsegundosAnalisis), robadas);
+    cout << texto;
+    snprintf(texto, sizeof(texto), "  Confirmacion: %d alta(s), %.3f s -> %.0f altas/s; %.3f s esperando al analisis\n",
+             aplicadas, c.microsegundos / 1e6, porSegundo(aplicadas, c.microsegundos), c.espera / 1e6);
+    cout << texto;
+    return c.errores;
 }
 
-void modificacionEspecialidad() {
-    char buffer[10];
-    cout << "Modificacion de especialidad - Ingrese codigo: ";
-    cin.getline(buffer, 10);
-    int codigo = atoi(buffer);
-    int idx;
-    if (!buscarEspecialidadPorCodigo(codigo, idx)) {
-        cout << "Especialidad no encontrada.\n";
-        return;
-    }
-    cout << "Nombre actual: " << especialidades[idx].nombre << "\n";
-    cout << "Nuevo nombre: ";
-    cin.getline(especialidades[idx].nombre, 51);
-    cout << "Nueva descripcion: ";
-    cin.getline(especialidades[idx].descripcion, 101);
-    cout << "Especialidad modificada.\n";
+/* ------- BANCO DE PRUEBAS DE RENDIMIENTO ------- */
+
+/* --benchmark ESCALA [--salida RUTA] arma en memoria una clinica sintetica de ESCALA
+   pacientes (de 10^3 a 10^7; con 10^7 hacen falta varios GB) y mide, llamada por llamada:
+     alta_paciente, alta_turno          armando la clinica, con las operaciones de la API
+     buscar_paciente_dni                buscarPacientePorDNI (~9% de DNIs inexistentes)
+     buscar_turno_codigo                ubicarTurno (slotDeTurno con su especialidad)
+     turnos_especialidad_dia            agenda de una especialidad en un dia (busqueda con indice)
+     filtro_columnas_NIVEL              activos de una especialidad en un mes, con los filtros
+                                        escalar, sse2 y avx2 (los que haya); si la seleccion de
+                                        alguno difiere de la escalar, se avisa y se sale con 1
+     cancelacion_turno                  ejecutarCancelacionTurno sobre codigos al azar
+     baja_paciente                      ejecutarBajaPaciente de pacientes sin turnos, cada uno una vez
+   Tres de cada cuatro pacientes reciben TURNOS_POR_PACIENTE_BENCHMARK turnos; el cuarto
+   queda sin turnos para poder darlo de baja. Las llamadas que devuelven error (turno sin
+   cupo, DNI inexistente, turno ya cancelado) se miden igual y se cuentan como rechazadas.
+   Corre antes de cargar el snapshot y sin log abierto: no toca los archivos de datos y mide
+   las estructuras en memoria sin el costo del fsync. El generador tiene semilla fija, asi
+   la misma escala arma siempre la misma clinica. Por pantalla sale una tabla; con --salida
+   (o - para la salida estandar) un CSV con una fila por operacion, para comparar corridas
+   cuando cambian las estructuras. Con --salida - la tabla va a la salida de errores, asi la
+   salida estandar es solo el CSV. */
+const int TURNOS_POR_PACIENTE_BENCHMARK = 2;
+const int TURNOS_POR_ESPECIALIDAD_BENCHMARK = 50000;
+const int MUESTRAS_BENCHMARK = 200000;
+const int MUESTRAS_FILTRO_BENCHMARK = 200;
+const int ANIO_BENCHMARK = 2030;     /* los turnos van de 2030 a 2031, todos cancelables */
+
+/* Generador xorshift64 */
+unsigned long long estadoAzarBenchmark = 88172645463325252ULL;
+
+unsigned int azarBenchmark(unsigned int limite) {
+    estadoAzarBenchmark ^= estadoAzarBenchmark << 13;
+    estadoAzarBenchmark ^= estadoAzarBenchmark >> 7;
+    estadoAzarBenchmark ^= estadoAzarBenchmark << 17;
+    return (unsigned int)(estadoAzarBenchmark >> 32) % limite;
 }
 
-void bajaEspecialidad() {
-    char buffer[10];
-    cout << "Baja de especialidad - Ingrese codigo: ";
-    cin.getline(buffer, 10);
-    int codigo = atoi(buffer);
-    int idx;
-    if (!buscarEspecialidadPorCodigo(codigo, idx)) {
-        cout << "Especialidad no encontrada.\n";
-        return;
-    }
-    /* no permitir baja si se usa en turnos activos */
-    int activos = contarTurnosActivosEspecialidad(codigo);
-    if (activos > 0) {
-        cout << "No se puede eliminar: la especialidad tiene " << activos << " turno(s) activo(s).\n";
-        return;
-    }
-    /* eliminar moviendo elementos */
+const char *SILABAS_BENCHMARK[] = { "gon", "za", "lez", "ro", "dri", "guez", "fer", "nan", "dez", "lo", "pez", "mar",
+                                    "tin", "gar", "cia", "san", "chez", "pe", "rez", "ra", "mi", "al", "va", "be" };
+const char *NOMBRES_BENCHMARK[] = { "Juan", "Maria", "Jose", "Ana", "Carlos", "Luis", "Laura", "Jorge", "Sofia", "Martin",
+                                    "Lucia", "Diego", "Paula", "Pablo", "Valentina", "Javier", "Camila", "Miguel" };
+
+/* Apellido de dos a cuatro silabas (unos 350 mil distintos) */
+void apellidoBenchmark(char *salida) {
+    int silabas = 2 + (int)azarBenchmark(3);
+    salida[0] = '\0';
     int i;
-    for (i = idx; i < cantidadEspecialidades - 1; i = i + 1) {
-        especialidades[i] = especialidades[i + 1];
+    for (i = 0; i < silabas; i = i + 1) {
+        strcat(salida, SILABAS_BENCHMARK[azarBenchmark(sizeof(SILABAS_BENCHMARK) / sizeof(SILABAS_BENCHMARK[0]))]);
     }
-    cantidadEspecialidades = cantidadEspecialidades - 1;
-    cout << "Especialidad eliminada.\n";
+    salida[0] = (char)(salida[0] - 'a' + 'A');
 }
 
-void listadoEspecialidadesCompleto() {
-    int i;
-    if (cantidadEspecialidades == 0) {
-        cout << "No hay especialidades registradas.\n";
-        return;
-    }
-    cout << "Listado de especialidades:\n";
-    for (i = 0; i < cantidadEspecialidades; i = i + 1) {
-        cout << "Codigo: " << especialidades[i].codigo << " | Nombre: " << especialidades[i].nombre
-             << " | Desc: " << especialidades[i].descripcion << "\n";
-    }
+/* Latencias de una operacion, en nanosegundos por llamada */
+struct MedicionBenchmark {
+    const char *operacion;
+    long long *muestras;
+    int cantidad;
+    int capacidad;
+    int rechazadas;
+    long long total;
+};
+
+void iniciarMedicion(MedicionBenchmark &m, const char *operacion, int capacidad) {
+    m.operacion = operacion;
+    m.muestras = new long long[capacidad > 0 ? capacidad : 1];
+    m.cantidad = 0;
+    m.capacidad = capacidad;
+    m.rechazadas = 0;
+    m.total = 0;
 }
 
-void buscarEspecialidad() {
-    char buffer[10];
-    cout << "Busqueda especialidad por codigo: ";
-    cin.getline(buffer, 10);
-    int codigo = atoi(buffer);
-    int idx;
-    if (!buscarEspecialidadPorCodigo(codigo, idx)) {
-        cout << "Especialidad no encontrada.\n";
-        return;
+void anotarMuestra(MedicionBenchmark &m, long long nanosegundos, bool aceptada) {
+    if (m.cantidad < m.capacidad) {
+        m.muestras[m.cantidad] = nanosegundos;
+        m.cantidad = m.cantidad + 1;
     }
-    cout << "Codigo: " << especialidades[idx].codigo << "\n";
-    cout << "Nombre: " << especialidades[idx].nombre << "\n";
-    cout << "Descripcion: " << especialidades[idx].descripcion << "\n";
+    m.total = m.total + nanosegundos;
+    if (!aceptada) m.rechazadas = m.rechazadas + 1;
 }
 
-/* ------- FUNCIONES PARA TURNOS (lista enlazada) ------- */
+int compararLatencias(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
 
-/* Alta de turno: valida paciente y especialidad, impide duplicado paciente+especialidad activo,
-   genera codigo automatico y agrega nodo al final de la lista. */
-void altaTurno() {
-    if (cantidadPacientes == 0) {
-        cout << "No hay pacientes registrados. Alta de turno imposible.\n";
-        return;
-    }
-    if (cantidadEspecialidades == 0) {
-        cout << "No hay especialidades registradas. Alta de turno imposible.\n";
-        return;
-    }
+/* Percentil por rango (las muestras ya ordenadas) */
+long long percentilMedicion(const MedicionBenchmark &m, int percentil) {
+    if (m.cantidad == 0) return 0;
+    int i = (int)((long long)m.cantidad * percentil / 100);
+    if (i >= m.cantidad) i = m.cantidad - 1;
+    return m.muestras[i];
+}
 
-    TurnoNodo *nuevo = new TurnoNodo();
-    nuevo->codigo = proximoCodigoTurno;
-    proximoCodigoTurno = proximoCodigoTurno + 1;
-    nuevo->siguiente = NULL;
-    nuevo->estado = ESTADO_ACTIVO;
+/* La tabla no se mezcla con el CSV cuando este va a la salida estandar */
+ostream &salidaTablaBenchmark(FILE *csv) {
+    return (csv == stdout) ? cerr : cout;
+}
 
-    cout << "Alta de turno\n";
-    char buffer[10];
+/* Ordena las muestras, agrega la fila a la tabla y al CSV y libera la medicion */
+void informarMedicion(MedicionBenchmark &m, int escala, FILE *csv) {
+    if (m.cantidad > 1) qsort(m.muestras, m.cantidad, sizeof(long long), compararLatencias);
+    double porSegundo = (m.total > 0) ? (double)m.cantidad * 1e9 / (double)m.total : 0.0;
+    long long p50 = percentilMedicion(m, 50);
+    long long p99 = percentilMedicion(m, 99);
+    long long maximo = (m.cantidad > 0) ? m.muestras[m.cantidad - 1] : 0;
+    char fila[256];
+    snprintf(fila, sizeof(fila), "%-24s %10d %10d %14.0f %10lld %10lld %12lld\n",
+             m.operacion, m.cantidad, m.rechazadas, porSegundo, p50, p99, maximo);
+    salidaTablaBenchmark(csv) << fila;
+    if (csv != NULL) {
+        fprintf(csv, "%s,%d,%d,%d,%.0f,%lld,%lld,%lld\n", m.operacion, escala, m.cantidad, m.rechazadas, porSegundo,
+                p50, p99, maximo);
+    }
+    delete[] m.muestras;
+    m.muestras = NULL;
+}
 
-    cout << "DNI del paciente: ";
-    cin.getline(nuevo->pacienteDNI, 15);
-    if (esVacio(nuevo->pacienteDNI)) {
-        cout << "DNI obligatorio. Alta abortada.\n";
-        delete nuevo;
-        return;
+/* Arma la clinica, mide y libera todo. Devuelve false si no pudo abrir el CSV; en
+   filtrosDistintos deja cuantas consultas dieron distinto con los filtros vectoriales que
+   con los escalares (0 si todos coinciden). */
+bool ejecutarBenchmark(int escala, const char *rutaSalida, int &filtrosDistintos) {
+    filtrosDistintos = 0;
+    if (escala < 1) escala = 1;
+    FILE *csv = NULL;
+    if (rutaSalida != NULL) {
+        csv = (strcmp(rutaSalida, "-") == 0) ? stdout : fopen(rutaSalida, "w");
+        if (csv == NULL) return false;
+        fprintf(csv, "operacion,escala,operaciones,rechazadas,ops_por_segundo,p50_ns,p99_ns,max_ns\n");
     }
-    int idxPac;
-    if (!buscarPacientePorDNI(nuevo->pacienteDNI, idxPac)) {
-        cout << "Paciente no registrado. Alta abortada.\n";
-        delete nuevo;
-        return;
+    long long intentosTurnos = (long long)(escala - escala / 4) * TURNOS_POR_PACIENTE_BENCHMARK;
+    int especialidades = (int)((intentosTurnos + TURNOS_POR_ESPECIALIDAD_BENCHMARK - 1) / TURNOS_POR_ESPECIALIDAD_BENCHMARK);
+    if (especialidades < 10) especialidades = 10;
+    int muestras = (escala < MUESTRAS_BENCHMARK) ? escala : MUESTRAS_BENCHMARK;
+    char dni[15];
+    char apellido[51];
+    int i;
+    int j;
+    MedicionBenchmark m;
+
+    /* especialidades de 08:00 a 20:00, turnos de 10 minutos con cupo 4 */
+    HorarioAtencion horario = { 8 * 60, 20 * 60, 10, 4 };
+    int codigoEspecialidad = 0;
+    for (i = 0; i < especialidades; i = i + 1) {
+        snprintf(apellido, sizeof(apellido), "Especialidad %d", i + 1);
+        ejecutarAltaEspecialidad(apellido, "", horario, codigoEspecialidad);
     }
+    int primeraEspecialidad = codigoEspecialidad - especialidades + 1;
 
-    cout << "Codigo de especialidad: ";
-    cin.getline(buffer, 10);
-    int codEsp = atoi(buffer);
-    int idxEsp;
-    if (!buscarEspecialidadPorCodigo(codEsp, idxEsp)) {
-        cout << "Especialidad no encontrada. Alta abortada.\n";
-        delete nuevo;
-        return;
+    ostream &tabla = salidaTablaBenchmark(csv);
+    tabla << "Benchmark: " << escala << " paciente(s), " << especialidades << " especialidad(es), filtros "
+         << nombreNivelFiltros(nucleosFiltro().nivel) << "\n";
+    char titulo[256];
+    snprintf(titulo, sizeof(titulo), "%-24s %10s %10s %14s %10s %10s %12s\n",
+             "operacion", "operaciones", "rechazadas", "ops/s", "p50 ns", "p99 ns", "max ns");
+    tabla << titulo;
+
+    iniciarMedicion(m, "alta_paciente", escala);
+    for (i = 0; i < escala; i = i + 1) {
+        snprintf(dni, sizeof(dni), "%d", 20000000 + i);
+        apellidoBenchmark(apellido);
+        const char *nombre = NOMBRES_BENCHMARK[azarBenchmark(sizeof(NOMBRES_BENCHMARK) / sizeof(NOMBRES_BENCHMARK[0]))];
+        long long antes = nanosegundosMonotonos();
+        int resultado = ejecutarAltaPaciente(apellido, nombre, dni, "1100000000");
+        anotarMuestra(m, nanosegundosMonotonos() - antes, resultado == OPERACION_OK);
     }
-    nuevo->codigoEspecialidad = codEsp;
+    informarMedicion(m, escala, csv);
 
-    /* evitar carga duplicada paciente+especialidad (activo) */
-    if (existeTurnoActivoPacienteEspecial(nuevo->pacienteDNI, nuevo->codigoEspecialidad)) {
-        cout << "El paciente ya tiene un turno activo para esa especialidad. Alta abortada.\n";
-        delete nuevo;
-        return;
+    iniciarMedicion(m, "alta_turno", (int)intentosTurnos);
+    for (i = 0; i < escala; i = i + 1) {
+        if (i % 4 == 0) continue;
+        snprintf(dni, sizeof(dni), "%d", 20000000 + i);
+        for (j = 0; j < TURNOS_POR_PACIENTE_BENCHMARK; j = j + 1) {
+            int especialidad = primeraEspecialidad + (int)azarBenchmark(especialidades);
+            int dia = 1 + (int)azarBenchmark(28);
+            int mes = 1 + (int)azarBenchmark(12);
+            int anio = ANIO_BENCHMARK + (int)azarBenchmark(2);
+            int franja = (int)azarBenchmark(72);
+            int codigo;
+            long long antes = nanosegundosMonotonos();
+            int resultado = ejecutarAltaTurno(dni, especialidad, dia, mes, anio, 8 + franja / 6, franja % 6 * 10, codigo);
+            anotarMuestra(m, nanosegundosMonotonos() - antes, resultado == OPERACION_OK);
+        }
     }
+    informarMedicion(m, escala, csv);
+    int codigos = proximoCodigoTurno.load() - 1;
+    if (codigos < 1) codigos = 1;
 
-    /* Leer fecha y hora como enteros */
-    cout << "Fecha - dia: ";
-    cin.getline(buffer, 10); nuevo->dia = atoi(buffer);
-    cout << "Fecha - mes: ";
-    cin.getline(buffer, 10); nuevo->mes = atoi(buffer);
-    cout << "Fecha - anio: ";
-    cin.getline(buffer, 10); nuevo->anio = atoi(buffer);
-    cout << "Hora (0-23): ";
-    cin.getline(buffer, 10); nuevo->hora = atoi(buffer);
-    cout << "Minuto (0-59): ";
-    cin.getline(buffer, 10); nuevo->minuto = atoi(buffer);
+    iniciarMedicion(m, "buscar_paciente_dni", muestras);
+    for (i = 0; i < muestras; i = i + 1) {
+        snprintf(dni, sizeof(dni), "%d", 20000000 + (int)azarBenchmark((unsigned int)(escala + escala / 10 + 1)));
+        int idx;
+        long long antes = nanosegundosMonotonos();
+        bool encontrado;
+        {
+            GuardaLectura catalogo(candadoCatalogo);
+            encontrado = buscarPacientePorDNI(dni, idx);
+        }
+        anotarMuestra(m, nanosegundosMonotonos() - antes, encontrado);
+    }
+    informarMedicion(m, escala, csv);
 
-    /* validar fecha y hora sencillos (checks basicos) */
-    if (nuevo->dia < 1 || nuevo->dia > 31 || nuevo->mes < 1 || nuevo->mes > 12 || nuevo->anio < 1900 ||
-        nuevo->hora < 0 || nuevo->hora > 23 || nuevo->minuto < 0 || nuevo->minuto > 59) {
-        cout << "Fecha u hora invalida. Alta abortada.\n";
-        delete nuevo;
-        return;
+    iniciarMedicion(m, "buscar_turno_codigo", muestras);
+    for (i = 0; i < muestras; i = i + 1) {
+        int codigo = 1 + (int)azarBenchmark((unsigned int)codigos);
+        int especialidad;
+        long long antes = nanosegundosMonotonos();
+        int slot = ubicarTurno(codigo, especialidad);
+        anotarMuestra(m, nanosegundosMonotonos() - antes, slot != -1);
     }
+    informarMedicion(m, escala, csv);
 
-    /* Insertar al final de la lista enlazada */
-    if (cabezaTurnos == NULL) {
-        cabezaTurnos = nuevo;
-    } else {
-        TurnoNodo *actual = cabezaTurnos;
-        while (actual->siguiente != NULL) {
-            actual = actual->siguiente;
+    /* busqueda con indice: como la opcion 3 de buscarTurnosPorFiltro, acotada a un dia */
+    iniciarMedicion(m, "turnos_especialidad_dia", muestras);
+    ListaSlots encontrados = { NULL, 0, 0 };
+    for (i = 0; i < muestras; i = i + 1) {
+        int especialidad = primeraEspecialidad + (int)azarBenchmark(especialidades);
+        int dia = diasDesdeEpoca(1 + (int)azarBenchmark(28), 1 + (int)azarBenchmark(12), ANIO_BENCHMARK + (int)azarBenchmark(2));
+        long long antes = nanosegundosMonotonos();
+        encontrados.cantidad = 0;
+        {
+            lock_guard<mutex> franja(franjaEspecialidad(especialidad));
+            if (especialidad < capacidadAgendasPorEspecialidad) {
+                CursorAgenda c;
+                EntradaAgenda e;
+                cursorAgendaIniciar(c, agendasPorEspecialidad[especialidad], dia * 1440, (dia + 1) * 1440);
+                while (cursorAgendaSiguiente(c, e)) listaSlotsAnexar(encontrados, e.slot);
+            }
         }
-        actual->siguiente = nuevo;
+        anotarMuestra(m, nanosegundosMonotonos() - antes, encontrados.cantidad > 0);
     }
+    delete[] encontrados.slots;
+    informarMedicion(m, escala, csv);
 
-    cout << "Turno creado. Codigo: " << nuevo->codigo << "\n";
-}
-
-/* Modificar turno: busca por codigo y permite cambiar fecha/hora (no cambia paciente ni especialidad) */
-void modificacionTurno() {
-    char buffer[10];
-    cout << "Modificacion de turno - Ingrese codigo de turno: ";
-    cin.getline(buffer, 10);
-    int codigo = atoi(buffer);
-    TurnoNodo *turno = buscarTurnoPorCodigo(codigo);
-    if (turno == NULL) {
-        cout << "Turno no encontrado.\n";
-        return;
+    /* sin indice: como filtroAvanzadoTurnos con estado, una especialidad y un mes. Las
+       mismas consultas se miden con cada nivel de filtros disponible; fuera de la medicion,
+       cada seleccion se compara con la de los nucleos escalares. */
+    FiltroTurnos *filtros = new FiltroTurnos[MUESTRAS_FILTRO_BENCHMARK];
+    for (i = 0; i < MUESTRAS_FILTRO_BENCHMARK; i = i + 1) {
+        int especialidad = primeraEspecialidad + (int)azarBenchmark(especialidades);
+        int mes = 1 + (int)azarBenchmark(12);
+        int anio = ANIO_BENCHMARK + (int)azarBenchmark(2);
+        filtroTurnosIniciar(filtros[i]);
+        filtros[i].estado = ESTADO_ACTIVO;
+        filtroTurnosAgregarEspecialidad(filtros[i], especialidad);
+        filtros[i].desde = diasDesdeEpoca(1, mes, anio) * 1440;
+        filtros[i].hasta = diasDesdeEpoca(1, mes % 12 + 1, anio + mes / 12) * 1440 - 1;
     }
-    if (turno->estado != ESTADO_ACTIVO) {
-        cout << "Solo se pueden modificar turnos activos.\n";
-        return;
+    const char *medicionesFiltro[] = { "filtro_columnas_escalar", "filtro_columnas_sse2", "filtro_columnas_avx2" };
+    int nivelEnUso = nucleosFiltro().nivel;
+    SeleccionTurnos resultado = { NULL, 0, 0 };
+    SeleccionTurnos referencia = { NULL, 0, 0 };
+    int nivel;
+    for (nivel = FILTROS_ESCALAR; nivel <= FILTROS_AVX2; nivel = nivel + 1) {
+        if (elegirNivelFiltros(nivel) != nivel) continue;
+        int distintas = 0;
+        iniciarMedicion(m, medicionesFiltro[nivel], MUESTRAS_FILTRO_BENCHMARK);
+        for (i = 0; i < MUESTRAS_FILTRO_BENCHMARK; i = i + 1) {
+            long long antes = nanosegundosMonotonos();
+            LecturaTurnos lectura;
+            iniciarLecturaTurnos(lectura);
+            seleccionarFiltro(lectura, filtros[i], resultado);
+            terminarLecturaTurnos(lectura);
+            int cantidad = seleccionContar(resultado);
+            anotarMuestra(m, nanosegundosMonotonos() - antes, cantidad > 0);
+            if (nivel != FILTROS_ESCALAR) {
+                elegirNivelFiltros(FILTROS_ESCALAR);
+                iniciarLecturaTurnos(lectura);
+                seleccionarFiltro(lectura, filtros[i], referencia);
+                terminarLecturaTurnos(lectura);
+                if (!seleccionesIguales(resultado, referencia)) distintas = distintas + 1;
+                elegirNivelFiltros(nivel);
+            }
+        }
+        informarMedicion(m, escala, csv);
+        if (distintas > 0) {
+            cerr << "Filtros " << nombreNivelFiltros(nivel) << ": " << distintas << " de "
+                 << MUESTRAS_FILTRO_BENCHMARK << " consulta(s) distintas de los nucleos escalares.\n";
+            filtrosDistintos = filtrosDistintos + distintas;
+        }
     }
+    elegirNivelFiltros(nivelEnUso);
+    seleccionLiberar(resultado);
+    seleccionLiberar(referencia);
+    delete[] filtros;
 
-    cout << "Ingrese nueva fecha y hora:\n";
-    cout << "Dia: "; cin.getline(buffer, 10); turno->dia = atoi(buffer);
-    cout << "Mes: "; cin.getline(buffer, 10); turno->mes = atoi(buffer);
-    cout << "Anio: "; cin.getline(buffer, 10); turno->anio = atoi(buffer);
-    cout << "Hora: "; cin.getline(buffer, 10); turno->hora = atoi(buffer);
-    cout << "Minuto: "; cin.getline(buffer, 10); turno->minuto = atoi(buffer);
+    long ahora = convertirFechaHoraAMinutos(1, 1, ANIO_BENCHMARK - 1, 0, 0);
+    iniciarMedicion(m, "cancelacion_turno", muestras);
+    for (i = 0; i < muestras; i = i + 1) {
+        int codigo = 1 + (int)azarBenchmark((unsigned int)codigos);
+        long long antes = nanosegundosMonotonos();
+        int resultado = ejecutarCancelacionTurno(codigo, ahora);
+        anotarMuestra(m, nanosegundosMonotonos() - antes, resultado == OPERACION_OK);
+    }
+    informarMedicion(m, escala, csv);
 
-    /* Validacion basica */
-    if (turno->dia < 1 || turno->dia > 31 || turno->mes < 1 || turno->mes > 12 || turno->anio < 1900 ||
-        turno->hora < 0 || turno->hora > 23 || turno->minuto < 0 || turno->minuto > 59) {
-        cout << "Fecha/hora invalida. No se modifico.\n";
-        return;
+    /* sin reposicion (mezcla parcial de Fisher-Yates): un paciente ya dado de baja no
+       cuenta como rechazada */
+    int sinTurnos = (escala + 3) / 4;
+    int *elegidos = new int[sinTurnos];
+    for (i = 0; i < sinTurnos; i = i + 1) elegidos[i] = i;
+    iniciarMedicion(m, "baja_paciente", (muestras < sinTurnos) ? muestras : sinTurnos);
+    for (i = 0; i < m.capacidad; i = i + 1) {
+        int j = i + (int)azarBenchmark((unsigned int)(sinTurnos - i));
+        int elegido = elegidos[j];
+        elegidos[j] = elegidos[i];
+        elegidos[i] = elegido;
+        snprintf(dni, sizeof(dni), "%d", 20000000 + 4 * elegido);
+        long long antes = nanosegundosMonotonos();
+        int resultado = ejecutarBajaPaciente(dni);
+        anotarMuestra(m, nanosegundosMonotonos() - antes, resultado == OPERACION_OK);
     }
-    cout << "Turno modificado correctamente.\n";
+    informarMedicion(m, escala, csv);
+    delete[] elegidos;
+
+    if (csv != NULL && csv != stdout) fclose(csv);
+    return true;
 }
 
-/* Cancelacion de turno con regla de 48 horas: si falta menos de 48h no se permite la cancelacion.
-   Compara minutos de la fecha del turno con minutos actuales usando convertirFechaHoraAMinutos.
-*/
-void cancelacionTurno() {
-    char buffer[10];
-    cout << "Cancelacion de turno - Ingrese codigo de turno: ";
-    cin.getline(buffer, 10);
-    int codigo = atoi(buffer);
-    TurnoNodo *turno = buscarTurnoPorCodigo(codigo);
-    if (turno == NULL) {
-        cout << "Turno no encontrado.\n";
-        return;
-    }
-    if (turno->estado != ESTADO_ACTIVO) {
-        cout << "El turno ya esta cancelado.\n";
-        return;
-    }
+/* ------- MODO SERVIDOR (TCP local) ------- */
 
-    long minutosTurno = convertirFechaHoraAMinutos(turno->dia, turno->mes, turno->anio, turno->hora, turno->minuto);
-    if (minutosTurno == -1) {
-        cout << "Error al interpretar fecha/hora del turno. Cancelacion no realizada.\n";
-        return;
-    }
+/* --servidor PUERTO atiende conexiones en 127.0.0.1 con un hilo por cliente. El protocolo
+   es el mismo del modo lote: una linea por comando, y por cada linea una respuesta
+     OK                 (o "OK CODIGO" en las altas de especialidad y turno)
+     ERROR N MENSAJE    (N es el ResultadoOperacion)
+   El comando "apagar" detiene el servidor; "estado" responde las lineas de las metricas
+   (ver ESTADO Y VOLCADO DE METRICAS) seguidas de OK. Las respuestas de las lineas recibidas juntas
+   se envian juntas, despues de que sus operaciones esten confirmadas en disco; si el log
+   no llega a disco, el OK de cada operacion registrada se cambia por un ERROR.
+   En Windows hay que enlazar con -lws2_32; en Linux compilar con -pthread. */
+const int MAX_CONEXIONES = 256;
+const int TAM_BUFFER_CONEXION = 64 * 1024;
+const int MAX_RESPUESTAS_CONEXION = TAM_BUFFER_CONEXION / 3;   /* la respuesta mas corta es "OK\n" */
 
-    long minutosAhora = minutosActuales();
-    long diferenciaMinutos = minutosTurno - minutosAhora;
+#if defined(_WIN32)
+typedef SOCKET SocketServidor;
+const SocketServidor SOCKET_INVALIDO = INVALID_SOCKET;
+void cerrarSocket(SocketServidor s) { closesocket(s); }
+bool errorEsTiempoAgotado() { return WSAGetLastError() == WSAETIMEDOUT; }
+#else
+typedef int SocketServidor;
+const SocketServidor SOCKET_INVALIDO = -1;
+void cerrarSocket(SocketServidor s) { close(s); }
+bool errorEsTiempoAgotado() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+#endif
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
 
-    if (diferenciaMinutos < (48L * 60L)) { /* menos de 48 horas */
-        cout << "No se puede cancelar el turno: falta menos de 48 horas.\n";
-        return;
-    }
+atomic<bool> servidorActivo(false);
+atomic<int> conexionesActivas(0);
 
-    /* Marcar cancelado */
-    turno->estado = ESTADO_CANCELADO;
-    cout << "Turno cancelado correctamente.\n";
+bool enviarTodo(SocketServidor s, const char *datos, int n) {
+    while (n > 0) {
+        int enviados = (int)send(s, datos, n, MSG_NOSIGNAL);
+        if (enviados <= 0) return false;
+        datos = datos + enviados;
+        n = n - enviados;
+    }
+    return true;
 }
 
-/* Listado completo de turnos (muestra todos o filtra por estado) */
-void listadoTurnosCompleto() {
-    if (cabezaTurnos == NULL) {
-        cout << "No hay turnos registrados.\n";
-        return;
+/* Ejecuta una linea del cliente y agrega la respuesta a salida. Si la operacion se
+   registro en el log, anota en registradas donde empieza su respuesta. */
+void responderLinea(char *linea, char *salida, int &usadoSalida, int *registradas, int &cantidadRegistradas) {
+    char *campos[MAX_CAMPOS_LOTE];
+    int codigo = 0;
+    int resultado;
+    unsigned long long lsnAnterior = lsnUltimaOperacionHilo;
+    if (strcmp(linea, "apagar") == 0) {
+        servidorActivo = false;
+        resultado = OPERACION_OK;
+    } else if (strcmp(linea, "estado") == 0) {
+        usadoSalida = usadoSalida + escribirMetricas(salida + usadoSalida, TAM_BUFFER_CONEXION - 128 - usadoSalida);
+        resultado = OPERACION_OK;
+    } else {
+        int n = separarCamposLote(linea, campos, MAX_CAMPOS_LOTE);
+        resultado = (n > MAX_CAMPOS_LOTE) ? ERROR_CANTIDAD_CAMPOS : ejecutarComandoLote(campos, n, codigo);
     }
-    TurnoNodo *actual = cabezaTurnos;
-    cout << "Listado de turnos:\n";
-    while (actual != NULL) {
-        cout << "Codigo: " << actual->codigo
-             << " | Fecha: " << actual->dia << "/" << actual->mes << "/" << actual->anio
-             << " | Hora: " << actual->hora << ":" << (actual->minuto < 10 ? "0" : "") << actual->minuto
-             << " | DNI paciente: " << actual->pacienteDNI
-             << " | Especialidad: " << actual->codigoEspecialidad
-             << " | Estado: " << (actual->estado == ESTADO_ACTIVO ? "ACTIVO" : "CANCELADO") << "\n";
-        actual = actual->siguiente;
+    int escritos;
+    if (resultado != OPERACION_OK) {
+        escritos = snprintf(salida + usadoSalida, TAM_BUFFER_CONEXION - usadoSalida, "ERROR %d %s\n",
+                            resultado, mensajeResultado(resultado));
+    } else if (codigo > 0) {
+        escritos = snprintf(salida + usadoSalida, TAM_BUFFER_CONEXION - usadoSalida, "OK %d\n", codigo);
+    } else {
+        escritos = snprintf(salida + usadoSalida, TAM_BUFFER_CONEXION - usadoSalida, "OK\n");
+    }
+    if (lsnUltimaOperacionHilo != lsnAnterior) {
+        registradas[cantidadRegistradas] = usadoSalida;
+        cantidadRegistradas = cantidadRegistradas + 1;
     }
+    usadoSalida = usadoSalida + escritos;
 }
 
-/* Búsqueda de turnos por filtros simples (por paciente DNI, por fecha o por especialidad) */
-void buscarTurnosPorFiltro() {
-    cout << "Opciones de busqueda:\n";
-    cout << "1) Por DNI de paciente\n";
-    cout << "2) Por fecha (dia,mes,anio)\n";
-    cout << "3) Por codigo de especialidad\n";
-    cout << "Elija opcion (1-3): ";
-    char opcion[4];
-    cin.getline(opcion, 4);
-    if (strcmp(opcion, "1") == 0) {
-        char dni[15];
-        cout << "Ingrese DNI: ";
-        cin.getline(dni, 15);
-        TurnoNodo *actual = cabezaTurnos;
-        bool hubo = false;
-        while (actual != NULL) {
-            if (strcmp(actual->pacienteDNI, dni) == 0) {
-                cout << "Codigo: " << actual->codigo << " Fecha: " << actual->dia << "/" << actual->mes << "/" << actual->anio
-                     << " Hora: " << actual->hora << ":" << (actual->minuto < 10 ? "0" : "") << actual->minuto
-                     << " Estado: " << (actual->estado == ESTADO_ACTIVO ? "ACTIVO" : "CANCELADO") << "\n";
-                hubo = true;
-            }
-            actual = actual->siguiente;
+/* Espera la confirmacion en disco de lo que este hilo registro y envia las respuestas.
+   Si el log fallo, las respuestas de las operaciones registradas salen como ERROR. */
+bool enviarRespuestas(SocketServidor s, char *salida, int &usadoSalida, int *registradas, int &cantidadRegistradas) {
+    bool ok;
+    if (esperarLogDurable(lsnUltimaOperacionHilo) || cantidadRegistradas == 0) {
+        ok = enviarTodo(s, salida, usadoSalida);
+    } else {
+        char *corregida = new char[usadoSalida + cantidadRegistradas * 128];
+        int usado = 0;
+        int desde = 0;
+        int i;
+        for (i = 0; i < cantidadRegistradas; i = i + 1) {
+            memcpy(corregida + usado, salida + desde, registradas[i] - desde);
+            usado = usado + (registradas[i] - desde);
+            usado = usado + snprintf(corregida + usado, 128, "ERROR %d %s\n", ERROR_LOG, mensajeResultado(ERROR_LOG));
+            desde = (int)((char *)memchr(salida + registradas[i], '\n', usadoSalida - registradas[i]) - salida) + 1;
         }
-        if (!hubo) cout << "No se encontraron turnos para ese DNI.\n";
-    } else if (strcmp(opcion, "2") == 0) {
-        char buffer[10];
-        int dia, mes, anio;
-        cout << "Dia: "; cin.getline(buffer, 10); dia = atoi(buffer);
-        cout << "Mes: "; cin.getline(buffer, 10); mes = atoi(buffer);
-        cout << "Anio: "; cin.getline(buffer, 10); anio = atoi(buffer);
-        TurnoNodo *actual = cabezaTurnos;
-        bool hubo = false;
-        while (actual != NULL) {
-            if (actual->dia == dia && actual->mes == mes && actual->anio == anio) {
-                cout << "Codigo: " << actual->codigo << " Hora: " << actual->hora << ":" << (actual->minuto < 10 ? "0" : "") << actual->minuto
-                     << " DNI: " << actual->pacienteDNI << " Estado: " << (actual->estado == ESTADO_ACTIVO ? "ACTIVO" : "CANCELADO") << "\n";
-                hubo = true;
+        memcpy(corregida + usado, salida + desde, usadoSalida - desde);
+        usado = usado + (usadoSalida - desde);
+        ok = enviarTodo(s, corregida, usado);
+        delete[] corregida;
+    }
+    usadoSalida = 0;
+    cantidadRegistradas = 0;
+    return ok;
+}
+
+void atenderConexion(SocketServidor s) {
+    char *entrada = new char[TAM_BUFFER_CONEXION];
+    char *salida = new char[TAM_BUFFER_CONEXION];
+    int *registradas = new int[MAX_RESPUESTAS_CONEXION];
+    int usadoEntrada = 0;
+    int usadoSalida = 0;
+    int cantidadRegistradas = 0;
+    bool abierta = true;
+    while (abierta && servidorActivo) {
+        int recibidos = (int)recv(s, entrada + usadoEntrada, TAM_BUFFER_CONEXION - 1 - usadoEntrada, 0);
+        if (recibidos < 0 && errorEsTiempoAgotado()) continue; /* revisar servidorActivo */
+        if (recibidos <= 0) break;
+        usadoEntrada = usadoEntrada + recibidos;
+
+        /* procesar las lineas completas; lo que sobra queda para el proximo recv */
+        int inicio = 0;
+        int i;
+        for (i = 0; i < usadoEntrada; i = i + 1) {
+            if (entrada[i] != '\n') continue;
+            entrada[i] = '\0';
+            if (i > inicio && entrada[i - 1] == '\r') entrada[i - 1] = '\0';
+            char *linea = entrada + inicio;
+            inicio = i + 1;
+            if (esVacio(linea) || linea[0] == '#') continue;
+            /* cada respuesta ocupa menos de 128 bytes (estado, menos de TAM_TEXTO_METRICAS mas 128) */
+            int reserva = (strcmp(linea, "estado") == 0) ? TAM_TEXTO_METRICAS + 128 : 128;
+            if (usadoSalida > TAM_BUFFER_CONEXION - reserva && !enviarRespuestas(s, salida, usadoSalida, registradas, cantidadRegistradas)) {
+                abierta = false;
+                break;
             }
-            actual = actual->siguiente;
+            responderLinea(linea, salida, usadoSalida, registradas, cantidadRegistradas);
         }
-        if (!hubo) cout << "No hay turnos en esa fecha.\n";
-    } else if (strcmp(opcion, "3") == 0) {
-        char buffer[10];
-        cout << "Codigo de especialidad: ";
-        cin.getline(buffer, 10);
-        int codigo = atoi(buffer);
-        TurnoNodo *actual = cabezaTurnos;
-        bool hubo = false;
-        while (actual != NULL) {
-            if (actual->codigoEspecialidad == codigo) {
-                cout << "Codigo: " << actual->codigo << " Fecha: " << actual->dia << "/" << actual->mes << "/" << actual->anio
-                     << " Hora: " << actual->hora << ":" << (actual->minuto < 10 ? "0" : "") << actual->minuto
-                     << " DNI: " << actual->pacienteDNI << " Estado: " << (actual->estado == ESTADO_ACTIVO ? "ACTIVO" : "CANCELADO") << "\n";
-                hubo = true;
-            }
-            actual = actual->siguiente;
+        if (!abierta) break;
+        if (usadoSalida > 0 && !enviarRespuestas(s, salida, usadoSalida, registradas, cantidadRegistradas)) break;
+        if (inicio == 0 && usadoEntrada == TAM_BUFFER_CONEXION - 1) break; /* linea demasiado larga */
+        memmove(entrada, entrada + inicio, usadoEntrada - inicio);
+        usadoEntrada = usadoEntrada - inicio;
+    }
+    cerrarSocket(s);
+    delete[] entrada;
+    delete[] salida;
+    delete[] registradas;
+    conexionesActivas.fetch_sub(1);
+}
+
+/* Atiende clientes hasta recibir "apagar". Devuelve false si no pudo abrir el puerto. */
+bool ejecutarServidor(int puerto) {
+#if defined(_WIN32)
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+    SocketServidor escucha = socket(AF_INET, SOCK_STREAM, 0);
+    if (escucha == SOCKET_INVALIDO) return false;
+    int uno = 1;
+    setsockopt(escucha, SOL_SOCKET, SO_REUSEADDR, (const char *)&uno, sizeof(uno));
+    struct sockaddr_in direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sin_family = AF_INET;
+    direccion.sin_port = htons((unsigned short)puerto);
+    direccion.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(escucha, (struct sockaddr *)&direccion, sizeof(direccion)) != 0 || listen(escucha, 128) != 0) {
+        cerrarSocket(escucha);
+        return false;
+    }
+
+    confirmacionDiferidaLog = true;
+    servidorActivo = true;
+    cout << "Servidor escuchando en 127.0.0.1:" << puerto << "\n";
+    cout.flush();
+    long long ultimaRevision = milisegundosMonotonos();
+    while (servidorActivo) {
+        /* select con espera corta para revisar servidorActivo y el mantenimiento del log */
+        fd_set lectura;
+        FD_ZERO(&lectura);
+        FD_SET(escucha, &lectura);
+        struct timeval espera;
+        espera.tv_sec = 0;
+        espera.tv_usec = 200000;
+        int listos = select((int)escucha + 1, &lectura, NULL, NULL, &espera);
+
+        if (milisegundosMonotonos() - ultimaRevision >= 1000) {
+            GuardaEscritura catalogo(candadoCatalogo);
+            mantenimientoLog();
+            ultimaRevision = milisegundosMonotonos();
         }
-        if (!hubo) cout << "No se encontraron turnos para esa especialidad.\n";
-    } else {
-        cout << "Opcion invalida.\n";
+        if (listos <= 0) continue;
+
+        SocketServidor cliente = accept(escucha, NULL, NULL);
+        if (cliente == SOCKET_INVALIDO) continue;
+        if (conexionesActivas.load() >= MAX_CONEXIONES) {
+            const char *ocupado = "ERROR 0 Servidor ocupado.\n";
+            enviarTodo(cliente, ocupado, (int)strlen(ocupado));
+            cerrarSocket(cliente);
+            continue;
+        }
+        setsockopt(cliente, IPPROTO_TCP, TCP_NODELAY, (const char *)&uno, sizeof(uno));
+        /* recv vuelve cada segundo aunque el cliente no envie nada, para poder apagar */
+#if defined(_WIN32)
+        DWORD tiempoLimite = 1000;
+        setsockopt(cliente, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tiempoLimite, sizeof(tiempoLimite));
+#else
+        struct timeval tiempoLimite;
+        tiempoLimite.tv_sec = 1;
+        tiempoLimite.tv_usec = 0;
+        setsockopt(cliente, SOL_SOCKET, SO_RCVTIMEO, &tiempoLimite, sizeof(tiempoLimite));
+#endif
+        conexionesActivas.fetch_add(1);
+        thread hilo(atenderConexion, cliente);
+        hilo.detach();
+    }
+    cerrarSocket(escucha);
+    while (conexionesActivas.load() > 0) {
+        this_thread::sleep_for(chrono::milliseconds(10));
     }
+    confirmacionDiferidaLog = false;
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+    cout << "Servidor detenido.\n";
+    return true;
 }
 
 /* ------- MENUS (estructura completa, sin atajos) ------- */
 
 void menuPacientes() {
     while (true) {
+        mantenimientoLog();
         cout << "\n--- Menu Pacientes ---\n";
         cout << "1) Alta de paciente\n";
         cout << "2) Modificacion de paciente\n";
         cout << "3) Baja de paciente\n";
         cout << "4) Listado completo\n";
         cout << "5) Buscar por DNI\n";
-        cout << "6) Volver\n";
-        cout << "Elija opcion (1-6): ";
+        cout << "6) Buscar por apellido\n";
+        cout << "7) Buscar por nombre aproximado\n";
+        cout << "8) Volver\n";
+        cout << "Elija opcion (1-8): ";
         char opcion[4];
         cin.getline(opcion, 4);
+        if (cin.eof()) break;
+        if (cin.fail()) {
+            cin.clear();
+            limpiarBuffer();
+        }
         if (strcmp(opcion, "1") == 0) {
             altaPaciente();
         } else if (strcmp(opcion, "2") == 0) {
@@ -688,6 +7401,10 @@ void menuPacientes() {
         } else if (strcmp(opcion, "5") == 0) {
             buscarPaciente();
         } else if (strcmp(opcion, "6") == 0) {
+            buscarPacientePorApellido();
+        } else if (strcmp(opcion, "7") == 0) {
+            buscarPacienteAproximado();
+        } else if (strcmp(opcion, "8") == 0) {
             break;
         } else {
             cout << "Opcion invalida. Reintente.\n";
@@ -697,6 +7414,7 @@ void menuPacientes() {
 
 void menuEspecialidades() {
     while (true) {
+        mantenimientoLog();
         cout << "\n--- Menu Especialidades ---\n";
         cout << "1) Alta de especialidad\n";
         cout << "2) Modificacion\n";
@@ -707,6 +7425,11 @@ void menuEspecialidades() {
         cout << "Elija opcion (1-6): ";
         char opcion[4];
         cin.getline(opcion, 4);
+        if (cin.eof()) break;
+        if (cin.fail()) {
+            cin.clear();
+            limpiarBuffer();
+        }
         if (strcmp(opcion, "1") == 0) {
             altaEspecialidad();
         } else if (strcmp(opcion, "2") == 0) {
@@ -727,6 +7450,7 @@ void menuEspecialidades() {
 
 void menuTurnos() {
     while (true) {
+        mantenimientoLog();
         cout << "\n--- Menu Turnos ---\n";
         cout << "1) Alta de turno\n";
         cout << "2) Modificacion de turno\n";
@@ -737,6 +7461,11 @@ void menuTurnos() {
         cout << "Elija opcion (1-6): ";
         char opcion[4];
         cin.getline(opcion, 4);
+        if (cin.eof()) break;
+        if (cin.fail()) {
+            cin.clear();
+            limpiarBuffer();
+        }
         if (strcmp(opcion, "1") == 0) {
             altaTurno();
         } else if (strcmp(opcion, "2") == 0) {
@@ -760,16 +7489,20 @@ int menuPrincipal() {
 
     do
     {
-        cout << "MENU PRINCIPAL" << endl;
-        cout << "1. Administrar Especialidades Medicas" << endl;
-        cout << "2. Administrar Pacientes" << endl;
-        cout << "3. Administrar Turnos" << endl;
-        cout << "4. Salir" << endl;
+        mantenimientoLog();
+        cout << "MENU PRINCIPAL" << "\n";
+        cout << "1. Administrar Especialidades Medicas" << "\n";
+        cout << "2. Administrar Pacientes" << "\n";
+        cout << "3. Administrar Turnos" << "\n";
+        cout << "4. Salir" << "\n";
         cout << "Ingrese una opcion: ";
         cin >> opcion;
-        cin.ignore(); // Limpia salto de línea
-
-        system("cls");
+        if (cin.eof()) return 0;
+        if (cin.fail()) {
+            cin.clear();
+            opcion = 0;
+        }
+        limpiarBuffer(); // Limpia el resto de la linea
 
         switch (opcion)
         {
@@ -786,11 +7519,11 @@ int menuPrincipal() {
                 break;
 
             case 4:
-                cout << "Saliendo del sistema..." << endl;
+                cout << "Saliendo del sistema..." << "\n";
                 return 0;
 
             default:
-                cout << "Numero incorrecto. Intente nuevamente." << endl;
+                cout << "Numero incorrecto. Intente nuevamente." << "\n";
                 break;
         }
 
@@ -801,17 +7534,145 @@ int menuPrincipal() {
 
 //* ------- FUNCION MAIN ------- */
 
-int main() {
+/* Antes de terminar liberar memoria del almacen de turnos y del catalogo */
+void liberarMemoria() {
+    liberarIndicesTurnos();
+    liberarCupos();
+    liberarTurnos();
+    desmapearSnapshot();
+    liberarRetirados();
+    liberarBufferReporte();
+    liberarCatalogo();
+}
+
+int main(int argc, char *argv[]) {
+    /* Opciones: --wal-grupo N (operaciones por fsync), --wal-ms M (espera maxima del grupo)
+       y --lote RUTA (ejecuta los comandos del archivo, o de stdin con "-", en lugar del menu),
+       --importar RUTA con --hilos N (ver IMPORTACION MASIVA),
+       --benchmark ESCALA con --salida RUTA (ver BANCO DE PRUEBAS DE RENDIMIENTO)
+       o --servidor PUERTO (atiende clientes en 127.0.0.1, ver MODO SERVIDOR).
+       --metricas RUTA con --metricas-segundos S vuelca las metricas periodicamente. */
+    const char *rutaLote = NULL;
+    const char *rutaImportacion = NULL;
+    int hilosImportacion = (int)thread::hardware_concurrency();
+    int puertoServidor = 0;
+    int escalaBenchmark = 0;
+    const char *rutaSalidaBenchmark = NULL;
+    const char *rutaMetricas = NULL;
+    int segundosMetricas = SEGUNDOS_VOLCADO_METRICAS;
+    bool grupoIndicado = false;
+    int i;
+    for (i = 1; i + 1 < argc; i = i + 1) {
+        if (strcmp(argv[i], "--lote") == 0) {
+            rutaLote = argv[i + 1];
+            i = i + 1;
+        } else if (strcmp(argv[i], "--importar") == 0) {
+            rutaImportacion = argv[i + 1];
+            i = i + 1;
+        } else if (strcmp(argv[i], "--hilos") == 0) {
+            hilosImportacion = atoi(argv[i + 1]);
+            i = i + 1;
+        } else if (strcmp(argv[i], "--benchmark") == 0) {
+            escalaBenchmark = atoi(argv[i + 1]);
+            i = i + 1;
+        } else if (strcmp(argv[i], "--salida") == 0) {
+            rutaSalidaBenchmark = argv[i + 1];
+            i = i + 1;
+        } else if (strcmp(argv[i], "--servidor") == 0) {
+            puertoServidor = atoi(argv[i + 1]);
+            i = i + 1;
+        } else if (strcmp(argv[i], "--wal-grupo") == 0) {
+            grupoIndicado = true;
+            operacionesPorGrupoLog = atoi(argv[i + 1]);
+            if (operacionesPorGrupoLog < 1) operacionesPorGrupoLog = 1;
+            i = i + 1;
+        } else if (strcmp(argv[i], "--metricas") == 0) {
+            rutaMetricas = argv[i + 1];
+            i = i + 1;
+        } else if (strcmp(argv[i], "--metricas-segundos") == 0) {
+            segundosMetricas = atoi(argv[i + 1]);
+            i = i + 1;
+        } else if (strcmp(argv[i], "--wal-ms") == 0) {
+            milisegundosPorGrupoLog = atoi(argv[i + 1]);
+            if (milisegundosPorGrupoLog < 0) milisegundosPorGrupoLog = 0;
+            i = i + 1;
+        }
+    }
+
+    if (escalaBenchmark > 0) {
+        /* solo en memoria: no se cargan ni se guardan los datos */
+        int codigoSalida = 0;
+        int filtrosDistintos;
+        if (!ejecutarBenchmark(escalaBenchmark, rutaSalidaBenchmark, filtrosDistintos)) {
+            cout << "No se pudo abrir " << rutaSalidaBenchmark << ".\n";
+            codigoSalida = 1;
+        }
+        if (filtrosDistintos > 0) codigoSalida = 1;
+        liberarMemoria();
+        return codigoSalida;
+    }
+
     cout << "Iniciando Sistema Medico...\n";
-    menuPrincipal();
+    bool recuperado = cargarSnapshot(ARCHIVO_SNAPSHOT);
+    int reproducidas = reproducirLog(ARCHIVO_LOG);
+#if !defined(NDEBUG)
+    /* los indices se reconstruyeron desde el almacen y el log: antes de aceptar cambios,
+       comprobar que coinciden con un recuento desde cero */
+    if (!verificarContadoresActivos()) {
+        cout << mensajeResultado(ERROR_INDICES_INCONSISTENTES) << "\n";
+        liberarMemoria();
+        return 1;
+    }
+#endif
+    if (recuperado || reproducidas > 0) {
+        cout << "Datos recuperados: " << cantidadPacientes << " paciente(s), " << cantidadEspecialidades
+             << " especialidad(es), " << cantidadTurnos << " turno(s).\n";
+    }
+    if (reproducidas > 0) {
+        cout << "Operaciones reproducidas desde el log: " << reproducidas << ".\n";
+    }
+    if (!abrirLog(ARCHIVO_LOG)) {
+        cout << "No se pudo abrir " << ARCHIVO_LOG << "; los cambios solo se guardaran al salir.\n";
+    }
+    if (rutaMetricas != NULL) iniciarVolcadoMetricas(rutaMetricas, segundosMetricas);
+    int codigoSalida = 0;
+    if (puertoServidor > 0) {
+        if (!ejecutarServidor(puertoServidor)) {
+            cout << "No se pudo abrir el puerto " << puertoServidor << ".\n";
+            codigoSalida = 1;
+        }
+    } else if (rutaImportacion != NULL) {
+        if (!grupoIndicado) operacionesPorGrupoLog = 4096;
+        if (hilosImportacion < 1) hilosImportacion = 1;
+        FILE *f = (strcmp(rutaImportacion, "-") == 0) ? stdin : fopen(rutaImportacion, "rb");
+        if (f == NULL) {
+            cout << "No se pudo abrir el archivo a importar " << rutaImportacion << ".\n";
+            codigoSalida = 1;
+        } else {
+            if (importarArchivo(f, hilosImportacion) > 0) codigoSalida = 1;
+            if (f != stdin) fclose(f);
+        }
+    } else if (rutaLote != NULL) {
+        /* en lote no tiene sentido un fsync por linea: se confirma en grupos grandes */
+        if (!grupoIndicado) operacionesPorGrupoLog = 4096;
+        FILE *f = (strcmp(rutaLote, "-") == 0) ? stdin : fopen(rutaLote, "r");
+        if (f == NULL) {
+            cout << "No se pudo abrir el lote " << rutaLote << ".\n";
+            codigoSalida = 1;
+        } else {
+            if (procesarLote(f) > 0) codigoSalida = 1;
+            if (f != stdin) fclose(f);
+        }
+    } else {
+        menuPrincipal();
+    }
+    detenerVolcadoMetricas();
 
-    /* Antes de terminar liberar memoria de lista de turnos */
-    TurnoNodo *actual = cabezaTurnos;
-    while (actual != NULL) {
-        TurnoNodo *prox = actual->siguiente;
-        delete actual;
-        actual = prox;
+    if (!guardarAlSalir()) {
+        cout << "Error al guardar los datos.\n";
     }
-    cabezaTurnos = NULL;
-    return 0;
+    cerrarLog();
+
+    liberarMemoria();
+    return codigoSalida;
 }
\ No newline at end of file